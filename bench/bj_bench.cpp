@@ -0,0 +1,267 @@
+//
+//  bj_bench.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bj_bench_database.h"
+#include "bj_bench_util.h"
+#include "u2_base.h"
+#include "u2_dns.h"
+#include "u2_mdns.h"
+
+/*
+ * Microbenchmarks of the u2 query path.
+ *
+ * Usage: bj_bench [--min-time-ms <ms>] [--max-domains <count>]
+ */
+
+static const size_t msg_ideal_size = 1500 - 20 - 8;
+static const size_t msg_max_size = U2_MDNS_MSG_SIZE_MAX - 20 - 8;
+
+struct Query {
+    std::string name;
+    unsigned char data[512];
+    size_t size;
+};
+
+static Query make_query(std::string_view name, const char *qname, int qtype, const std::vector<const u2_dns_record*>& known_answers = {})
+{
+    Query query;
+    query.name = name;
+    struct u2_dns_msg_builder builder;
+    u2_dns_msg_builder_init(&builder, query.data, sizeof(query.data), 0, 0);
+    u2_dns_msg_builder_add_question(&builder, qname, qtype, false);
+    for (auto record : known_answers) {
+        u2_dns_msg_builder_add_rr_name(&builder, record->domain->name, record->type, record->cache_flush, record->ttl, record->ptr.name);
+    }
+    query.size = u2_dns_msg_builder_get_size(&builder);
+    return query;
+}
+
+static size_t run_query(const Query& query, const u2_dns_database *database)
+{
+    unsigned char out_msg[U2_MDNS_MSG_SIZE_MAX];
+    struct u2_mdns_query_proc proc;
+    u2_mdsn_query_proc_init(&proc, query.data, query.size, database);
+    size_t total = 0;
+    for (;;) {
+        size_t out_size = u2_mdns_query_proc_run(&proc, out_msg, msg_ideal_size, msg_max_size);
+        if (out_size == 0)
+            break;
+        total += out_size;
+    }
+    return total;
+}
+
+static void bench_query_proc(const Bj_bench_database& db, uint64_t min_time_ns)
+{
+    const u2_dns_database *database = db.database_view();
+    int last_service = db.get_service_count() - 1;
+    int last_instance = db.get_instance_count() - 1;
+
+    // known answers for the last service: all its PTR records
+    std::vector<const u2_dns_record*> known_answers;
+    for (int d = 0; d < database->domain_count; d++) {
+        const u2_dns_domain *domain = database->domain_list[d];
+        if (!u2_dns_name_compare(domain->name, db.get_service_name(last_service))) {
+            for (int r = 0; r < domain->record_count; r++)
+                known_answers.push_back(domain->record_list[r]);
+        }
+    }
+
+    std::vector<Query> queries;
+    queries.push_back(make_query("A host (first domain)", db.get_host_name(), U2_DNS_RR_TYPE_A));
+    queries.push_back(make_query("SRV last instance", db.get_instance_name(last_instance), U2_DNS_RR_TYPE_SRV));
+    queries.push_back(make_query("PTR last service", db.get_service_name(last_service), U2_DNS_RR_TYPE_PTR));
+    queries.push_back(make_query("PTR last service, all known answers", db.get_service_name(last_service), U2_DNS_RR_TYPE_PTR, known_answers));
+    queries.push_back(make_query("PTR unknown service", "\010_unknown\004_tcp\005local", U2_DNS_RR_TYPE_PTR));
+
+    for (auto& query : queries) {
+        auto result = bj_bench::measure(min_time_ns, [&]() {
+            return run_query(query, database);
+        });
+        bj_bench::print_result(query.name, database->domain_count, result);
+    }
+}
+
+static void bench_emitter(const Bj_bench_database& db, uint64_t min_time_ns)
+{
+    const u2_dns_database *database = db.database_view();
+
+    std::vector<u2_mdns_response_record> records;
+    for (int d = 0; d < database->domain_count; d++) {
+        const u2_dns_domain *domain = database->domain_list[d];
+        for (int r = 0; r < domain->record_count; r++) {
+            struct u2_mdns_response_record rr = {
+                .category = U2_DNS_RR_CATEGORY_ANSWER,
+                .record = domain->record_list[r],
+            };
+            records.push_back(rr);
+        }
+    }
+
+    for (int count : { 8, 32, 256 }) {
+        if (count > (int)records.size())
+            break;
+        auto result = bj_bench::measure(min_time_ns, [&]() {
+            unsigned char out_msg[U2_MDNS_MSG_SIZE_MAX];
+            struct u2_mdns_emitter emitter;
+            u2_mdns_emitter_init(&emitter, records.data(), count, 0, false);
+            size_t total = 0;
+            for (;;) {
+                size_t out_size = u2_mdns_emitter_run(&emitter, out_msg, msg_ideal_size, msg_max_size);
+                if (out_size == 0)
+                    break;
+                total += out_size;
+            }
+            return total;
+        });
+        bj_bench::print_result("emit " + std::to_string(count) + " records", database->domain_count, result);
+    }
+}
+
+static void bench_reader(const Bj_bench_database& db, uint64_t min_time_ns)
+{
+    // decode a typical response: the answer to a PTR query
+
+    const u2_dns_database *database = db.database_view();
+    Query query = make_query("", db.get_service_name(0), U2_DNS_RR_TYPE_PTR);
+    unsigned char msg[U2_MDNS_MSG_SIZE_MAX];
+    struct u2_mdns_query_proc proc;
+    u2_mdsn_query_proc_init(&proc, query.data, query.size, database);
+    size_t msg_size = u2_mdns_query_proc_run(&proc, msg, msg_max_size, msg_max_size);
+
+    struct u2_dns_msg_reader reader;
+    u2_dns_msg_reader_init(&reader, msg, msg_size);
+    int entry_count = u2_dns_msg_reader_get_entry_count(&reader);
+
+    auto sequential = bj_bench::measure(min_time_ns, [&]() {
+        struct u2_dns_msg_reader reader;
+        u2_dns_msg_reader_init(&reader, msg, msg_size);
+        int sum = 0;
+        for (int i = 0; i < entry_count; i++) {
+            struct u2_dns_msg_entry entry;
+            u2_dns_msg_reader_get_entry(&reader, i, &entry);
+            sum += entry.rdata_pos;
+        }
+        return sum;
+    });
+    sequential.op_count *= entry_count;
+    bj_bench::print_result("get_entry, sequential (" + std::to_string(entry_count) + " entries)", database->domain_count, sequential);
+
+    auto reverse = bj_bench::measure(min_time_ns, [&]() {
+        struct u2_dns_msg_reader reader;
+        u2_dns_msg_reader_init(&reader, msg, msg_size);
+        int sum = 0;
+        for (int i = entry_count - 1; i >= 0; i--) {
+            struct u2_dns_msg_entry entry;
+            u2_dns_msg_reader_get_entry(&reader, i, &entry);
+            sum += entry.rdata_pos;
+        }
+        return sum;
+    });
+    reverse.op_count *= entry_count;
+    bj_bench::print_result("get_entry, reverse (" + std::to_string(entry_count) + " entries)", database->domain_count, reverse);
+}
+
+static void bench_builder(uint64_t min_time_ns)
+{
+    static const char name[] = "\022Service Instance 1\011_service1\004_udp\005local";
+    static const char host_name[] = "\013ServiceHost\005local";
+    static const uint8_t addr[4] = { 192, 168, 23, 45 };
+    const int add_count = 8;
+
+    auto bench = [&](std::string_view case_name, auto add) {
+        auto result = bj_bench::measure(min_time_ns, [&]() {
+            unsigned char msg[1500];
+            struct u2_dns_msg_builder builder;
+            u2_dns_msg_builder_init(&builder, msg, sizeof(msg), 0, U2_DNS_MSG_FLAG_QR | U2_DNS_MSG_FLAG_AA);
+            for (int i = 0; i < add_count; i++)
+                add(&builder);
+            return u2_dns_msg_builder_get_size(&builder);
+        });
+        result.op_count *= add_count;
+        bj_bench::print_result(case_name, 0, result);
+    };
+
+    bench("add_question", [&](struct u2_dns_msg_builder *builder) {
+        u2_dns_msg_builder_add_question(builder, name, U2_DNS_RR_TYPE_SRV, false);
+    });
+    bench("add_rr_name (PTR)", [&](struct u2_dns_msg_builder *builder) {
+        u2_dns_msg_builder_add_rr_name(builder, name, U2_DNS_RR_TYPE_PTR, false, 4500, name);
+    });
+    bench("add_rr_srv", [&](struct u2_dns_msg_builder *builder) {
+        u2_dns_msg_builder_add_rr_srv(builder, name, true, 120, 0, 0, 1234, host_name);
+    });
+    bench("add_rr_single_domain_nsec", [&](struct u2_dns_msg_builder *builder) {
+        u2_dns_msg_builder_add_rr_single_domain_nsec(builder, name, true, 4500, (u2_dns_type_mask_t)1 << U2_DNS_RR_TYPE_SRV | (u2_dns_type_mask_t)1 << U2_DNS_RR_TYPE_TXT);
+    });
+    bench("add_rr_a", [&](struct u2_dns_msg_builder *builder) {
+        u2_dns_msg_builder_add_rr_a(builder, host_name, true, 120, addr);
+    });
+}
+
+int main(int argc, const char *argv[])
+{
+    uint64_t min_time_ns = 200000000;
+    int max_domains = 100000;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--min-time-ms") && i + 1 < argc) {
+            min_time_ns = (uint64_t)atoll(argv[++i]) * 1000000;
+        } else if (!strcmp(argv[i], "--max-domains") && i + 1 < argc) {
+            max_domains = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--min-time-ms <ms>] [--max-domains <count>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<Bj_bench_database>> databases;
+    for (int domain_count = 10; domain_count <= max_domains; domain_count *= 10) {
+        databases.push_back(std::make_unique<Bj_bench_database>(domain_count));
+    }
+
+    bj_bench::print_header("u2_mdns_query_proc_run (one query, all reply messages)");
+    for (auto& db : databases)
+        bench_query_proc(*db, min_time_ns);
+
+    bj_bench::print_header("u2_mdns_emitter_run (all messages)");
+    if (!databases.empty())
+        bench_emitter(*databases.back(), min_time_ns);
+
+    bj_bench::print_header("u2_dns_msg_reader_get_entry (per entry)");
+    if (!databases.empty())
+        bench_reader(*databases.front(), min_time_ns);
+
+    bj_bench::print_header("u2_dns_msg_builder_add_* (per record)");
+    bench_builder(min_time_ns);
+
+    return 0;
+}
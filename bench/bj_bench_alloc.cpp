@@ -0,0 +1,179 @@
+//
+//  bj_bench_alloc.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+#include "bj_bench_alloc.h"
+
+/*
+ * Replacement of the global allocation functions, counting allocations per
+ * thread and globally, and live bytes globally. The u2 layer never calls malloc(), so
+ * hooking operator new is enough to account for all allocations of the
+ * packet path.
+ */
+
+static thread_local uint64_t thread_alloc_count = 0;
+static std::atomic<uint64_t> total_alloc_count = 0;
+static std::atomic<int64_t> live_byte_count = 0;
+
+uint64_t bj_bench::alloc_count()
+{
+    return thread_alloc_count;
+}
+
+uint64_t bj_bench::total_alloc_count()
+{
+    return ::total_alloc_count.load(std::memory_order_relaxed);
+}
+
+int64_t bj_bench::allocated_bytes()
+{
+    return live_byte_count.load(std::memory_order_relaxed);
+}
+
+static size_t usable_size(void *p)
+{
+#ifdef __APPLE__
+    return malloc_size(p);
+#else
+    return malloc_usable_size(p);
+#endif
+}
+
+static void release(void *p)
+{
+    if (!p)
+        return;
+    live_byte_count.fetch_sub((int64_t)usable_size(p), std::memory_order_relaxed);
+    free(p);
+}
+
+static void *allocate(std::size_t size)
+{
+    thread_alloc_count++;
+    total_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    live_byte_count.fetch_add((int64_t)usable_size(p), std::memory_order_relaxed);
+    return p;
+}
+
+static void *allocate_aligned(std::size_t size, std::align_val_t alignment)
+{
+    thread_alloc_count++;
+    total_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    std::size_t a = (std::size_t)alignment;
+    void *p = aligned_alloc(a, (size + a - 1) / a * a);
+    if (!p)
+        throw std::bad_alloc();
+    live_byte_count.fetch_add((int64_t)usable_size(p), std::memory_order_relaxed);
+    return p;
+}
+
+void *operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate_aligned(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate_aligned(size, alignment);
+}
+
+void operator delete(void *p) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    release(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    release(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{
+    release(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept
+{
+    release(p);
+}
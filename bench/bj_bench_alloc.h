@@ -0,0 +1,49 @@
+//
+//  bj_bench_alloc.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <cstdint>
+
+namespace bj_bench
+{
+
+/**
+ * Number of heap allocations (operator new) made by the calling thread so
+ * far. Only available in executables linking bj_bench_alloc.cpp, which
+ * replaces the global operator new.
+ */
+uint64_t alloc_count();
+
+// number of heap allocations made by all threads so far
+uint64_t total_alloc_count();
+
+/**
+ * Number of bytes currently allocated with operator new, by all threads,
+ * as reported by the allocator (usable size, including rounding).
+ */
+int64_t allocated_bytes();
+
+} // namespace
@@ -0,0 +1,216 @@
+//
+//  bj_bench_database.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#include <cassert>
+#include <stdexcept>
+#include "bj_bench_database.h"
+#include "bj_util.h"
+
+static const int instances_per_service = 8;
+
+Bj_bench_database::Bj_bench_database(int domain_count)
+{
+    if (domain_count < 4)
+        throw std::invalid_argument("a bench database needs at least 4 domains");
+
+    // host + enum service + services + instances = domain_count
+    instance_count = (domain_count - 2) * instances_per_service / (instances_per_service + 1);
+    service_count = domain_count - 2 - instance_count;
+    assert(instance_count > 0 && service_count > 0);
+
+    // names
+
+    names.reserve(1 + instance_count + service_count + 1);
+    host_name_index = (int)names.size();
+    names.push_back(bj_util::dns_name("BenchHost.local"));
+    instance_name_index = (int)names.size();
+    for (int i = 0; i < instance_count; i++) {
+        std::string service = "_bench" + std::to_string(i % service_count) + "._tcp.local";
+        names.push_back(bj_util::dns_name("Instance " + std::to_string(i) + "." + service));
+    }
+    service_name_index = (int)names.size();
+    for (int s = 0; s < service_count; s++) {
+        names.push_back(bj_util::dns_name("_bench" + std::to_string(s) + "._tcp.local"));
+    }
+    names.push_back(bj_util::dns_name("_services._dns-sd._udp.local"));
+
+    /*
+     * Records and domains point to each other: the vectors are sized up front
+     * so that their storage does not move while filling them.
+     */
+    size_t record_count = 2 + 3 * instance_count + instance_count + service_count;
+    records.reserve(record_count);
+    record_ptrs.reserve(record_count);
+    domains.resize(domain_count);
+
+    static const char txt[] = "\007bench=1";
+    int domain_index = 0;
+    auto add_domain = [&](const std::string& name, size_t first_record) {
+        u2_dns_domain& domain = domains[domain_index++];
+        domain.name = name.c_str();
+        domain.record_list = record_ptrs.data() + first_record;
+        domain.record_count = (int)(record_ptrs.size() - first_record);
+    };
+    auto add_record = [&](const u2_dns_record& record) {
+        records.push_back(record);
+        record_ptrs.push_back(&records.back());
+    };
+
+    // host
+
+    {
+        size_t first = records.size();
+        u2_dns_record a = {
+            .domain = &domains[domain_index],
+            .type = U2_DNS_RR_TYPE_A,
+            .ttl = 120,
+            .cache_flush = true,
+            .a = {
+                .addr = {192, 168, 23, 45},
+            },
+        };
+        add_record(a);
+        u2_dns_record nsec = {
+            .domain = &domains[domain_index],
+            .type = U2_DNS_RR_TYPE_NSEC,
+            .ttl = 4500,
+            .cache_flush = true,
+        };
+        add_record(nsec);
+        add_domain(names[host_name_index], first);
+    }
+
+    // service instances
+
+    for (int i = 0; i < instance_count; i++) {
+        size_t first = records.size();
+        u2_dns_record srv = {
+            .domain = &domains[domain_index],
+            .type = U2_DNS_RR_TYPE_SRV,
+            .ttl = 120,
+            .cache_flush = true,
+            .srv = {
+                .port = 1000 + i % 50000,
+                .name = names[host_name_index].c_str(),
+            },
+        };
+        add_record(srv);
+        u2_dns_record txt_record = {
+            .domain = &domains[domain_index],
+            .type = U2_DNS_RR_TYPE_TXT,
+            .ttl = 4500,
+            .cache_flush = true,
+            .txt = {
+                .name = txt,
+            },
+        };
+        add_record(txt_record);
+        u2_dns_record nsec = {
+            .domain = &domains[domain_index],
+            .type = U2_DNS_RR_TYPE_NSEC,
+            .ttl = 4500,
+            .cache_flush = true,
+        };
+        add_record(nsec);
+        add_domain(names[instance_name_index + i], first);
+    }
+
+    // services
+
+    for (int s = 0; s < service_count; s++) {
+        size_t first = records.size();
+        for (int i = s; i < instance_count; i += service_count) {
+            u2_dns_record ptr = {
+                .domain = &domains[domain_index],
+                .type = U2_DNS_RR_TYPE_PTR,
+                .ttl = 4500,
+                .cache_flush = false,
+                .ptr = {
+                    .name = names[instance_name_index + i].c_str(),
+                },
+            };
+            add_record(ptr);
+        }
+        add_domain(names[service_name_index + s], first);
+    }
+
+    // enum service
+
+    {
+        size_t first = records.size();
+        for (int s = 0; s < service_count; s++) {
+            u2_dns_record ptr = {
+                .domain = &domains[domain_index],
+                .type = U2_DNS_RR_TYPE_PTR,
+                .ttl = 4500,
+                .cache_flush = false,
+                .ptr = {
+                    .name = names[service_name_index + s].c_str(),
+                },
+            };
+            add_record(ptr);
+        }
+        add_domain(names.back(), first);
+    }
+
+    assert(domain_index == domain_count);
+    assert(records.size() == record_count);
+
+    for (auto& domain : domains) {
+        domain_ptrs.push_back(&domain);
+    }
+    database.domain_list = domain_ptrs.data();
+    database.domain_count = (int)domain_ptrs.size();
+}
+
+const u2_dns_database* Bj_bench_database::database_view() const
+{
+    return &database;
+}
+
+int Bj_bench_database::get_instance_count() const
+{
+    return instance_count;
+}
+
+int Bj_bench_database::get_service_count() const
+{
+    return service_count;
+}
+
+const char* Bj_bench_database::get_host_name() const
+{
+    return names[host_name_index].c_str();
+}
+
+const char* Bj_bench_database::get_instance_name(int index) const
+{
+    return names[instance_name_index + index].c_str();
+}
+
+const char* Bj_bench_database::get_service_name(int index) const
+{
+    return names[service_name_index + index].c_str();
+}
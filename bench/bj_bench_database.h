@@ -0,0 +1,69 @@
+//
+//  bj_bench_database.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+#include <string>
+#include <vector>
+#include "u2_dns.h"
+
+/**
+ * Synthetic database used by the benchmarks.
+ * It contains one host domain, a set of service instances grouped by
+ * service type (8 instances per type), the service type domains and the
+ * service enumeration domain, for a total of `domain_count` domains.
+ */
+class Bj_bench_database {
+public:
+    Bj_bench_database(int domain_count);
+
+    // `records`, `domains` and `database` point to each other; copying this object makes them dangling
+    Bj_bench_database(const Bj_bench_database&) = delete;
+    Bj_bench_database& operator= (const Bj_bench_database&) = delete;
+
+    const u2_dns_database* database_view() const;
+    int get_instance_count() const;
+    int get_service_count() const;
+
+    // names in DNS format
+    const char* get_host_name() const;
+    const char* get_instance_name(int index) const;
+    const char* get_service_name(int index) const;
+
+private:
+    int instance_count;
+    int service_count;
+
+    std::vector<std::string> names;
+    std::vector<u2_dns_record> records;
+    std::vector<const u2_dns_record*> record_ptrs;
+    std::vector<u2_dns_domain> domains;
+    std::vector<const u2_dns_domain*> domain_ptrs;
+    u2_dns_database database;
+
+    // index of the first name of each kind in `names`
+    int host_name_index;
+    int instance_name_index;
+    int service_name_index;
+};
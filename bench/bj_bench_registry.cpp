@@ -0,0 +1,201 @@
+//
+//  bj_bench_registry.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bj_bench_alloc.h"
+#include "bj_bench_util.h"
+#include "bj_net_loopback.h"
+#include "bj_server.h"
+#include "bj_util.h"
+#include "u2_dns.h"
+
+/*
+ * Scaling of the service registry of Bj_server: cost of register_service()
+ * and of the database view construction as the number of registered
+ * instances grows, over the loopback network.
+ *
+ * Usage: bj_bench_registry [--max-instances <count>] [--interfaces <count>]... [--max-time-s <s>]
+ *
+ * For each interface count (1 and 4 by default), a single server receives
+ * instances up to --max-instances (100000 by default), and a line is printed
+ * each time the instance count reaches a power of ten:
+ *
+ * - the wall time spent registering, in total and per instance over the
+ *   last decade, until the executor is done with all registrations,
+ * - the heap memory used by the server, per registered instance,
+ * - the time until one more instance is served, measured from the
+ *   register_service() call until a query for this instance is answered.
+ *
+ * A run stops when its registrations take longer than --max-time-s (60 s by
+ * default), since a registry that does not scale would take hours to reach
+ * the bigger counts.
+ */
+
+static const int register_batch = 100;
+
+static const char txt_record[] = "\x09path=/bench";
+
+struct Query {
+    unsigned char data[512];
+    size_t size;
+};
+
+static Query make_query(const std::string& qname, int qtype)
+{
+    Query query;
+    struct u2_dns_msg_builder builder;
+    u2_dns_msg_builder_init(&builder, query.data, sizeof(query.data), 0, 0);
+    u2_dns_msg_builder_add_question(&builder, qname.c_str(), qtype, false);
+    query.size = u2_dns_msg_builder_get_size(&builder);
+    return query;
+}
+
+static std::string instance_name(int index)
+{
+    return "Instance " + std::to_string(index);
+}
+
+// 16 service types, to exercise the grouping by service
+static std::string service_name(int index)
+{
+    return "_bench" + std::to_string(index % 16) + "._tcp";
+}
+
+static void register_instance(Bj_server& server, int index)
+{
+    server.register_service(instance_name(index), service_name(index), (uint16_t)(1000 + index % 50000),
+                            std::span(txt_record, sizeof(txt_record) - 1));
+}
+
+static void bench_registry(int interface_count, int max_instance_count, uint64_t max_time_ns)
+{
+    printf("%d interface%s\n", interface_count, interface_count > 1 ? "s" : "");
+    printf("  %10s %14s %16s %18s %16s\n", "instances", "total ms", "us/instance", "heap bytes/inst.", "time to serve us");
+
+    int64_t base_bytes = bj_bench::allocated_bytes();
+    {
+        Bj_net_loopback net;
+        uint64_t reply_count = 0;
+        net.set_capture_handler([&](int, Bj_net_loopback_direction direction, std::span<const unsigned char>) {
+            if (direction == Bj_net_loopback_direction::reply)
+                reply_count++;
+        });
+        std::vector<int> interface_ids;
+        for (int i = 0; i < interface_count; i++)
+            interface_ids.push_back(net.add_interface({ Bj_net_address({ 10, 0, (unsigned char)i, 1 }) }));
+
+        Bj_server server("BenchHost", net);
+        server.start();
+        net.loopback_executor().invoke_sync([]() {});
+
+        int instance_count = 0;
+        uint64_t total_ns = 0;
+        for (int checkpoint = 10; checkpoint <= max_instance_count; checkpoint *= 10) {
+            int decade_start = instance_count;
+
+            // all but the last instance of the decade, by batches, to check the time limit
+            uint64_t start = bj_bench::now_ns();
+            bool timeout = false;
+            while (instance_count < checkpoint - 1 && !timeout) {
+                int batch_end = std::min(instance_count + register_batch, checkpoint - 1);
+                for (; instance_count < batch_end; instance_count++)
+                    register_instance(server, instance_count);
+                net.loopback_executor().invoke_sync([]() {});
+                timeout = total_ns + (bj_bench::now_ns() - start) > max_time_ns;
+            }
+            if (timeout) {
+                printf("  %10d stopped after %.1f s at %d instances\n", checkpoint,
+                       (double)(total_ns + (bj_bench::now_ns() - start)) / 1e9, instance_count);
+                break;
+            }
+
+            // the last one, until it is served on the first interface
+            uint64_t serve_start = bj_bench::now_ns();
+            register_instance(server, instance_count);
+            std::string name = bj_util::dns_name(instance_name(instance_count) + "." + service_name(instance_count) + ".local");
+            Query query = make_query(name, U2_DNS_RR_TYPE_SRV);
+            uint64_t replies_before = reply_count;
+            net.loopback_executor().invoke_sync([&]() {
+                net.inject(interface_ids[0], std::span(query.data, query.size));
+            });
+            uint64_t end = bj_bench::now_ns();
+            instance_count++;
+            if (reply_count == replies_before)
+                printf("  warning: instance %d not served\n", instance_count - 1);
+
+            total_ns += end - start;
+            int64_t bytes = bj_bench::allocated_bytes() - base_bytes;
+            printf("  %10d %14.1f %16.2f %18.0f %16.1f\n", instance_count, (double)total_ns / 1e6,
+                   (double)(end - start) / 1e3 / (double)(instance_count - decade_start),
+                   (double)bytes / (double)instance_count, (double)(end - serve_start) / 1e3);
+            fflush(stdout);
+        }
+
+        server.stop();
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [--max-instances <count>] [--interfaces <count>]... [--max-time-s <s>]\n", name);
+}
+
+int main(int argc, const char *argv[])
+{
+    int max_instance_count = 100000;
+    std::vector<int> interface_counts;
+    double max_time_s = 60;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--max-instances") && i + 1 < argc) {
+            max_instance_count = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--interfaces") && i + 1 < argc) {
+            interface_counts.push_back(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--max-time-s") && i + 1 < argc) {
+            max_time_s = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (interface_counts.empty())
+        interface_counts = { 1, 4 };
+    for (int count : interface_counts) {
+        if (count < 1 || count > 256) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    for (int count : interface_counts)
+        bench_registry(count, max_instance_count, (uint64_t)(max_time_s * 1e9));
+
+    return 0;
+}
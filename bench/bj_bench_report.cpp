@@ -0,0 +1,64 @@
+//
+//  bj_bench_report.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <cstdio>
+#include "bj_bench_report.h"
+
+namespace bj_bench
+{
+
+void print_latency(const Bj_server_latency& latency)
+{
+    auto print = [](const char *name, const Bj_histogram& histogram) {
+        printf("      %-20s p50 %8llu ns   p99 %8llu ns   p99.9 %8llu ns   max %8llu ns\n", name,
+               (unsigned long long)histogram.get_percentile(50),
+               (unsigned long long)histogram.get_percentile(99),
+               (unsigned long long)histogram.get_percentile(99.9),
+               (unsigned long long)histogram.get_max());
+    };
+    print("decode", latency.decode);
+    print("known answers", latency.known_answers);
+    print("additional records", latency.additional_records);
+    print("emission", latency.emission);
+    print("send", latency.send);
+    print("total", latency.total);
+}
+
+void print_stats(const Bj_stats& stats)
+{
+    printf("      questions %llu (matched %llu, unmatched %llu), known answers %llu, responses %llu (unicast %llu), decoding errors %llu, records lost %llu (overflow) %llu (too big)\n",
+           (unsigned long long)stats.question_count,
+           (unsigned long long)stats.matched_question_count,
+           (unsigned long long)stats.unmatched_question_count,
+           (unsigned long long)stats.known_answer_count,
+           (unsigned long long)stats.tx_packet_count,
+           (unsigned long long)stats.tx_unicast_packet_count,
+           (unsigned long long)stats.decoding_error_count,
+           (unsigned long long)stats.overflow_record_count,
+           (unsigned long long)stats.dropped_record_count);
+}
+
+} // namespace
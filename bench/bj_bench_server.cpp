@@ -0,0 +1,501 @@
+//
+//  bj_bench_server.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bj_bench_alloc.h"
+#include "bj_bench_database.h"
+#include "bj_bench_report.h"
+#include "bj_bench_util.h"
+#include "bj_net_loopback.h"
+#include "bj_server.h"
+#include "bj_static_server.h"
+#include "bj_util.h"
+#include "u2_dns.h"
+
+/*
+ * End-to-end benchmarks of Bj_server and Bj_static_server over the loopback
+ * network: rx data handler, query processing and reply, without sockets.
+ *
+ * Usage: bj_bench_server [--min-time-ms <ms>] [--latency] [--capture <file.pcapng>] [--workers <count>] [--check-alloc | --check-unicast]
+ *
+ * With --latency, the per stage latency histograms of Bj_server are enabled
+ * and their percentiles are printed after each case.
+ * With --capture, all servers record their packets in the given file, with
+ * the default capture limits.
+ *
+ * With --workers, the Bj_server cases are run again with queries processed
+ * on that many worker threads; each batch is then waited for until all its
+ * queries were handled or dropped.
+ *
+ * The heap allocations made while handling queries are counted after a warm
+ * up batch, on the executor and worker threads. With --check-alloc, the exit
+ * status is 1 if any case allocates, which makes it usable as a regression
+ * check; the worker cases are run too, with 2 workers unless --workers is
+ * given, --workers 0 skipping them. Both modes are run by ctest.
+ *
+ * --check-unicast runs no benchmark: it checks the destinations and the
+ * contents of the responses to legacy queries, QU questions and direct
+ * queries, single threaded and with workers, and exits with 1 on failure.
+ */
+
+static const int inject_batch = 1000;
+static const int worker_chunk = 100; // below Bj_server::worker_queue_size
+
+struct Query {
+    unsigned char data[512];
+    size_t size;
+};
+
+// questions = (qname, qtype) pairs; `unicast_response` sets the QU bit of all of them
+static Query make_query(const std::vector<std::pair<std::string, int>>& questions, int id = 0, bool unicast_response = false)
+{
+    Query query;
+    struct u2_dns_msg_builder builder;
+    u2_dns_msg_builder_init(&builder, query.data, sizeof(query.data), id, 0);
+    for (auto& [qname, qtype] : questions)
+        u2_dns_msg_builder_add_question(&builder, qname.c_str(), qtype, unicast_response);
+    query.size = u2_dns_msg_builder_get_size(&builder);
+    return query;
+}
+
+static Query make_query(const std::string& qname, int qtype)
+{
+    return make_query({ { qname, qtype } });
+}
+
+// written by the worker threads too, in worker mode
+struct Capture_counters {
+    std::atomic<uint64_t> packet_count = 0;
+    std::atomic<uint64_t> byte_count = 0;
+    std::atomic<uint64_t> alloc_count = 0;
+
+    void reset() {
+        packet_count = 0;
+        byte_count = 0;
+        alloc_count = 0;
+    }
+};
+
+static int allocating_case_count = 0;
+
+// `handled_count`, in worker mode only, returns the number of queries handled or dropped so far
+static bj_bench::Result run(Bj_net_loopback& net, int interface_id, Query& query, Capture_counters& counters, uint64_t min_time_ns,
+                            std::function<uint64_t()> handled_count = nullptr)
+{
+    uint64_t injected_count = 0;
+
+    // in worker mode, the batch is split so as not to overflow the worker queues
+    int chunk_size = handled_count ? worker_chunk : inject_batch;
+
+    auto inject = [&]() {
+        for (int i = 0; i < chunk_size; i++)
+            net.inject(interface_id, std::span(query.data, query.size));
+    };
+
+    // the allocations of all threads but this one, which only waits for the workers
+    auto inject_batch_and_wait = [&]() {
+        uint64_t total_alloc_count = bj_bench::total_alloc_count();
+        uint64_t own_alloc_count = bj_bench::alloc_count();
+        for (int i = 0; i < inject_batch; i += chunk_size) {
+            net.loopback_executor().invoke_sync(inject);
+            injected_count += chunk_size;
+            while (handled_count && handled_count() < injected_count)
+                std::this_thread::yield();
+        }
+        uint64_t own = bj_bench::alloc_count() - own_alloc_count;
+        counters.alloc_count += bj_bench::total_alloc_count() - total_alloc_count - own;
+    };
+
+    inject_batch_and_wait();
+    counters.reset();
+
+    auto result = bj_bench::measure(min_time_ns, [&]() {
+        inject_batch_and_wait();
+        return 1;
+    });
+    result.op_count *= inject_batch;
+    return result;
+}
+
+static void print_output(const Capture_counters& counters, const bj_bench::Result& result)
+{
+    if (result.op_count == 0)
+        return;
+    printf("  %-44s %10s %14.2f %14.1f\n", "  -> output packets, bytes per query", "",
+           (double)counters.packet_count / (double)result.op_count, (double)counters.byte_count / (double)result.op_count);
+    printf("  %-44s %10s %14.3f\n", "  -> heap allocations per query", "",
+           (double)counters.alloc_count / (double)result.op_count);
+    if (counters.alloc_count)
+        allocating_case_count++;
+}
+
+static void bench_server(int instance_count, bool latency_tracking, std::shared_ptr<Bj_capture> capture, uint64_t min_time_ns, int worker_count = 0)
+{
+    std::vector<std::pair<std::string, Query>> queries;
+    queries.push_back({ "PTR service", make_query(bj_util::dns_name("_bench0._tcp.local"), U2_DNS_RR_TYPE_PTR) });
+    queries.push_back({ "SRV instance", make_query(bj_util::dns_name("Instance 0._bench0._tcp.local"), U2_DNS_RR_TYPE_SRV) });
+    queries.push_back({ "A host", make_query(bj_util::dns_name("BenchHost.local"), U2_DNS_RR_TYPE_A) });
+    queries.push_back({ "PTR unknown service", make_query(bj_util::dns_name("_unknown._tcp.local"), U2_DNS_RR_TYPE_PTR) });
+
+    // one server per query, so that the latency histograms only cover one case
+    for (auto& [name, query] : queries) {
+        Bj_net_loopback net;
+        Capture_counters counters;
+        net.set_capture_handler([&](int interface_id, Bj_net_loopback_direction direction, std::span<const unsigned char> data) {
+            counters.packet_count++;
+            counters.byte_count += data.size();
+        });
+        net.set_reply_thread_safe(worker_count > 0);
+        int interface_id = net.add_interface({ Bj_net_address({ 192, 168, 23, 45 }) });
+
+        Bj_server server("BenchHost", net);
+        server.set_latency_tracking(latency_tracking && worker_count == 0);
+        server.set_capture(capture);
+        server.set_worker_count(worker_count);
+        for (int i = 0; i < instance_count; i++) {
+            std::string service_name = "_bench" + std::to_string(i % 8) + "._tcp";
+            server.register_service("Instance " + std::to_string(i), service_name, 1000 + i, std::span<char>());
+        }
+        server.start();
+
+        std::function<uint64_t()> handled_count;
+        if (worker_count > 0) {
+            handled_count = [&]() {
+                return server.get_stats_snapshot()[interface_id].rx_packet_count;
+            };
+        }
+
+        auto result = run(net, interface_id, query, counters, min_time_ns, handled_count);
+        bj_bench::print_result(std::string(worker_count > 0 ? "Bj_server (workers): " : "Bj_server: ") + name, instance_count, result);
+        print_output(counters, result);
+        bj_bench::print_stats(server.get_stats_snapshot()[interface_id]);
+        if (latency_tracking && worker_count == 0)
+            bj_bench::print_latency(server.get_latency_snapshot()[interface_id]);
+
+        server.stop();
+    }
+}
+
+static void bench_static_server(int domain_count, std::shared_ptr<Bj_capture> capture, uint64_t min_time_ns)
+{
+    Bj_bench_database db(domain_count);
+
+    Bj_net_loopback net;
+    Capture_counters counters;
+    net.set_capture_handler([&](int interface_id, Bj_net_loopback_direction direction, std::span<const unsigned char> data) {
+        counters.packet_count++;
+        counters.byte_count += data.size();
+    });
+    int interface_id = net.add_interface({ Bj_net_address({ 192, 168, 23, 45 }) });
+
+    Bj_static_server server(net, *db.database_view());
+    server.set_capture(capture);
+    server.start();
+
+    std::vector<std::pair<std::string, Query>> queries;
+    queries.push_back({ "PTR service", make_query(db.get_service_name(0), U2_DNS_RR_TYPE_PTR) });
+    queries.push_back({ "SRV instance", make_query(db.get_instance_name(0), U2_DNS_RR_TYPE_SRV) });
+    queries.push_back({ "A host", make_query(db.get_host_name(), U2_DNS_RR_TYPE_A) });
+
+    for (auto& [name, query] : queries) {
+        auto result = run(net, interface_id, query, counters, min_time_ns);
+        bj_bench::print_result("Bj_static_server: " + name, domain_count, result);
+        print_output(counters, result);
+        bj_bench::print_stats(server.get_stats_snapshot()[interface_id]);
+    }
+
+    server.stop();
+}
+
+/*
+ * --check-unicast: the destinations and the contents of the responses of
+ * Bj_server to legacy queries, QU questions and direct queries, over an
+ * interface 192.168.23.45/24 having also fe80::45/64, and the additional
+ * records of the host over a second one, 192.168.24.45/24 only. Each check
+ * injects one query and looks at what the server sent for it.
+ */
+
+struct Sent_packet {
+    Bj_net_loopback_direction direction;
+    std::vector<unsigned char> data;
+};
+
+static int check_failure_count = 0;
+
+static void check(bool condition, const std::string& what)
+{
+    printf("  %-72s %s\n", what.c_str(), condition ? "ok" : "FAILED");
+    if (!condition)
+        check_failure_count++;
+}
+
+// decompressed name of an entry, empty if it cannot be decoded
+static std::string entry_name(const struct u2_dns_msg_entry& entry)
+{
+    char name[256];
+    u2_dns_name_init(name, sizeof(name));
+    if (!u2_dns_name_append_compressed_name(name, sizeof(name), entry.data, entry.name_pos))
+        return "";
+    return std::string(name, u2_dns_name_length(name));
+}
+
+// RFC 6762, section 6.7: the query ID and the questions are echoed, the records have a TTL of at most 10 seconds and no cache-flush bit
+static bool is_legacy_response(std::span<const unsigned char> response, const Query& query)
+{
+    struct u2_dns_msg_reader reader, query_reader;
+    if (u2_dns_msg_reader_init(&reader, response.data(), response.size()) < 0 || u2_dns_msg_reader_init(&query_reader, query.data, query.size) < 0)
+        return false;
+    if (u2_dns_msg_reader_get_id(&reader) != u2_dns_msg_reader_get_id(&query_reader))
+        return false;
+
+    int question_count = u2_dns_msg_reader_get_question_count(&query_reader);
+    if (u2_dns_msg_reader_get_question_count(&reader) != question_count)
+        return false;
+    for (int i = 0; i < question_count; i++) {
+        struct u2_dns_msg_entry entry, query_entry;
+        if (u2_dns_msg_reader_get_entry(&reader, i, &entry) < 0 || u2_dns_msg_reader_get_entry(&query_reader, i, &query_entry) < 0)
+            return false;
+        if (entry_name(entry).empty() || entry_name(entry) != entry_name(query_entry))
+            return false;
+        if (u2_dns_msg_entry_get_question_type(&entry) != u2_dns_msg_entry_get_question_type(&query_entry))
+            return false;
+        if (u2_dns_msg_entry_get_question_class(&entry) != u2_dns_msg_entry_get_question_class(&query_entry))
+            return false;
+    }
+
+    int entry_count = u2_dns_msg_reader_get_entry_count(&reader);
+    if (entry_count <= question_count)
+        return false;
+    for (int i = question_count; i < entry_count; i++) {
+        struct u2_dns_msg_entry entry;
+        if (u2_dns_msg_reader_get_entry(&reader, i, &entry) < 0)
+            return false;
+        if (u2_dns_msg_entry_get_rr_ttl(&entry) > 10 || u2_dns_msg_entry_get_rr_cache_flush(&entry))
+            return false;
+    }
+    return true;
+}
+
+// types of the records of a response, answers and additional records alike
+static std::vector<int> record_types(std::span<const unsigned char> response)
+{
+    std::vector<int> types;
+    struct u2_dns_msg_reader reader;
+    if (u2_dns_msg_reader_init(&reader, response.data(), response.size()) < 0)
+        return types;
+    int entry_count = u2_dns_msg_reader_get_entry_count(&reader);
+    for (int i = u2_dns_msg_reader_get_question_count(&reader); i < entry_count; i++) {
+        struct u2_dns_msg_entry entry;
+        if (u2_dns_msg_reader_get_entry(&reader, i, &entry) < 0)
+            break;
+        types.push_back(u2_dns_msg_entry_get_rr_type(&entry));
+    }
+    return types;
+}
+
+static int check_unicast(int worker_count)
+{
+    std::mutex mutex;
+    std::vector<Sent_packet> sent;
+
+    Bj_net_loopback net;
+    net.set_capture_handler([&](int interface_id, Bj_net_loopback_direction direction, std::span<const unsigned char> data) {
+        // the announcements, sent with Bj_net::send() at any time, are not responses
+        if (direction == Bj_net_loopback_direction::send)
+            return;
+        std::unique_lock<std::mutex> lock(mutex);
+        sent.push_back({ direction, std::vector<unsigned char>(data.begin(), data.end()) });
+    });
+    net.set_reply_thread_safe(worker_count > 0);
+    Bj_net_address address({ 192, 168, 23, 45 });
+    address.prefix_length = 24;
+    Bj_net_address address6({ 0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x45 });
+    address6.prefix_length = 64;
+    int interface_id = net.add_interface({ address, address6 });
+    Bj_net_address address_v4_only({ 192, 168, 24, 45 });
+    address_v4_only.prefix_length = 24;
+    int v4_only_interface_id = net.add_interface({ address_v4_only });
+
+    Bj_server server("BenchHost", net);
+    server.set_worker_count(worker_count);
+    server.register_service("Instance 0", "_bench0._tcp", 1000, std::span<char>());
+    server.start();
+
+    std::map<int, uint64_t> injected_counts; // key = interface id
+
+    // what the server sent in response to `query`, once it was handled
+    auto send_query_on = [&](int interface_id, const Query& query, const Bj_net_source& source) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            sent.clear();
+        }
+        Query copy = query;
+        net.loopback_executor().invoke_sync([&]() {
+            net.inject(interface_id, std::span(copy.data, copy.size), source);
+        });
+        uint64_t injected_count = ++injected_counts[interface_id];
+        while (server.get_stats_snapshot()[interface_id].rx_packet_count < injected_count)
+            std::this_thread::yield();
+        std::unique_lock<std::mutex> lock(mutex);
+        return sent;
+    };
+    auto send_query = [&](const Query& query, const Bj_net_source& source) {
+        return send_query_on(interface_id, query, source);
+    };
+
+    auto only = [](const std::vector<Sent_packet>& packets, Bj_net_loopback_direction direction) {
+        return packets.size() == 1 && packets[0].direction == direction;
+    };
+
+    const Bj_net_source on_link = { Bj_net_address({ 192, 168, 23, 7 }), 5353 };
+    const Bj_net_source off_link = { Bj_net_address({ 10, 1, 2, 3 }), 5353 };
+    const Bj_net_source link_local = { Bj_net_address({ 0xfe, 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x07 }), 5353 };
+    Bj_net_source legacy = on_link;
+    legacy.port = 40000;
+    Bj_net_source off_link_legacy = off_link;
+    off_link_legacy.port = 40000;
+    Bj_net_source direct = on_link;
+    direct.direct = true;
+    Bj_net_source off_link_direct = off_link;
+    off_link_direct.direct = true;
+
+    std::string instance_name = bj_util::dns_name("Instance 0._bench0._tcp.local");
+    std::string host_name = bj_util::dns_name("BenchHost.local");
+    std::string mode = worker_count > 0 ? " (" + std::to_string(worker_count) + " workers)" : "";
+    printf("\nBj_server unicast responses%s\n", mode.c_str());
+
+    Query legacy_query = make_query({ { instance_name, U2_DNS_RR_TYPE_SRV }, { host_name, U2_DNS_RR_TYPE_A } }, 0x4a5b);
+    auto packets = send_query(legacy_query, legacy);
+    check(only(packets, Bj_net_loopback_direction::unicast_reply), "legacy query: one response, to the querier");
+    check(packets.size() == 1 && is_legacy_response(packets[0].data, legacy_query), "legacy query: ID and questions echoed, TTL <= 10, no cache-flush bit");
+    check(send_query(legacy_query, off_link_legacy).empty(), "legacy query from off-link: ignored");
+
+    // the first response is multicast, which makes the records recently multicast
+    Query qu_query = make_query({ { instance_name, U2_DNS_RR_TYPE_SRV } }, 0, true);
+    check(only(send_query(qu_query, on_link), Bj_net_loopback_direction::reply), "QU question, records not multicast recently: multicast");
+    check(only(send_query(qu_query, on_link), Bj_net_loopback_direction::unicast_reply), "QU question, records multicast recently: to the querier");
+    check(only(send_query(qu_query, link_local), Bj_net_loopback_direction::unicast_reply), "QU question from ipv6 link-local: to the querier");
+    check(only(send_query(qu_query, off_link), Bj_net_loopback_direction::reply), "QU question from off-link: multicast");
+    check(only(send_query(make_query(instance_name, U2_DNS_RR_TYPE_SRV), on_link), Bj_net_loopback_direction::reply), "QM question: multicast");
+
+    check(only(send_query(make_query(instance_name, U2_DNS_RR_TYPE_SRV), direct), Bj_net_loopback_direction::unicast_reply), "direct query: to the querier");
+    check(send_query(make_query(instance_name, U2_DNS_RR_TYPE_SRV), off_link_direct).empty(), "direct query from off-link: ignored");
+
+    Bj_stats stats = server.get_stats_snapshot()[interface_id];
+    check(stats.off_link_query_count == 2, "off-link queries counted");
+
+    // RFC 6762, section 6.2: the NSEC of the host only tells that an address family is missing
+    auto has = [](const std::vector<Sent_packet>& packets, int type) {
+        if (packets.size() != 1)
+            return false;
+        auto types = record_types(packets[0].data);
+        return std::find(types.begin(), types.end(), type) != types.end();
+    };
+    packets = send_query(make_query(host_name, U2_DNS_RR_TYPE_A), on_link);
+    check(has(packets, U2_DNS_RR_TYPE_AAAA) && !has(packets, U2_DNS_RR_TYPE_NSEC), "A question, dual-stack host: AAAA as additional record, no NSEC");
+    const Bj_net_source v4_only_on_link = { Bj_net_address({ 192, 168, 24, 7 }), 5353 };
+    packets = send_query_on(v4_only_interface_id, make_query(host_name, U2_DNS_RR_TYPE_A), v4_only_on_link);
+    check(!has(packets, U2_DNS_RR_TYPE_AAAA) && has(packets, U2_DNS_RR_TYPE_NSEC), "A question, ipv4 only host: NSEC as additional record");
+
+    server.stop();
+    return check_failure_count;
+}
+
+int main(int argc, const char *argv[])
+{
+    uint64_t min_time_ns = 200000000;
+    bool latency_tracking = false;
+    std::shared_ptr<Bj_capture> capture;
+    bool check_alloc = false;
+    bool check_unicast_only = false;
+    int worker_count = -1; // unset
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--min-time-ms") && i + 1 < argc) {
+            min_time_ns = (uint64_t)atoll(argv[++i]) * 1000000;
+        } else if (!strcmp(argv[i], "--latency")) {
+            latency_tracking = true;
+        } else if (!strcmp(argv[i], "--capture") && i + 1 < argc) {
+            capture = std::make_shared<Bj_capture>(argv[++i]);
+        } else if (!strcmp(argv[i], "--workers") && i + 1 < argc) {
+            worker_count = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--check-alloc")) {
+            check_alloc = true;
+        } else if (!strcmp(argv[i], "--check-unicast")) {
+            check_unicast_only = true;
+        } else {
+            fprintf(stderr, "usage: %s [--min-time-ms <ms>] [--latency] [--capture <file.pcapng>] [--workers <count>] [--check-alloc | --check-unicast]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (check_unicast_only) {
+        check_unicast(0);
+        check_unicast(worker_count > 0 ? worker_count : 2);
+        return check_failure_count > 0 ? 1 : 0;
+    }
+
+    bj_bench::print_header("Bj_server over loopback (rx -> query proc -> reply)", "instances");
+    for (int instance_count : { 1, 10, 100 })
+        bench_server(instance_count, latency_tracking, capture, min_time_ns);
+
+    if (worker_count < 0)
+        worker_count = check_alloc ? 2 : 0;
+    if (worker_count > 0) {
+        bj_bench::print_header("Bj_server over loopback with " + std::to_string(worker_count) + " workers (rx -> worker -> query proc -> reply)", "instances");
+        for (int instance_count : { 1, 10, 100 })
+            bench_server(instance_count, false, capture, min_time_ns, worker_count);
+    }
+
+    bj_bench::print_header("Bj_static_server over loopback (rx -> query proc -> reply)", "domains");
+    for (int domain_count : { 10, 100, 1000 })
+        bench_static_server(domain_count, capture, min_time_ns);
+
+    if (capture) {
+        Bj_capture_stats stats = capture->get_stats();
+        printf("\ncapture: %llu packets written, %llu lost (ring full), %llu rate limited, %llu size limited\n",
+               (unsigned long long)stats.captured_count,
+               (unsigned long long)stats.ring_full_count,
+               (unsigned long long)stats.rate_limited_count,
+               (unsigned long long)stats.size_limited_count);
+    }
+
+    if (check_alloc && allocating_case_count) {
+        fprintf(stderr, "\n%d cases allocate memory while handling queries\n", allocating_case_count);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+//
+//  bj_bench_util.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+namespace bj_bench
+{
+
+struct Result {
+    uint64_t op_count;
+    double elapsed_ns;
+
+    double ns_per_op() const {
+        return op_count ? elapsed_ns / (double)op_count : 0;
+    }
+
+    double ops_per_sec() const {
+        return elapsed_ns > 0 ? (double)op_count * 1e9 / elapsed_ns : 0;
+    }
+};
+
+inline uint64_t now_ns()
+{
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
+/**
+ * Run `op` repeatedly, by batches of growing size, until `min_time_ns` is
+ * elapsed. `op` must perform one operation and return a value depending on
+ * its work, so that the compiler cannot optimize it away.
+ */
+template <typename Op>
+Result measure(uint64_t min_time_ns, Op op)
+{
+    static volatile uint64_t sink;
+    uint64_t acc = 0;
+    uint64_t batch = 1;
+    uint64_t op_count = 0;
+    uint64_t start = now_ns();
+    uint64_t elapsed = 0;
+    while (elapsed < min_time_ns) {
+        for (uint64_t i = 0; i < batch; i++) {
+            acc += (uint64_t)op();
+        }
+        op_count += batch;
+        elapsed = now_ns() - start;
+        if (batch < (1u << 20))
+            batch *= 2;
+    }
+    sink = acc;
+    return Result { op_count, (double)elapsed };
+}
+
+inline void print_header(std::string_view title, const char *size_label = "domains")
+{
+    printf("\n%.*s\n", (int)title.size(), title.data());
+    printf("  %-44s %10s %14s %14s\n", "case", size_label, "ns/query", "queries/s");
+}
+
+inline void print_result(std::string_view name, int size, const Result& result)
+{
+    printf("  %-44.*s %10d %14.1f %14.0f\n", (int)name.size(), name.data(), size, result.ns_per_op(), result.ops_per_sec());
+    fflush(stdout);
+}
+
+} // namespace
@@ -0,0 +1,289 @@
+//
+//  bj_load.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bj_load_generator.h"
+#include "bj_net_group_linux.h"
+#include "bj_net_single_linux.h"
+#include "bj_net_uring_linux.h"
+#include "bj_net_xdp_linux.h"
+#include "bj_server.h"
+#include "u2_dns.h"
+
+/*
+ * Open-loop load test of an mDNS responder over real UDP multicast sockets.
+ *
+ * Usage: bj_load [--address <ipv4>] [--instances <count>] [--type <service type>]
+ *                [--duration-ms <ms>] [--start-rate <qps>] [--max-rate <qps>]
+ *                [--loss-threshold <percent>] [--pid <responder pid> | --server [--unbatched | --uring | --shared | --xdp <interface>] [--workers <count>] [--unfiltered]]
+ *
+ * The responder must announce the instances "Load 0" ... "Load <count-1>" of
+ * the given service type (default _load._tcp) on the interface having the
+ * given address. SRV queries for these instances are sent at increasing
+ * rates, each step lasting --duration-ms, and for each step the achieved
+ * rate, the response loss and the latency percentiles are printed.
+ *
+ * The saturation point is the highest rate at which the loss stays below the
+ * threshold (default 1%) and the sender keeps up with the offered rate. With
+ * --pid, the CPU time used by the responder process is sampled around each
+ * step, which gives the number of queries per second a single core can
+ * sustain.
+ *
+ * With --server, the responder is a Bj_server running in this process over
+ * Bj_net_single_linux on the given interface, and the CPU time is the one
+ * of its executor thread. --unbatched disables the recvmmsg/sendmmsg I/O of
+ * the backend, for comparison. With --uring, the server runs over
+ * Bj_net_uring_linux instead, on all the multicast interfaces. With --shared,
+ * it runs over Bj_net_group_linux in shared socket mode. With --xdp, it runs
+ * over Bj_net_xdp_linux on the given interface, which must not be the one
+ * having --address: the queries have to go through the wire, or through a
+ * veth pair, to reach the XDP program. --workers processes
+ * the queries on that many worker threads (Bj_server::set_worker_count()),
+ * the queries per second per core are not reported then. --unfiltered
+ * disables the socket filter dropping the responses in the kernel. At the
+ * end, the backend reports, per interface, the datagrams the kernel dropped
+ * and the delay between their arrival in the kernel and their handling.
+ * The drops only count the socket queue overflows with --unfiltered,
+ * otherwise they also include the responses the filter rejected.
+ */
+
+static const uint64_t drain_ns = 200000000;
+
+static Bj_net_address parse_address(const char *str)
+{
+    int a, b, c, d;
+    if (sscanf(str, "%d.%d.%d.%d", &a, &b, &c, &d) != 4)
+        throw std::invalid_argument(std::string("invalid ipv4 address: ") + str);
+    return Bj_net_address({ (unsigned char)a, (unsigned char)b, (unsigned char)c, (unsigned char)d });
+}
+
+static double clock_time(clockid_t clock)
+{
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0)
+        return -1;
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// user + system time of a process, in seconds, negative if unknown
+static double process_cpu_time(int pid)
+{
+    std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat;
+    if (!std::getline(file, stat))
+        return -1;
+    // the command name may contain spaces, fields are counted after it
+    size_t pos = stat.rfind(')');
+    if (pos == std::string::npos)
+        return -1;
+    unsigned long long utime, stime;
+    if (sscanf(stat.c_str() + pos + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2)
+        return -1;
+    return (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [--address <ipv4>] [--instances <count>] [--type <service type>] [--duration-ms <ms>]\n"
+                    "       [--start-rate <qps>] [--max-rate <qps>] [--loss-threshold <percent>] [--pid <responder pid> | --server [--unbatched | --uring | --shared | --xdp <interface>] [--workers <count>] [--unfiltered]]\n", name);
+}
+
+int main(int argc, const char *argv[])
+{
+    const char *address = "127.0.0.1";
+    const char *service_type = "_load._tcp";
+    int instance_count = 64;
+    int duration_ms = 2000;
+    double start_rate = 1000;
+    double max_rate = 1000000;
+    double loss_threshold = 1;
+    int pid = 0;
+    bool in_process_server = false;
+    bool batched_io = true;
+    bool query_filter = true;
+    bool uring = false;
+    bool shared_socket = false;
+    const char *xdp_interface = nullptr;
+    int worker_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--address") && i + 1 < argc) {
+            address = argv[++i];
+        } else if (!strcmp(argv[i], "--instances") && i + 1 < argc) {
+            instance_count = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--type") && i + 1 < argc) {
+            service_type = argv[++i];
+        } else if (!strcmp(argv[i], "--duration-ms") && i + 1 < argc) {
+            duration_ms = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--start-rate") && i + 1 < argc) {
+            start_rate = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-rate") && i + 1 < argc) {
+            max_rate = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--loss-threshold") && i + 1 < argc) {
+            loss_threshold = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--pid") && i + 1 < argc) {
+            pid = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--server")) {
+            in_process_server = true;
+        } else if (!strcmp(argv[i], "--unbatched")) {
+            batched_io = false;
+        } else if (!strcmp(argv[i], "--unfiltered")) {
+            query_filter = false;
+        } else if (!strcmp(argv[i], "--uring")) {
+            uring = true;
+        } else if (!strcmp(argv[i], "--shared")) {
+            shared_socket = true;
+        } else if (!strcmp(argv[i], "--xdp") && i + 1 < argc) {
+            xdp_interface = argv[++i];
+        } else if (!strcmp(argv[i], "--workers") && i + 1 < argc) {
+            worker_count = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (instance_count < 1 || duration_ms < 1 || start_rate <= 0 || max_rate < start_rate || (pid && in_process_server)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    for (int i = 0; i < instance_count; i++)
+        names.push_back("Load " + std::to_string(i) + "." + service_type + ".local");
+
+    try {
+        Bj_net_address interface_address = parse_address(address);
+
+        std::function<double()> cpu_time;
+        if (pid)
+            cpu_time = [pid]() { return process_cpu_time(pid); };
+
+        std::unique_ptr<Bj_net> net;
+        std::unique_ptr<Bj_server> server;
+        if (in_process_server) {
+            if (uring) {
+                auto uring_net = std::make_unique<Bj_net_uring_linux>();
+                uring_net->set_query_filter(query_filter);
+                net = std::move(uring_net);
+            } else if (shared_socket) {
+                auto group = std::make_unique<Bj_net_group_linux>();
+                group->set_shared_socket(true);
+                group->set_query_filter(query_filter);
+                net = std::move(group);
+            } else if (xdp_interface) {
+                net = std::make_unique<Bj_net_xdp_linux>(xdp_interface);
+            } else {
+                auto single = std::make_unique<Bj_net_single_linux>(interface_address, std::vector<Bj_net_address> { interface_address }, true);
+                single->set_batched_io(batched_io);
+                single->set_query_filter(query_filter);
+                net = std::move(single);
+            }
+            server = std::make_unique<Bj_server>("LoadHost", *net);
+            server->set_worker_count(worker_count);
+            for (int i = 0; i < instance_count; i++)
+                server->register_service("Load " + std::to_string(i), service_type, (uint16_t)(1000 + i), std::span<char>());
+            server->start();
+
+            if (worker_count == 0) {
+                clockid_t clock;
+                static_cast<const Bj_net_executor_linux&>(net->executor()).invoke_sync([&]() {
+                    pthread_getcpuclockid(pthread_self(), &clock);
+                });
+                cpu_time = [clock]() { return clock_time(clock); };
+            }
+        }
+
+        Bj_load_generator generator(interface_address, names, U2_DNS_RR_TYPE_SRV);
+
+        printf("%12s %12s %10s %8s %10s %10s %10s %10s %12s\n",
+               "offered/s", "sent/s", "received", "loss%", "p50 us", "p99 us", "p99.9 us", "max us", "qps/core");
+
+        double saturation_rate = 0;
+        double saturation_qps_per_core = 0;
+        for (double rate = start_rate; rate <= max_rate; rate *= 1.5) {
+            double cpu_start = cpu_time ? cpu_time() : -1;
+            Bj_load_step step = generator.run(rate, (uint64_t)duration_ms * 1000000, drain_ns);
+            double cpu_end = cpu_time ? cpu_time() : -1;
+
+            // the cpu time of the responder also covers the drain period, during which it is idle
+            double qps_per_core = 0;
+            if (cpu_start >= 0 && cpu_end > cpu_start)
+                qps_per_core = (double)step.received_count / (cpu_end - cpu_start);
+
+            printf("%12.0f %12.0f %10llu %8.2f %10.1f %10.1f %10.1f %10.1f %12.0f\n",
+                   step.offered_rate, step.sent_rate, (unsigned long long)step.received_count, step.loss() * 100,
+                   step.latency.get_percentile(50) / 1e3, step.latency.get_percentile(99) / 1e3,
+                   step.latency.get_percentile(99.9) / 1e3, step.latency.get_max() / 1e3, qps_per_core);
+            fflush(stdout);
+
+            bool keeps_up = step.sent_rate >= 0.95 * step.offered_rate;
+            if (step.loss() * 100 > loss_threshold || !keeps_up) {
+                if (!keeps_up)
+                    printf("the load generator cannot keep up, stopping\n");
+                break;
+            }
+            saturation_rate = step.offered_rate;
+            saturation_qps_per_core = qps_per_core;
+        }
+
+        if (saturation_rate > 0) {
+            printf("saturation point: %.0f queries/s with less than %.2f%% loss", saturation_rate, loss_threshold);
+            if (saturation_qps_per_core > 0)
+                printf(", %.0f queries/s per core", saturation_qps_per_core);
+            printf("\n");
+        } else {
+            printf("saturation point: none, the loss threshold is exceeded at the start rate\n");
+        }
+
+        // tells whether the queries lost were dropped by the kernel or answered too late
+        if (net) {
+            for (auto& [interface_id, rx_stats] : net->get_rx_stats()) {
+                printf("interface %d: %llu datagrams dropped by the kernel%s, receive delay p50 %.1f us, p99 %.1f us, max %.1f us\n",
+                       interface_id, (unsigned long long)rx_stats.drop_count,
+                       rx_stats.filtered ? " (overflows and query filter rejections)" : " (overflows)",
+                       rx_stats.delay.get_percentile(50) / 1e3, rx_stats.delay.get_percentile(99) / 1e3, rx_stats.delay.get_max() / 1e3);
+            }
+        }
+
+        if (server)
+            server->stop();
+    } catch (std::exception& exc) {
+        fprintf(stderr, "%s\n", exc.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+//
+//  bj_load_generator.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <thread>
+#include "bj_load_generator.h"
+#include "bj_util.h"
+#include "u2_dns.h"
+
+static uint64_t monotonic_ns()
+{
+    return bj_util::monotonic_ns();
+}
+
+static void sleep_until(uint64_t time_ns)
+{
+    // same clock as std::chrono::steady_clock on Linux
+    struct timespec ts = {
+        .tv_sec = (time_t)(time_ns / 1000000000),
+        .tv_nsec = (long)(time_ns % 1000000000),
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+Bj_load_generator::Bj_load_generator(const Bj_net_address& interface_address, const std::vector<std::string>& names, int type)
+    : send_times(names.size())
+{
+    if (interface_address.protocol != Bj_net_protocol::ipv4)
+        throw std::invalid_argument("the load generator supports ipv4 only");
+    if (names.empty())
+        throw std::invalid_argument("no name to query");
+
+    for (size_t i = 0; i < names.size(); i++) {
+        std::string name = bj_util::dns_name(names[i]);
+        name_index[name] = (int)i;
+
+        Query query;
+        struct u2_dns_msg_builder builder;
+        u2_dns_msg_builder_init(&builder, query.data, sizeof(query.data), 0, 0);
+        u2_dns_msg_builder_add_question(&builder, name.c_str(), type, false);
+        query.size = u2_dns_msg_builder_get_size(&builder);
+        queries.push_back(query);
+    }
+
+    struct in_addr group;
+    inet_pton(AF_INET, "224.0.0.251", &group);
+    struct in_addr interface;
+    memcpy(&interface.s_addr, interface_address.ipv4.data(), 4);
+    int one = 1;
+    int zero = 0;
+
+    try {
+        // tx socket: sends from port 5353, like any mDNS querier, and never receives
+        tx_socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (tx_socket < 0)
+            throw std::runtime_error("cannot create tx socket");
+        setsockopt(tx_socket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(tx_socket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+#ifdef IP_MULTICAST_ALL
+        setsockopt(tx_socket, IPPROTO_IP, IP_MULTICAST_ALL, &zero, sizeof(zero));
+#endif
+        struct sockaddr_in tx_addr = {};
+        tx_addr.sin_family = AF_INET;
+        tx_addr.sin_port = htons(5353);
+        tx_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(tx_socket, (struct sockaddr *)&tx_addr, sizeof(tx_addr)) != 0)
+            throw std::runtime_error("cannot bind tx socket, errno=" + std::to_string(errno));
+        if (setsockopt(tx_socket, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) != 0)
+            throw std::runtime_error("cannot set multicast output interface");
+        unsigned char loop = 1;
+        setsockopt(tx_socket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        shutdown(tx_socket, SHUT_RD);
+
+        // rx socket: bound to the group, so that it gets multicast traffic only
+        rx_socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (rx_socket < 0)
+            throw std::runtime_error("cannot create rx socket");
+        setsockopt(rx_socket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(rx_socket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+        int buffer_size = 4 << 20;
+        setsockopt(rx_socket, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+        struct timeval timeout = { .tv_sec = 0, .tv_usec = 10000 };
+        setsockopt(rx_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        struct sockaddr_in rx_addr = {};
+        rx_addr.sin_family = AF_INET;
+        rx_addr.sin_port = htons(5353);
+        rx_addr.sin_addr = group;
+        if (bind(rx_socket, (struct sockaddr *)&rx_addr, sizeof(rx_addr)) != 0)
+            throw std::runtime_error("cannot bind rx socket, errno=" + std::to_string(errno));
+        struct ip_mreq mreq = {};
+        mreq.imr_multiaddr = group;
+        mreq.imr_interface = interface;
+        if (setsockopt(rx_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+            throw std::runtime_error("cannot join multicast group, errno=" + std::to_string(errno));
+    } catch (...) {
+        close_sockets();
+        throw;
+    }
+}
+
+Bj_load_generator::~Bj_load_generator()
+{
+    close_sockets();
+}
+
+void Bj_load_generator::close_sockets()
+{
+    if (tx_socket >= 0)
+        ::close(tx_socket);
+    if (rx_socket >= 0)
+        ::close(rx_socket);
+    tx_socket = -1;
+    rx_socket = -1;
+}
+
+Bj_load_step Bj_load_generator::run(double rate, uint64_t duration_ns, uint64_t drain_ns)
+{
+    Bj_load_step step = {};
+    step.offered_rate = rate;
+
+    for (auto& send_time : send_times)
+        send_time.store(0, std::memory_order_relaxed);
+
+    receiving = true;
+    std::thread receiver(&Bj_load_generator::receive, this, std::ref(step));
+
+    struct sockaddr_in group_addr = {};
+    group_addr.sin_family = AF_INET;
+    group_addr.sin_port = htons(5353);
+    inet_pton(AF_INET, "224.0.0.251", &group_addr.sin_addr);
+
+    uint64_t count = (uint64_t)(rate * (double)duration_ns / 1e9);
+    uint64_t start = monotonic_ns() + 1000000;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t scheduled = start + (uint64_t)((double)i * 1e9 / rate);
+        if (monotonic_ns() < scheduled)
+            sleep_until(scheduled);
+        size_t q = i % queries.size();
+        send_times[q].store(scheduled, std::memory_order_release);
+        sendto(tx_socket, queries[q].data, queries[q].size, 0, (struct sockaddr *)&group_addr, sizeof(group_addr));
+    }
+    uint64_t end = monotonic_ns();
+    step.sent_count = count;
+    step.sent_rate = end > start ? (double)count * 1e9 / (double)(end - start) : 0;
+
+    sleep_until(end + drain_ns);
+    receiving = false;
+    receiver.join();
+
+    return step;
+}
+
+void Bj_load_generator::receive(Bj_load_step& step)
+{
+    unsigned char buf[9000];
+    while (receiving) {
+        ssize_t size = recv(rx_socket, buf, sizeof(buf), 0);
+        if (size <= 0)
+            continue;
+        uint64_t now = monotonic_ns();
+
+        struct u2_dns_msg_reader reader;
+        if (u2_dns_msg_reader_init(&reader, buf, size) < 0)
+            continue;
+        if (!(u2_dns_msg_reader_get_flags(&reader) & U2_DNS_MSG_FLAG_QR))
+            continue; // our own queries
+        if (u2_dns_msg_reader_get_answer_rr_count(&reader) < 1)
+            continue;
+
+        struct u2_dns_msg_entry entry;
+        if (u2_dns_msg_reader_get_entry(&reader, u2_dns_msg_reader_get_question_count(&reader), &entry) < 0)
+            continue;
+        char name[256];
+        u2_dns_name_init(name, sizeof(name));
+        if (!u2_dns_name_append_compressed_name(name, sizeof(name), entry.data, entry.name_pos))
+            continue;
+
+        auto it = name_index.find(std::string(name, u2_dns_name_length(name)));
+        if (it == name_index.end())
+            continue; // unsolicited announcement or other traffic
+
+        uint64_t scheduled = send_times[it->second].exchange(0, std::memory_order_acquire);
+        if (scheduled == 0 || scheduled > now) {
+            step.unmatched_count++;
+            continue;
+        }
+        step.received_count++;
+        step.latency.record(now - scheduled);
+    }
+}
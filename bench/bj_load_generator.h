@@ -0,0 +1,90 @@
+//
+//  bj_load_generator.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "bj_histogram.h"
+#include "bj_net.h"
+
+struct Bj_load_step {
+    double offered_rate;      // queries per second
+    double sent_rate;         // really achieved by the sender
+    uint64_t sent_count;
+    uint64_t received_count;  // responses matched to a query
+    uint64_t unmatched_count; // responses for a name without query in flight (late or duplicate)
+    Bj_histogram latency;     // from the scheduled send time, in nanoseconds
+
+    double loss() const {
+        return sent_count ? 1.0 - (double)received_count / (double)sent_count : 0;
+    }
+};
+
+/**
+ * Open-loop mDNS load generator over real UDP multicast sockets.
+ *
+ * Queries for a set of names are sent at a fixed rate to 224.0.0.251:5353
+ * from port 5353, on the interface having the given address, and the
+ * multicast responses are received on the same interface. A response is
+ * matched to a query by the name of its first answer record: names are used
+ * in turn, so a latency is unambiguous as long as it is shorter than the
+ * time needed to cycle through all names.
+ *
+ * Latencies are measured from the time at which each query was scheduled,
+ * not from the time it was really sent, so that a late sender does not hide
+ * queueing delays (coordinated omission).
+ */
+class Bj_load_generator {
+public:
+    // names are dotted, the responder must own them
+    Bj_load_generator(const Bj_net_address& interface_address, const std::vector<std::string>& names, int type);
+    ~Bj_load_generator();
+
+    Bj_load_generator(const Bj_load_generator&) = delete;
+    Bj_load_generator& operator= (const Bj_load_generator&) = delete;
+
+    // send at the given rate during `duration_ns`, then wait `drain_ns` for late responses
+    Bj_load_step run(double rate, uint64_t duration_ns, uint64_t drain_ns);
+
+private:
+    struct Query {
+        unsigned char data[512];
+        size_t size;
+    };
+
+    int tx_socket = -1;
+    int rx_socket = -1;
+    std::vector<Query> queries;
+    std::map<std::string, int> name_index; // key = name in u2 format
+    std::vector<std::atomic<uint64_t>> send_times; // scheduled send time of the query in flight, 0 if none
+    std::atomic<bool> receiving = false;
+
+    void receive(Bj_load_step& step);
+    void close_sockets();
+};
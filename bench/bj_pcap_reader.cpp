@@ -0,0 +1,329 @@
+//
+//  bj_pcap_reader.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <cstring>
+#include <stdexcept>
+#include "bj_pcap_reader.h"
+
+static const uint32_t pcap_magic_us = 0xA1B2C3D4;
+static const uint32_t pcap_magic_ns = 0xA1B23C4D;
+static const uint32_t pcapng_section_header_block = 0x0A0D0D0A;
+static const uint32_t pcapng_interface_description_block = 0x00000001;
+static const uint32_t pcapng_simple_packet_block = 0x00000003;
+static const uint32_t pcapng_enhanced_packet_block = 0x00000006;
+static const uint32_t pcapng_byte_order_magic = 0x1A2B3C4D;
+
+static const int linktype_null = 0;
+static const int linktype_ethernet = 1;
+static const int linktype_raw = 101;
+static const int linktype_linux_sll = 113;
+static const int linktype_ipv4 = 228;
+static const int linktype_ipv6 = 229;
+static const int linktype_linux_sll2 = 276;
+
+static uint16_t be16(const unsigned char *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint64_t ticks_to_ns(uint64_t ticks, uint64_t ticks_per_second)
+{
+    if (ticks_per_second == 1000000000)
+        return ticks;
+    return ticks / ticks_per_second * 1000000000 + ticks % ticks_per_second * 1000000000 / ticks_per_second;
+}
+
+Bj_pcap_reader::Bj_pcap_reader(const std::string& path)
+{
+    file = fopen(path.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("cannot open " + path);
+
+    unsigned char header[24];
+    if (!read(header, 4)) {
+        fclose(file);
+        throw std::runtime_error("empty file " + path);
+    }
+
+    uint32_t magic;
+    memcpy(&magic, header, 4);
+    if (magic == pcapng_section_header_block) {
+        pcapng = true;
+        rewind(file);
+        return;
+    }
+
+    uint64_t ticks_per_second;
+    if (magic == pcap_magic_us || __builtin_bswap32(magic) == pcap_magic_us) {
+        ticks_per_second = 1000000;
+    } else if (magic == pcap_magic_ns || __builtin_bswap32(magic) == pcap_magic_ns) {
+        ticks_per_second = 1000000000;
+    } else {
+        fclose(file);
+        throw std::runtime_error("not a pcap or pcapng file: " + path);
+    }
+    swapped = magic != pcap_magic_us && magic != pcap_magic_ns;
+
+    if (!read(header + 4, 20)) {
+        fclose(file);
+        throw std::runtime_error("truncated pcap header: " + path);
+    }
+    interfaces.push_back({ .link_type = (int)(u32(header + 20) & 0xFFFF), .ticks_per_second = ticks_per_second });
+}
+
+Bj_pcap_reader::~Bj_pcap_reader()
+{
+    fclose(file);
+}
+
+bool Bj_pcap_reader::next(Bj_pcap_packet& packet)
+{
+    for (;;) {
+        int interface_index;
+        uint64_t timestamp;
+        bool more = pcapng ? next_pcapng(interface_index, timestamp, block) : next_pcap(interface_index, timestamp, block);
+        if (!more)
+            return false;
+
+        if (interface_index < 0 || interface_index >= (int)interfaces.size()) {
+            skipped_count++;
+            continue;
+        }
+
+        const Interface& interface = interfaces[interface_index];
+        if (!extract_payload(interface.link_type, block, packet.payload)) {
+            skipped_count++;
+            continue;
+        }
+
+        packet.timestamp_ns = ticks_to_ns(timestamp, interface.ticks_per_second);
+        return true;
+    }
+}
+
+bool Bj_pcap_reader::read(void *data, size_t size)
+{
+    return fread(data, 1, size, file) == size;
+}
+
+uint16_t Bj_pcap_reader::u16(const unsigned char *p) const
+{
+    uint16_t value;
+    memcpy(&value, p, 2);
+    return swapped ? __builtin_bswap16(value) : value;
+}
+
+uint32_t Bj_pcap_reader::u32(const unsigned char *p) const
+{
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return swapped ? __builtin_bswap32(value) : value;
+}
+
+bool Bj_pcap_reader::next_pcap(int& interface_index, uint64_t& timestamp, std::vector<unsigned char>& frame)
+{
+    unsigned char header[16];
+    if (!read(header, sizeof(header)))
+        return false;
+
+    uint32_t captured_length = u32(header + 8);
+    if (captured_length > (1 << 24))
+        throw std::runtime_error("corrupted pcap file");
+
+    frame.resize(captured_length);
+    if (!read(frame.data(), captured_length))
+        return false;
+
+    interface_index = 0;
+    timestamp = (uint64_t)u32(header) * interfaces[0].ticks_per_second + u32(header + 4);
+    return true;
+}
+
+bool Bj_pcap_reader::next_pcapng(int& interface_index, uint64_t& timestamp, std::vector<unsigned char>& frame)
+{
+    std::vector<unsigned char> body;
+
+    for (;;) {
+        unsigned char header[8];
+        if (!read(header, sizeof(header)))
+            return false;
+
+        uint32_t type;
+        memcpy(&type, header, 4);
+
+        if (type == pcapng_section_header_block) {
+            // the byte order magic tells the byte order of the whole section
+            unsigned char magic[4];
+            if (!read(magic, 4))
+                return false;
+            uint32_t value;
+            memcpy(&value, magic, 4);
+            if (value == pcapng_byte_order_magic)
+                swapped = false;
+            else if (__builtin_bswap32(value) == pcapng_byte_order_magic)
+                swapped = true;
+            else
+                throw std::runtime_error("corrupted pcapng section header");
+            interfaces.clear();
+            uint32_t length = u32(header + 4);
+            if (length < 28 || length % 4)
+                throw std::runtime_error("corrupted pcapng section header");
+            body.resize(length - 12);
+            if (!read(body.data(), body.size()))
+                return false;
+            continue;
+        }
+
+        type = u32(header);
+        uint32_t length = u32(header + 4);
+        if (length < 12 || length % 4 || length > (1 << 24))
+            throw std::runtime_error("corrupted pcapng block");
+
+        body.resize(length - 8);
+        if (!read(body.data(), body.size()))
+            return false;
+        size_t body_size = body.size() - 4; // without the trailing length
+
+        if (type == pcapng_interface_description_block) {
+            add_pcapng_interface(body.data(), body_size);
+        } else if (type == pcapng_enhanced_packet_block && body_size >= 20) {
+            uint32_t captured_length = u32(&body[12]);
+            if (20 + captured_length > body_size)
+                throw std::runtime_error("corrupted pcapng packet block");
+            interface_index = (int)u32(&body[0]);
+            timestamp = ((uint64_t)u32(&body[4]) << 32) | u32(&body[8]);
+            last_timestamp = timestamp;
+            frame.assign(body.begin() + 20, body.begin() + 20 + captured_length);
+            return true;
+        } else if (type == pcapng_simple_packet_block && body_size >= 4) {
+            // no timestamp, this is the best we can do
+            interface_index = 0;
+            timestamp = last_timestamp;
+            frame.assign(body.begin() + 4, body.begin() + body_size);
+            return true;
+        }
+    }
+}
+
+void Bj_pcap_reader::add_pcapng_interface(const unsigned char *body, size_t size)
+{
+    Interface interface = { .link_type = size >= 2 ? u16(body) : -1, .ticks_per_second = 1000000 };
+
+    size_t pos = 8;
+    while (pos + 4 <= size) {
+        uint16_t code = u16(body + pos);
+        uint16_t length = u16(body + pos + 2);
+        if (code == 0 || pos + 4 + length > size)
+            break;
+        if (code == 9 && length >= 1) {
+            // if_tsresol
+            uint8_t resolution = body[pos + 4];
+            uint64_t ticks = 1;
+            for (int i = 0; i < (resolution & 0x7F); i++)
+                ticks *= (resolution & 0x80) ? 2 : 10;
+            interface.ticks_per_second = ticks;
+        }
+        pos += 4 + ((length + 3) & ~3);
+    }
+
+    interfaces.push_back(interface);
+}
+
+bool Bj_pcap_reader::extract_payload(int link_type, const std::vector<unsigned char>& frame, std::vector<unsigned char>& payload) const
+{
+    const unsigned char *data = frame.data();
+    size_t size = frame.size();
+    size_t pos;
+
+    switch (link_type) {
+        case linktype_ethernet: {
+            if (size < 14)
+                return false;
+            uint16_t ethertype = be16(data + 12);
+            pos = 14;
+            while (ethertype == 0x8100 || ethertype == 0x88A8) {
+                if (size < pos + 4)
+                    return false;
+                ethertype = be16(data + pos + 2);
+                pos += 4;
+            }
+            if (ethertype != 0x0800 && ethertype != 0x86DD)
+                return false;
+            break;
+        }
+        case linktype_linux_sll:
+            pos = 16;
+            break;
+        case linktype_linux_sll2:
+            pos = 20;
+            break;
+        case linktype_null:
+            pos = 4;
+            break;
+        case linktype_raw:
+        case linktype_ipv4:
+        case linktype_ipv6:
+            pos = 0;
+            break;
+        default:
+            return false;
+    }
+
+    if (size < pos + 1)
+        return false;
+
+    size_t udp_pos;
+    int version = data[pos] >> 4;
+    if (version == 4) {
+        if (size < pos + 20)
+            return false;
+        size_t header_size = (data[pos] & 0x0F) * 4;
+        if (data[pos + 9] != 17)
+            return false;
+        if (be16(data + pos + 6) & 0x3FFF)
+            return false; // fragment
+        udp_pos = pos + header_size;
+    } else if (version == 6) {
+        if (size < pos + 40)
+            return false;
+        if (data[pos + 6] != 17)
+            return false; // extension headers are not supported
+        udp_pos = pos + 40;
+    } else {
+        return false;
+    }
+
+    if (size < udp_pos + 8)
+        return false;
+    if (be16(data + udp_pos + 2) != 5353)
+        return false;
+    size_t udp_length = be16(data + udp_pos + 4);
+    if (udp_length < 8 || size < udp_pos + udp_length)
+        return false;
+
+    payload.assign(data + udp_pos + 8, data + udp_pos + udp_length);
+    return true;
+}
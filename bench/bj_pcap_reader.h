@@ -0,0 +1,77 @@
+//
+//  bj_pcap_reader.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct Bj_pcap_packet {
+    uint64_t timestamp_ns;
+    std::vector<unsigned char> payload; // UDP payload
+};
+
+/**
+ * Reader of pcap and pcapng files, returning the UDP payloads sent to port
+ * 5353. Supported link types: Ethernet (with VLAN tags), raw IP, Linux
+ * cooked (v1 and v2) and BSD loopback, over IPv4 or IPv6. Fragmented and
+ * truncated packets are skipped.
+ */
+class Bj_pcap_reader {
+public:
+    explicit Bj_pcap_reader(const std::string& path);
+    ~Bj_pcap_reader();
+    Bj_pcap_reader(const Bj_pcap_reader&) = delete;
+    Bj_pcap_reader& operator=(const Bj_pcap_reader&) = delete;
+
+    // false at end of file
+    bool next(Bj_pcap_packet& packet);
+
+    uint64_t get_skipped_count() const { return skipped_count; }
+
+private:
+    struct Interface {
+        int link_type;
+        uint64_t ticks_per_second;
+    };
+
+    FILE *file;
+    bool pcapng = false;
+    bool swapped = false;
+    std::vector<Interface> interfaces; // one for classic pcap
+    std::vector<unsigned char> block;
+    uint64_t last_timestamp = 0;
+    uint64_t skipped_count = 0;
+
+    bool read(void *data, size_t size);
+    uint16_t u16(const unsigned char *p) const;
+    uint32_t u32(const unsigned char *p) const;
+    bool next_pcap(int& interface_index, uint64_t& timestamp, std::vector<unsigned char>& frame);
+    bool next_pcapng(int& interface_index, uint64_t& timestamp, std::vector<unsigned char>& frame);
+    void add_pcapng_interface(const unsigned char *body, size_t size);
+    bool extract_payload(int link_type, const std::vector<unsigned char>& frame, std::vector<unsigned char>& payload) const;
+};
@@ -0,0 +1,298 @@
+//
+//  bj_replay.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bj_bench_alloc.h"
+#include "bj_bench_report.h"
+#include "bj_bench_util.h"
+#include "bj_net_loopback.h"
+#include "bj_pcap_reader.h"
+#include "bj_server.h"
+#include "u2_dns_dump.h"
+
+/*
+ * Replay of a capture of real mDNS traffic into a Bj_server.
+ *
+ * Usage: bj_replay <capture.pcap|capture.pcapng> [--services <file>] [--host <name>]
+ *                  [--address <ipv4>] [--realtime] [--loop <count>] [--dump]
+ *                  [--capture <file.pcapng>] [--top <count>]
+ *
+ * All UDP packets sent to port 5353 are injected into a single interface of
+ * a Bj_server running over the loopback network, as fast as possible or, with
+ * --realtime, at the recorded pace. The server announces the services listed
+ * in the services file, one per line:
+ *
+ *   <instance name> TAB <service type> TAB <port> [TAB <txt entry>]...
+ *
+ * For example "Office Printer\t_ipp._tcp\t631\trp=ipp/print". Empty lines and
+ * lines starting with '#' are ignored.
+ *
+ * The report gives the throughput, the latency percentiles, the number of
+ * output packets and bytes and the server statistics. With --dump, every
+ * response is printed too, which is useful to check what the server would
+ * have answered to the recorded traffic. With --top, the most frequent
+ * questions (name, type) are listed, including the ones about names the
+ * server does not own.
+ */
+
+static const int inject_batch = 1000;
+
+struct Service {
+    std::string instance_name;
+    std::string service_name;
+    uint16_t port;
+    std::string txt_record;
+};
+
+static std::vector<std::string> split(const std::string& line, char separator)
+{
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;) {
+        size_t end = line.find(separator, start);
+        fields.push_back(line.substr(start, end - start));
+        if (end == std::string::npos)
+            return fields;
+        start = end + 1;
+    }
+}
+
+static std::vector<Service> load_services(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error("cannot open " + path);
+
+    std::vector<Service> services;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        if (line.empty() || line[0] == '#')
+            continue;
+        auto fields = split(line, '\t');
+        if (fields.size() < 3)
+            throw std::runtime_error(path + ":" + std::to_string(line_number) + ": expecting instance, service and port");
+        Service service = {
+            .instance_name = fields[0],
+            .service_name = fields[1],
+            .port = (uint16_t)atoi(fields[2].c_str()),
+        };
+        // TXT rdata: sequence of length prefixed strings
+        for (size_t i = 3; i < fields.size(); i++) {
+            if (fields[i].size() > 255)
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": txt entry too long");
+            service.txt_record.push_back((char)fields[i].size());
+            service.txt_record += fields[i];
+        }
+        services.push_back(service);
+    }
+    return services;
+}
+
+static Bj_net_address parse_address(const char *str)
+{
+    int a, b, c, d;
+    if (sscanf(str, "%d.%d.%d.%d", &a, &b, &c, &d) != 4)
+        throw std::invalid_argument(std::string("invalid ipv4 address: ") + str);
+    return Bj_net_address({ (unsigned char)a, (unsigned char)b, (unsigned char)c, (unsigned char)d });
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s <capture.pcap|capture.pcapng> [--services <file>] [--host <name>] [--address <ipv4>]\n"
+                    "       [--realtime] [--loop <count>] [--dump] [--capture <file.pcapng>] [--top <count>]\n", name);
+}
+
+int main(int argc, const char *argv[])
+{
+    const char *input_path = nullptr;
+    const char *services_path = nullptr;
+    const char *host_name = "ReplayHost";
+    const char *address = "192.168.1.1";
+    const char *capture_path = nullptr;
+    bool realtime = false;
+    bool dump = false;
+    int loop_count = 1;
+    int top_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--services") && i + 1 < argc) {
+            services_path = argv[++i];
+        } else if (!strcmp(argv[i], "--host") && i + 1 < argc) {
+            host_name = argv[++i];
+        } else if (!strcmp(argv[i], "--address") && i + 1 < argc) {
+            address = argv[++i];
+        } else if (!strcmp(argv[i], "--capture") && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (!strcmp(argv[i], "--loop") && i + 1 < argc) {
+            loop_count = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--top") && i + 1 < argc) {
+            top_count = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--realtime")) {
+            realtime = true;
+        } else if (!strcmp(argv[i], "--dump")) {
+            dump = true;
+        } else if (argv[i][0] != '-' && !input_path) {
+            input_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!input_path || loop_count < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // load everything first, so that file access does not disturb the measure
+
+    std::vector<Bj_pcap_packet> packets;
+    std::vector<Service> services;
+    uint64_t skipped_count;
+    try {
+        Bj_pcap_reader reader(input_path);
+        Bj_pcap_packet packet;
+        while (reader.next(packet))
+            packets.push_back(packet);
+        skipped_count = reader.get_skipped_count();
+        if (services_path)
+            services = load_services(services_path);
+    } catch (std::exception& exc) {
+        fprintf(stderr, "%s\n", exc.what());
+        return 1;
+    }
+
+    printf("%zu mDNS packets loaded, %llu other packets skipped, %zu services\n",
+           packets.size(), (unsigned long long)skipped_count, services.size());
+    if (packets.empty())
+        return 0;
+
+    // set up the server
+
+    Bj_net_loopback net;
+    uint64_t output_packet_count = 0;
+    uint64_t output_byte_count = 0;
+    uint64_t alloc_count = 0;
+    size_t current_packet = 0;
+    net.set_capture_handler([&](int interface_id, Bj_net_loopback_direction direction, std::span<const unsigned char> data) {
+        output_packet_count++;
+        output_byte_count += data.size();
+        if (dump) {
+            if (direction == Bj_net_loopback_direction::reply)
+                printf("### REPLY TO PACKET %zu\n", current_packet);
+            else
+                printf("### UNSOLICITED\n");
+            u2_dns_msg_dump(data.data(), data.size(), 1);
+            printf("\n");
+        }
+    });
+    int interface_id = net.add_interface({ parse_address(address) });
+
+    Bj_server server(host_name, net);
+    server.set_latency_tracking(true);
+    server.set_heavy_hitter_tracking(top_count > 0);
+    if (capture_path) {
+        Bj_capture_limits limits;
+        limits.max_file_size = 0;
+        limits.max_packets_per_second = 0;
+        limits.slot_count = 1 << 16;
+        server.set_capture(std::make_shared<Bj_capture>(capture_path, limits));
+    }
+    for (auto& service : services)
+        server.register_service(service.instance_name, service.service_name, service.port, service.txt_record);
+    server.start();
+
+    // wait for the announcements, they are not part of the replay
+    net.loopback_executor().invoke_sync([]() {});
+    output_packet_count = 0;
+    output_byte_count = 0;
+
+    // replay
+
+    uint64_t start = bj_bench::now_ns();
+    for (int loop = 0; loop < loop_count; loop++) {
+        if (realtime) {
+            uint64_t loop_start = bj_bench::now_ns();
+            for (size_t i = 0; i < packets.size(); i++) {
+                uint64_t offset = packets[i].timestamp_ns - packets[0].timestamp_ns;
+                uint64_t now = bj_bench::now_ns();
+                if (now < loop_start + offset)
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(loop_start + offset - now));
+                net.loopback_executor().invoke_sync([&]() {
+                    uint64_t a = bj_bench::alloc_count();
+                    current_packet = i;
+                    net.inject(interface_id, packets[i].payload);
+                    alloc_count += bj_bench::alloc_count() - a;
+                });
+            }
+        } else {
+            for (size_t i = 0; i < packets.size(); i += inject_batch) {
+                net.loopback_executor().invoke_sync([&]() {
+                    uint64_t a = bj_bench::alloc_count();
+                    for (size_t j = i; j < packets.size() && j < i + inject_batch; j++) {
+                        current_packet = j;
+                        net.inject(interface_id, packets[j].payload);
+                    }
+                    alloc_count += bj_bench::alloc_count() - a;
+                });
+            }
+        }
+    }
+    uint64_t elapsed = bj_bench::now_ns() - start;
+
+    // report
+
+    uint64_t input_count = (uint64_t)packets.size() * loop_count;
+    double recorded_duration = (double)(packets.back().timestamp_ns - packets.front().timestamp_ns) / 1e9;
+    printf("\nreplay of %llu packets (recorded over %.1f s) in %.3f s: %.0f packets/s\n",
+           (unsigned long long)input_count, recorded_duration, (double)elapsed / 1e9, (double)input_count * 1e9 / (double)elapsed);
+    printf("output: %llu packets, %llu bytes (%.3f packets, %.1f bytes per input packet)\n",
+           (unsigned long long)output_packet_count, (unsigned long long)output_byte_count,
+           (double)output_packet_count / (double)input_count, (double)output_byte_count / (double)input_count);
+    printf("heap allocations: %llu (%.3f per input packet)\n",
+           (unsigned long long)alloc_count, (double)alloc_count / (double)input_count);
+    bj_bench::print_stats(server.get_stats_snapshot()[interface_id]);
+    bj_bench::print_latency(server.get_latency_snapshot()[interface_id]);
+
+    if (top_count > 0) {
+        printf("\nmost frequent questions (estimated counts)\n");
+        for (auto& hitter : server.get_heavy_hitters(top_count)) {
+            printf("  %10llu  %-5s %s\n", (unsigned long long)hitter.count,
+                   u2_dns_msg_type_to_str(hitter.type), hitter.name.c_str());
+        }
+    }
+
+    server.stop();
+    return 0;
+}
@@ -0,0 +1,249 @@
+//
+//  bj_sim_bench.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bj_bench_util.h"
+#include "bj_net_sim.h"
+#include "bj_server.h"
+#include "bj_sim.h"
+#include "bj_sim_querier.h"
+
+/*
+ * Wire efficiency of Bj_server, measured on a simulated Wi-Fi network.
+ *
+ * Usage: bj_sim_bench [--devices <n>] [--queriers <n>] [--types <n>] [--loss <p>]
+ *                     [--bitrate <Mb/s>] [--seed <n>]
+ *
+ * Each device runs a Bj_server announcing one service instance; service
+ * instances are spread over several service types. Queriers browse one
+ * service type each. The simulation is deterministic for a given seed, so
+ * that two versions of the server can be compared.
+ *
+ * Scenarios:
+ *   boot           all devices and queriers start within 10 s, measured over 60 s
+ *   browse storm   all queriers start browsing within 1 s, measured over 30 s
+ *   address churn  devices change address, 10 per second, measured over 60 s
+ */
+
+static const uint64_t second = 1000000000;
+
+struct Config {
+    int device_count = 500;
+    int querier_count = 20;
+    int type_count = 10;
+    uint64_t seed = 1;
+    Bj_sim_link_params link_params;
+};
+
+class Device {
+public:
+    Device(Bj_sim_link& link, int index, const std::string& service_type)
+        : net(link, { address(index, 0) }), server("device-" + std::to_string(index), net), index(index)
+    {
+        server.register_service("Device " + std::to_string(index), service_type, 1000, std::span<char>());
+    }
+
+    ~Device()
+    {
+        if (started)
+            server.stop();
+    }
+
+    void start()
+    {
+        server.start();
+        started = true;
+    }
+
+    void change_address()
+    {
+        net.set_addresses({ address(index, ++address_generation) });
+    }
+
+private:
+    Bj_net_sim net;
+    Bj_server server;
+    int index;
+    int address_generation = 0;
+    bool started = false;
+
+    static Bj_net_address address(int index, int generation)
+    {
+        return Bj_net_address({ 10, (unsigned char)generation, (unsigned char)(index >> 8), (unsigned char)index });
+    }
+};
+
+class World {
+public:
+    Bj_sim sim;
+    Bj_sim_link link;
+    std::vector<std::unique_ptr<Device>> devices;
+    std::vector<std::unique_ptr<Bj_sim_querier>> queriers;
+
+    World(const Config& config) : sim(config.seed), link(sim, config.link_params), config(config)
+    {
+        for (int i = 0; i < config.device_count; i++)
+            devices.push_back(std::make_unique<Device>(link, i, service_type(i)));
+        for (int i = 0; i < config.querier_count; i++)
+            queriers.push_back(std::make_unique<Bj_sim_querier>(link, service_type(i) + ".local"));
+    }
+
+    // schedule the start of all devices or queriers, at random times within the window
+    template <typename T>
+    void start_within(std::vector<std::unique_ptr<T>>& list, uint64_t window)
+    {
+        std::uniform_int_distribution<uint64_t> delay(0, window);
+        for (auto& item : list) {
+            T *p = item.get();
+            sim.schedule(delay(sim.random()), [p]() { p->start(); });
+        }
+    }
+
+    // average ratio of service instances discovered by the queriers
+    double discovered_ratio() const
+    {
+        if (queriers.empty())
+            return 0;
+        double sum = 0;
+        for (size_t i = 0; i < queriers.size(); i++) {
+            int type = (int)i % config.type_count;
+            int expected = config.device_count / config.type_count + (type < config.device_count % config.type_count ? 1 : 0);
+            sum += expected ? (double)queriers[i]->get_instance_count() / expected : 1;
+        }
+        return sum / (double)queriers.size();
+    }
+
+private:
+    Config config;
+
+    std::string service_type(int index) const
+    {
+        return "_type" + std::to_string(index % config.type_count) + "._tcp";
+    }
+};
+
+static void print_header()
+{
+    printf("  %-16s %10s %12s %12s %10s %10s %10s %11s %8s\n",
+           "scenario", "packets", "bytes", "airtime ms", "airtime %", "queries", "responses", "discovered", "wall ms");
+}
+
+static void print_result(const char *name, World& world, uint64_t duration, uint64_t wall_start)
+{
+    const Bj_sim_link_stats& stats = world.link.get_stats();
+    printf("  %-16s %10llu %12llu %12.1f %10.2f %10llu %10llu %10.1f%% %8.0f\n", name,
+           (unsigned long long)stats.packet_count,
+           (unsigned long long)stats.byte_count,
+           (double)stats.airtime_ns / 1e6,
+           (double)stats.airtime_ns * 100 / (double)duration,
+           (unsigned long long)stats.query_packet_count,
+           (unsigned long long)stats.response_packet_count,
+           world.discovered_ratio() * 100,
+           (double)(bj_bench::now_ns() - wall_start) / 1e6);
+    fflush(stdout);
+}
+
+static void scenario_boot(const Config& config)
+{
+    uint64_t wall_start = bj_bench::now_ns();
+    World world(config);
+    world.start_within(world.devices, 10 * second);
+    world.start_within(world.queriers, 10 * second);
+    world.sim.run_until(60 * second);
+    print_result("boot", world, 60 * second, wall_start);
+}
+
+static void scenario_browse_storm(const Config& config)
+{
+    uint64_t wall_start = bj_bench::now_ns();
+    World world(config);
+    world.start_within(world.devices, 0);
+    world.sim.run_until(10 * second);
+    world.link.reset_stats();
+    world.start_within(world.queriers, 1 * second);
+    world.sim.run_until(40 * second);
+    print_result("browse storm", world, 30 * second, wall_start);
+}
+
+static void scenario_address_churn(const Config& config)
+{
+    uint64_t wall_start = bj_bench::now_ns();
+    World world(config);
+    world.start_within(world.devices, 0);
+    world.start_within(world.queriers, 0);
+    world.sim.run_until(60 * second);
+    world.link.reset_stats();
+
+    std::uniform_int_distribution<size_t> pick(0, world.devices.size() - 1);
+    for (int t = 0; t < 60; t++) {
+        for (int i = 0; i < 10; i++)
+            world.devices[pick(world.sim.random())]->change_address();
+        world.sim.run_until((61 + t) * second);
+    }
+    print_result("address churn", world, 60 * second, wall_start);
+}
+
+int main(int argc, const char *argv[])
+{
+    Config config;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--devices") && i + 1 < argc) {
+            config.device_count = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--queriers") && i + 1 < argc) {
+            config.querier_count = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--types") && i + 1 < argc) {
+            config.type_count = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--loss") && i + 1 < argc) {
+            config.link_params.loss = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--bitrate") && i + 1 < argc) {
+            config.link_params.bitrate = atof(argv[++i]) * 1e6;
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            config.seed = (uint64_t)atoll(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--devices <n>] [--queriers <n>] [--types <n>] [--loss <p>] [--bitrate <Mb/s>] [--seed <n>]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (config.device_count < 1 || config.type_count < 1 || config.querier_count < 0) {
+        fprintf(stderr, "invalid configuration\n");
+        return 1;
+    }
+
+    printf("\nsimulated network: %d devices, %d queriers, %d service types, loss %.3f, %.1f Mb/s\n",
+           config.device_count, config.querier_count, config.type_count, config.link_params.loss, config.link_params.bitrate / 1e6);
+    print_header();
+    scenario_boot(config);
+    scenario_browse_storm(config);
+    scenario_address_churn(config);
+
+    return 0;
+}
@@ -30,6 +30,19 @@
 #include <netinet/in.h>
 #include <cstring>
 
+// number of leading one bits of a netmask
+static uint8_t prefix_length(std::span<const unsigned char> mask)
+{
+    uint8_t length = 0;
+    for (unsigned char byte : mask) {
+        for (int bit = 7; bit >= 0 && (byte & (1 << bit)); bit--)
+            length++;
+        if (byte != 0xff)
+            break;
+    }
+    return length;
+}
+
 static std::vector<Bj_net_address> get_ip_addresses(std::string_view interface_name)
 {
     std::vector<Bj_net_address> list;
@@ -52,6 +65,8 @@ static std::vector<Bj_net_address> get_ip_addresses(std::string_view interface_n
                     addr.protocol = Bj_net_protocol::ipv4;
                     assert(addr_bytes.size() ==  addr.ipv4.size());
                     std::copy(addr_bytes.begin(), addr_bytes.end(), addr.ipv4.begin());
+                    if (iface->ifa_netmask)
+                        addr.prefix_length = prefix_length(std::span((const unsigned char *)&((const struct sockaddr_in *)iface->ifa_netmask)->sin_addr, 4));
                     list.push_back(addr);
                     break;
                 }
@@ -64,6 +79,8 @@ static std::vector<Bj_net_address> get_ip_addresses(std::string_view interface_n
                     addr.protocol = Bj_net_protocol::ipv6;
                     assert(addr_bytes.size() ==  addr.ipv6.size());
                     std::copy(addr_bytes.begin(), addr_bytes.end(), addr.ipv6.begin());
+                    if (iface->ifa_netmask)
+                        addr.prefix_length = prefix_length(std::span((const unsigned char *)&((const struct sockaddr_in6 *)iface->ifa_netmask)->sin6_addr, 16));
                     list.push_back(addr);
                     break;
                 }
@@ -161,6 +178,12 @@ void Bj_net_group_apple::send(std::span<unsigned char> data)
     }
 }
 
+bool Bj_net_group_apple::is_reply_thread_safe() const
+{
+    // replies come from the single endpoints
+    return true;
+}
+
 void Bj_net_group_apple::update(Net_path net_path)
 {
     if (log_level >= 1) {
@@ -193,6 +216,7 @@ void Bj_net_group_apple::update(Net_path net_path)
 
         bool first_ipv4 = true;
         bool first_ipv6 = true;
+        bool multicast_open = false;
 
         for (auto &address : addresses) {
             // not supporting ipv6 yet
@@ -210,48 +234,60 @@ void Bj_net_group_apple::update(Net_path net_path)
                 multicast = true;
             }
 
-            // not supporting queries sent directly to this host yet
-            if (!multicast)
-                continue;
-
-            auto net = std::make_shared<Bj_net_single_apple>(address, addresses, multicast, exec);
-            net->set_rx_begin_handler([this, interface_id](int sublayer_interface_id, const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu) {
-                if (this->rx_begin_handler)
-                    this->rx_begin_handler(interface_id, addresses, mtu);
-            });
-            net->set_rx_data_handler([this, interface_id](int sublayer_interface_id, std::span<unsigned char> data, Bj_net_send reply) {
-                if (this->rx_data_handler)
-                    this->rx_data_handler(interface_id, data, reply);
-            });
-            net->set_rx_end_handler([this, interface_id](int sublayer_interface_id) {
-                if (this->rx_end_handler)
-                    this->rx_end_handler(interface_id);
-            });
+            if (multicast)
+                multicast_open = open_endpoint(net_path, interface, interface_id, address, addresses, true);
 
-            Net_endpoint endpoint = {
-                .multicast = true,
-                .net_path = net_path,
-                .interface_id = interface_id,
-                .interface_name = nw_interface_get_name(interface),
-                .addresses = addresses,
-                .net = net
-            };
-            endpoints.push_back(endpoint);
-
-            try {
-                net->open();
-            } catch (Bj_net_open_error error) {
-                // error while opening - this interface cannot be used
-                std::cout << address.as_str() << " cannot be used (" << error.what() << ")\n";
-
-                endpoints.pop_back();
-            }
+            // queries sent directly to this host, only once the interface is known to the rx handlers
+            if (multicast_open)
+                open_endpoint(net_path, interface, interface_id, address, addresses, false);
         }
 
         return true;
     });
 }
 
+// the unicast endpoints only deliver data, the rx begin and end handlers of the interface come from the multicast one
+bool Bj_net_group_apple::open_endpoint(Net_path net_path, nw_interface_t interface, int interface_id, const Bj_net_address& address, const std::vector<Bj_net_address>& addresses, bool multicast)
+{
+    auto net = std::make_shared<Bj_net_single_apple>(address, addresses, multicast, exec);
+    if (multicast) {
+        net->set_rx_begin_handler([this, interface_id](int sublayer_interface_id, const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu) {
+            if (this->rx_begin_handler)
+                this->rx_begin_handler(interface_id, addresses, mtu);
+        });
+        net->set_rx_end_handler([this, interface_id](int sublayer_interface_id) {
+            if (this->rx_end_handler)
+                this->rx_end_handler(interface_id);
+        });
+    }
+    net->set_rx_data_handler([this, interface_id](int sublayer_interface_id, std::span<unsigned char> data, const Bj_net_source& source, const Bj_net_reply& reply) {
+        if (this->rx_data_handler)
+            this->rx_data_handler(interface_id, data, source, reply);
+    });
+
+    Net_endpoint endpoint = {
+        .multicast = multicast,
+        .net_path = net_path,
+        .interface_id = interface_id,
+        .interface_name = nw_interface_get_name(interface),
+        .addresses = addresses,
+        .net = net
+    };
+    endpoints.push_back(endpoint);
+
+    try {
+        net->open();
+    } catch (Bj_net_open_error error) {
+        // error while opening - this interface cannot be used
+        std::cout << address.as_str() << (multicast ? "" : " unicast") << " cannot be used (" << error.what() << ")\n";
+
+        endpoints.pop_back();
+        return false;
+    }
+
+    return true;
+}
+
 void Bj_net_group_apple::cancel()
 {
     close_step_count = endpoints.size();
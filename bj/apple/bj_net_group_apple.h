@@ -44,6 +44,7 @@ public:
     void open() override;
     void close(std::function<void()> completion) override;
     void send(std::span<unsigned char> data) override;
+    bool is_reply_thread_safe() const override;
 
 private:
     struct Net_path {
@@ -80,5 +81,6 @@ private:
     size_t close_step_count = 0;
 
     void update(Net_path net_path);
+    bool open_endpoint(Net_path net_path, nw_interface_t interface, int interface_id, const Bj_net_address& address, const std::vector<Bj_net_address>& addresses, bool multicast);
     void cancel();
 };
@@ -24,6 +24,7 @@
 //
 
 #include "bj_net_single_apple.h"
+#include "u2_probe.h"
 #include <netdb.h>
 #include <stdexcept>
 #include <cassert>
@@ -33,7 +34,7 @@ Bj_net_single_apple::Bj_net_single_apple(const Bj_net_address& bound_address, co
     this->multicast = multicast;
     this->bound_address = bound_address;
     this->interface_addresses = interface_addresses;
-    this->reply_proxy = std::bind(&Bj_net_single_apple::reply, this, std::placeholders::_1);
+    this->reply_proxy = std::bind(&Bj_net_single_apple::reply, this, std::placeholders::_1, std::placeholders::_2);
     this->rx_buf = std::make_unique<uint8_t[]>(rx_buf_size);
 }
 
@@ -83,7 +84,7 @@ void Bj_net_single_apple::open()
     if (multicast)
         open_multicast();
     else
-        throw std::logic_error("unicast not supported yet");
+        open_unicast();
 
     opened = true;
 
@@ -131,9 +132,15 @@ void Bj_net_single_apple::close(std::function<void()> completion)
 
 void Bj_net_single_apple::send(std::span<unsigned char> data)
 {
+    U2_PROBE3(bj, send, 0, data.data(), data.size());
     sendto(tx_socket, data.data(), data.size(), 0, (struct sockaddr *)&multicast_group, multicast_group.sin_len);
 }
 
+bool Bj_net_single_apple::is_reply_thread_safe() const
+{
+    return true;
+}
+
 void Bj_net_single_apple::open_multicast()
 {
     try {
@@ -244,8 +251,81 @@ void Bj_net_single_apple::open_multicast()
     }
 }
 
-void Bj_net_single_apple::reply(std::span<unsigned char> data)
+/*
+ * The queries sent directly to `bound_address`. The socket is bound to that
+ * address, which the kernel prefers over the wildcard sockets of port 5353,
+ * and is used for sending too: replies go back by unicast, messages sent
+ * with send() go to the group.
+ */
+void Bj_net_single_apple::open_unicast()
 {
+    try {
+        // build group address
+        Bj_net_address group_addr = { 224, 0, 0, 251 };
+        memset(&multicast_group, 0, sizeof(multicast_group));
+        multicast_group.sin_family = AF_INET;
+        multicast_group.sin_len = sizeof(multicast_group);
+        std::copy(group_addr.ipv4.begin(), group_addr.ipv4.end(), reinterpret_cast<unsigned char*>(&multicast_group.sin_addr.s_addr));
+        multicast_group.sin_port = htons(5353);
+
+        rx_socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (rx_socket < 0)
+            throw Bj_net_open_error("cannot create dns-sd unicast socket");
+        tx_socket = rx_socket;
+
+        // allow sharing port 5353 with other programs
+        int reuse = 1;
+        if (setsockopt(rx_socket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) != 0)
+            throw Bj_net_open_error("cannot configure the unicast socket to be reused");
+
+        int flags = fcntl(rx_socket, F_GETFL);
+        if (flags == -1)
+            throw Bj_net_open_error("cannot get unicast socket flags");
+        if (fcntl(rx_socket, F_SETFL, flags | O_NONBLOCK) == -1)
+            throw Bj_net_open_error("cannot put unicast socket in non-blocking mode");
+
+        struct sockaddr_in addr = { 0 };
+        addr.sin_family = AF_INET;
+        addr.sin_len = sizeof(addr);
+        addr.sin_port = htons(5353);
+        std::copy(bound_address.ipv4.begin(), bound_address.ipv4.end(), reinterpret_cast<unsigned char*>(&addr.sin_addr.s_addr));
+        if (bind(rx_socket, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+            throw Bj_net_open_error("cannot bind the unicast socket, errno=" + std::to_string(errno));
+
+        // define on which interface to send multicast telegrams
+        if (setsockopt(tx_socket, IPPROTO_IP, IP_MULTICAST_IF, bound_address.ipv4.data(), (int)bound_address.ipv4.size()) != 0)
+            throw Bj_net_open_error("cannot set multicast output interface");
+
+        // setup listening queue
+        rx_source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, rx_socket, 0, exec.queue);
+        dispatch_set_context(rx_source, this);
+        dispatch_source_set_event_handler_f(rx_source, [](void *ctx) {
+            Bj_net_single_apple* me = static_cast<Bj_net_single_apple*>(ctx);
+            me->handle_rx_data();
+        });
+        dispatch_resume(rx_source);
+
+    } catch (Bj_net_open_error exc) {
+        if (rx_socket != -1)
+            ::close(rx_socket);
+        rx_socket = -1;
+        tx_socket = -1;
+        throw exc;
+    }
+}
+
+void Bj_net_single_apple::reply(std::span<unsigned char> data, const Bj_net_source& destination)
+{
+    U2_PROBE3(bj, reply, 0, data.data(), data.size());
+    if (destination.address.protocol == Bj_net_protocol::ipv4) {
+        struct sockaddr_in addr = { 0 };
+        addr.sin_family = AF_INET;
+        addr.sin_len = sizeof(addr);
+        addr.sin_port = htons(destination.port);
+        std::copy(destination.address.ipv4.begin(), destination.address.ipv4.end(), reinterpret_cast<unsigned char*>(&addr.sin_addr.s_addr));
+        sendto(tx_socket, data.data(), data.size(), 0, (struct sockaddr *)&addr, addr.sin_len);
+        return;
+    }
     sendto(tx_socket, data.data(), data.size(), 0, (struct sockaddr *)&multicast_group, multicast_group.sin_len);
 }
 
@@ -256,7 +336,20 @@ void Bj_net_single_apple::handle_rx_data()
      * in the rx handler either. Same for EAGAIN.
      * We just ignore them, as well as all other errors.
      */
-    size_t rv = recv(rx_socket, rx_buf.get(), rx_buf_size, 0);
+    struct sockaddr_in addr = { 0 };
+    socklen_t addr_size = sizeof(addr);
+    size_t rv = recvfrom(rx_socket, rx_buf.get(), rx_buf_size, 0, (struct sockaddr *)&addr, &addr_size);
+    if (rv > 0)
+        U2_PROBE3(bj, rx, 0, rx_buf.get(), rv);
+
+    Bj_net_source source;
+    if (addr.sin_family == AF_INET) {
+        source.address = Bj_net_address(Bj_net_protocol::ipv4);
+        std::copy_n(reinterpret_cast<unsigned char*>(&addr.sin_addr.s_addr), source.address.ipv4.size(), source.address.ipv4.begin());
+        source.port = ntohs(addr.sin_port);
+        source.direct = !multicast;
+    }
+
     if (rv > 0 && rx_data_handler)
-        rx_data_handler(0, std::span(rx_buf.get(), rv), reply_proxy);
+        rx_data_handler(0, std::span(rx_buf.get(), rv), source, reply_proxy);
 }
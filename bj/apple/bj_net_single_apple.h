@@ -47,6 +47,7 @@ public:
     void close(std::function<void()> completion) override;
 
     void send(std::span<unsigned char> data) override;
+    bool is_reply_thread_safe() const override;
 
 private:
     Bj_net_address bound_address;
@@ -68,11 +69,12 @@ private:
     Bj_net_rx_begin_handler rx_begin_handler;
     Bj_net_rx_data_handler rx_data_handler;
     Bj_net_rx_end_handler rx_end_handler;
-    Bj_net_send reply_proxy;
+    Bj_net_reply reply_proxy;
 
     std::function<void()> close_completion;
 
     void open_multicast();
-    void reply(std::span<unsigned char> data);
+    void open_unicast();
+    void reply(std::span<unsigned char> data, const Bj_net_source& destination);
     void handle_rx_data();
 };
@@ -0,0 +1,286 @@
+//
+//  bj_capture.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include "bj_capture.h"
+#include "bj_util.h"
+
+// see https://www.ietf.org/archive/id/draft-ietf-opsawg-pcapng-01.html
+static const uint32_t pcapng_section_header_block = 0x0A0D0D0A;
+static const uint32_t pcapng_interface_description_block = 0x00000001;
+static const uint32_t pcapng_enhanced_packet_block = 0x00000006;
+static const uint32_t pcapng_byte_order_magic = 0x1A2B3C4D;
+static const uint16_t pcapng_linktype_raw = 101;
+static const uint16_t pcapng_opt_endofopt = 0;
+static const uint16_t pcapng_opt_if_name = 2;
+static const uint16_t pcapng_opt_if_tsresol = 9;
+static const uint16_t pcapng_opt_epb_flags = 2;
+static const uint32_t pcapng_epb_flags_inbound = 1;
+static const uint32_t pcapng_epb_flags_outbound = 2;
+
+static const size_t ip_udp_header_size = 28;
+
+template <typename T>
+static void append(std::vector<unsigned char>& block, T value)
+{
+    size_t offset = block.size();
+    block.resize(offset + sizeof(T));
+    memcpy(&block[offset], &value, sizeof(T));
+}
+
+static void append_padding(std::vector<unsigned char>& block)
+{
+    while (block.size() % 4)
+        block.push_back(0);
+}
+
+static void append_option(std::vector<unsigned char>& block, uint16_t code, const void *value, uint16_t length)
+{
+    append(block, code);
+    append(block, length);
+    if (length) {
+        const unsigned char *bytes = (const unsigned char *)value;
+        block.insert(block.end(), bytes, bytes + length);
+        append_padding(block);
+    }
+}
+
+static void append_ip_udp_header(std::vector<unsigned char>& block, size_t payload_length)
+{
+    const unsigned char address[4] = {224, 0, 0, 251};
+    size_t ip_length = ip_udp_header_size + payload_length;
+    size_t udp_length = ip_udp_header_size - 20 + payload_length;
+
+    unsigned char header[ip_udp_header_size] = {
+        0x45, 0, (unsigned char)(ip_length >> 8), (unsigned char)ip_length,
+        0, 0, 0, 0,
+        255, 17, 0, 0,
+        address[0], address[1], address[2], address[3],
+        address[0], address[1], address[2], address[3],
+        0x14, 0xE9, 0x14, 0xE9, // 5353
+        (unsigned char)(udp_length >> 8), (unsigned char)udp_length, 0, 0, // no UDP checksum
+    };
+
+    uint32_t sum = 0;
+    for (int i = 0; i < 20; i += 2)
+        sum += (header[i] << 8) | header[i + 1];
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    header[10] = (unsigned char)(~sum >> 8);
+    header[11] = (unsigned char)~sum;
+
+    block.insert(block.end(), header, header + ip_udp_header_size);
+}
+
+Bj_capture::Bj_capture(const std::string& path, Bj_capture_limits limits) : limits(limits)
+{
+    size_t slot_count = std::bit_ceil(std::max(limits.slot_count, (size_t)1));
+    slot_mask = slot_count - 1;
+    slots.resize(slot_count);
+    slot_data.resize(slot_count * limits.snap_length);
+
+    file = fopen(path.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("cannot open capture file " + path);
+
+    auto realtime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    realtime_offset = realtime - (int64_t)bj_util::monotonic_ns();
+
+    block.reserve(64 + ip_udp_header_size + limits.snap_length);
+    write_section_header();
+    thread = std::thread(&Bj_capture::run, this);
+}
+
+Bj_capture::~Bj_capture()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        cv.notify_one();
+    }
+    thread.join();
+    fclose(file);
+}
+
+void Bj_capture::record(int interface_id, Bj_capture_direction direction, std::span<const unsigned char> data)
+{
+    uint64_t timestamp = bj_util::monotonic_ns();
+
+    if (limits.max_packets_per_second) {
+        if (timestamp - rate_window_start >= 1000000000) {
+            rate_window_start = timestamp;
+            rate_window_count = 0;
+        }
+        if (rate_window_count >= limits.max_packets_per_second) {
+            rate_limited_count.store(rate_limited_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        rate_window_count++;
+    }
+
+    uint64_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) > slot_mask) {
+        ring_full_count.store(ring_full_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    Slot& slot = slots[h & slot_mask];
+    slot.timestamp = timestamp;
+    slot.interface_id = interface_id;
+    slot.direction = direction;
+    slot.length = (uint32_t)std::min(data.size(), limits.snap_length);
+    slot.original_length = (uint32_t)data.size();
+    memcpy(&slot_data[(h & slot_mask) * limits.snap_length], data.data(), slot.length);
+
+    head.store(h + 1, std::memory_order_release);
+}
+
+Bj_capture_stats Bj_capture::get_stats() const
+{
+    return {
+        .captured_count = captured_count.load(std::memory_order_relaxed),
+        .ring_full_count = ring_full_count.load(std::memory_order_relaxed),
+        .rate_limited_count = rate_limited_count.load(std::memory_order_relaxed),
+        .size_limited_count = size_limited_count.load(std::memory_order_relaxed),
+    };
+}
+
+/**
+ * Writer thread. The producer never signals, so that record() stays free of
+ * system calls; the ring is polled instead.
+ */
+void Bj_capture::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        lock.unlock();
+        drain();
+        lock.lock();
+        cv.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    lock.unlock();
+    drain();
+}
+
+void Bj_capture::drain()
+{
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    uint64_t h = head.load(std::memory_order_acquire);
+    if (t == h)
+        return;
+
+    for (; t != h; t++) {
+        write_packet(slots[t & slot_mask], &slot_data[(t & slot_mask) * limits.snap_length]);
+        tail.store(t + 1, std::memory_order_release);
+    }
+    fflush(file);
+}
+
+void Bj_capture::write_block()
+{
+    fwrite(block.data(), 1, block.size(), file);
+    file_size += block.size();
+}
+
+void Bj_capture::write_section_header()
+{
+    block.clear();
+    append(block, pcapng_section_header_block);
+    append(block, (uint32_t)28);
+    append(block, pcapng_byte_order_magic);
+    append(block, (uint16_t)1);  // major version
+    append(block, (uint16_t)0);  // minor version
+    append(block, (int64_t)-1);  // section length not specified
+    append(block, (uint32_t)28);
+    write_block();
+}
+
+uint32_t Bj_capture::pcap_interface(int interface_id)
+{
+    auto it = pcap_interfaces.find(interface_id);
+    if (it != pcap_interfaces.end())
+        return it->second;
+
+    uint32_t index = (uint32_t)pcap_interfaces.size();
+    pcap_interfaces[interface_id] = index;
+
+    std::string name = "bj" + std::to_string(interface_id);
+    uint8_t tsresol = 9; // nanoseconds
+
+    block.clear();
+    append(block, pcapng_interface_description_block);
+    append(block, (uint32_t)0); // length, set below
+    append(block, pcapng_linktype_raw);
+    append(block, (uint16_t)0);
+    append(block, (uint32_t)(ip_udp_header_size + limits.snap_length));
+    append_option(block, pcapng_opt_if_name, name.data(), (uint16_t)name.size());
+    append_option(block, pcapng_opt_if_tsresol, &tsresol, 1);
+    append_option(block, pcapng_opt_endofopt, nullptr, 0);
+    uint32_t length = (uint32_t)block.size() + 4;
+    memcpy(&block[4], &length, 4);
+    append(block, length);
+    write_block();
+
+    return index;
+}
+
+void Bj_capture::write_packet(const Slot& slot, const unsigned char *data)
+{
+    uint32_t interface_index = pcap_interface(slot.interface_id);
+
+    uint32_t captured_length = (uint32_t)ip_udp_header_size + slot.length;
+    uint32_t original_length = (uint32_t)ip_udp_header_size + slot.original_length;
+    uint32_t length = 28 + ((captured_length + 3) & ~3) + 12 + 4;
+    if (limits.max_file_size && file_size + length > limits.max_file_size) {
+        size_limited_count.store(size_limited_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint64_t timestamp = (uint64_t)((int64_t)slot.timestamp + realtime_offset);
+    uint32_t flags = slot.direction == Bj_capture_direction::rx ? pcapng_epb_flags_inbound : pcapng_epb_flags_outbound;
+
+    block.clear();
+    append(block, pcapng_enhanced_packet_block);
+    append(block, length);
+    append(block, interface_index);
+    append(block, (uint32_t)(timestamp >> 32));
+    append(block, (uint32_t)timestamp);
+    append(block, captured_length);
+    append(block, original_length);
+    append_ip_udp_header(block, slot.original_length);
+    block.insert(block.end(), data, data + slot.length);
+    append_padding(block);
+    append_option(block, pcapng_opt_epb_flags, &flags, 4);
+    append_option(block, pcapng_opt_endofopt, nullptr, 0);
+    append(block, length);
+    write_block();
+
+    captured_count.store(captured_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
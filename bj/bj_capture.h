@@ -0,0 +1,118 @@
+//
+//  bj_capture.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class Bj_capture_direction {
+    rx,
+    tx,
+};
+
+struct Bj_capture_limits {
+    size_t slot_count = 1024;               // ring capacity, rounded up to a power of two
+    size_t snap_length = 1500;              // longer packets are truncated
+    uint64_t max_file_size = 64 << 20;      // packets beyond this size are not written, 0 = no limit
+    uint64_t max_packets_per_second = 10000; // 0 = no limit
+};
+
+struct Bj_capture_stats {
+    uint64_t captured_count = 0;     // packets written to the file
+    uint64_t ring_full_count = 0;    // packets lost because the writer thread was late
+    uint64_t rate_limited_count = 0;
+    uint64_t size_limited_count = 0;
+};
+
+/**
+ * Packet capture to a pcapng file.
+ * record() copies the packet in a lock-free ring and returns immediately; a
+ * background thread drains the ring to the file. There must be a single
+ * producer, typically the network executor. Since Bj_net does not give the
+ * peer address, each packet is wrapped in a synthetic IPv4/UDP header
+ * (224.0.0.251:5353) so that the usual tools decode it as mDNS; the direction
+ * is stored in the packet flags.
+ */
+class Bj_capture {
+public:
+    Bj_capture(const std::string& path, Bj_capture_limits limits = {});
+    ~Bj_capture();
+    Bj_capture(const Bj_capture&) = delete;
+    Bj_capture& operator=(const Bj_capture&) = delete;
+
+    void record(int interface_id, Bj_capture_direction direction, std::span<const unsigned char> data);
+    Bj_capture_stats get_stats() const;
+
+private:
+    struct Slot {
+        uint64_t timestamp;
+        int interface_id;
+        Bj_capture_direction direction;
+        uint32_t length;
+        uint32_t original_length;
+    };
+
+    Bj_capture_limits limits;
+    size_t slot_mask;
+    std::vector<Slot> slots;
+    std::vector<unsigned char> slot_data;
+
+    // producer side
+    alignas(64) std::atomic<uint64_t> head = 0;
+    uint64_t rate_window_start = 0;
+    uint64_t rate_window_count = 0;
+    std::atomic<uint64_t> ring_full_count = 0;
+    std::atomic<uint64_t> rate_limited_count = 0;
+
+    // writer side
+    alignas(64) std::atomic<uint64_t> tail = 0;
+    std::atomic<uint64_t> captured_count = 0;
+    std::atomic<uint64_t> size_limited_count = 0;
+    FILE *file;
+    uint64_t file_size = 0;
+    int64_t realtime_offset;
+    std::map<int, uint32_t> pcap_interfaces; // key = interface_id, value = pcapng interface index
+    std::vector<unsigned char> block;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::thread thread;
+
+    void run();
+    void drain();
+    void write_block();
+    void write_section_header();
+    uint32_t pcap_interface(int interface_id);
+    void write_packet(const Slot& slot, const unsigned char *data);
+};
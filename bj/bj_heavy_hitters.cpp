@@ -0,0 +1,144 @@
+//
+//  bj_heavy_hitters.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include <cstring>
+#include "bj_heavy_hitters.h"
+#include "u2_dns.h"
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+static std::string dotted_name(const char *name)
+{
+    std::string result;
+    const unsigned char *label = (const unsigned char *)name;
+    while (*label) {
+        if (!result.empty())
+            result += '.';
+        result.append((const char *)label + 1, *label);
+        label += 1 + *label;
+    }
+    return result.empty() ? "." : result;
+}
+
+Bj_heavy_hitters::Bj_heavy_hitters()
+{
+    reset();
+}
+
+void Bj_heavy_hitters::add(int interface_id, const char *name, int type)
+{
+    int name_length = u2_dns_name_length(name);
+
+    uint64_t hash = 0xCBF29CE484222325;
+    hash = fnv1a(hash, name, name_length);
+    hash = fnv1a(hash, &type, sizeof(type));
+    hash = fnv1a(hash, &interface_id, sizeof(interface_id));
+
+    // double hashing gives the index in each row
+    uint64_t step = (hash >> 32) | 1;
+    uint32_t estimate = UINT32_MAX;
+    for (int d = 0; d < depth; d++) {
+        uint32_t& counter = counters[d * width + ((hash + d * step) & (width - 1))];
+        if (counter < UINT32_MAX)
+            counter++;
+        estimate = std::min(estimate, counter);
+    }
+    total_count++;
+
+    Entry *min_entry = nullptr;
+    for (int i = 0; i < entry_count; i++) {
+        Entry& entry = entries[i];
+        if (entry.hash == hash && entry.interface_id == interface_id && entry.type == type
+            && entry.name_length == name_length && !memcmp(entry.name, name, name_length)) {
+            entry.count = estimate;
+            return;
+        }
+        if (!min_entry || entry.count < min_entry->count)
+            min_entry = &entry;
+    }
+
+    Entry *entry;
+    if (entry_count < capacity) {
+        entry = &entries[entry_count++];
+    } else if (estimate > min_entry->count) {
+        entry = min_entry;
+    } else {
+        return;
+    }
+
+    entry->hash = hash;
+    entry->count = estimate;
+    entry->interface_id = interface_id;
+    entry->type = type;
+    entry->name_length = name_length;
+    memcpy(entry->name, name, name_length);
+}
+
+std::vector<Bj_heavy_hitter> Bj_heavy_hitters::top(size_t count) const
+{
+    std::vector<const Entry *> sorted;
+    for (int i = 0; i < entry_count; i++)
+        sorted.push_back(&entries[i]);
+    std::sort(sorted.begin(), sorted.end(), [](const Entry *a, const Entry *b) {
+        return a->count > b->count;
+    });
+
+    std::vector<Bj_heavy_hitter> result;
+    for (size_t i = 0; i < sorted.size() && i < count; i++) {
+        result.push_back({
+            .name = dotted_name(sorted[i]->name),
+            .type = sorted[i]->type,
+            .interface_id = sorted[i]->interface_id,
+            .count = sorted[i]->count,
+        });
+    }
+    return result;
+}
+
+void Bj_heavy_hitters::decay()
+{
+    for (auto& counter : counters)
+        counter /= 2;
+    for (int i = 0; i < entry_count; i++)
+        entries[i].count /= 2;
+    total_count /= 2;
+}
+
+void Bj_heavy_hitters::reset()
+{
+    counters.fill(0);
+    entry_count = 0;
+    total_count = 0;
+}
@@ -0,0 +1,81 @@
+//
+//  bj_heavy_hitters.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Bj_heavy_hitter {
+    std::string name;     // dotted
+    int type;
+    int interface_id;
+    uint64_t count;       // estimate, never below the real count
+};
+
+/**
+ * Most frequent (name, type, interface) tuples among the questions received,
+ * in bounded memory: a count-min sketch estimates the count of every tuple,
+ * and a small table keeps the tuples with the highest estimates.
+ * add() neither allocates nor locks; the object must be protected by the
+ * caller, typically by running on the executor.
+ */
+class Bj_heavy_hitters {
+public:
+    static constexpr int depth = 4;
+    static constexpr int width = 4096;    // power of two
+    static constexpr int capacity = 64;   // tuples tracked
+
+    Bj_heavy_hitters();
+
+    // name in u2 format
+    void add(int interface_id, const char *name, int type);
+
+    // highest counts first
+    std::vector<Bj_heavy_hitter> top(size_t count) const;
+
+    uint64_t get_total_count() const { return total_count; }
+
+    // divide all counts by two, to give more weight to recent questions
+    void decay();
+    void reset();
+
+private:
+    struct Entry {
+        uint64_t hash;
+        uint64_t count;
+        int interface_id;
+        int type;
+        int name_length;
+        char name[256];
+    };
+
+    std::array<uint32_t, depth * width> counters;
+    std::array<Entry, capacity> entries;
+    int entry_count;
+    uint64_t total_count;
+};
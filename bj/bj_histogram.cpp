@@ -0,0 +1,124 @@
+//
+//  bj_histogram.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#include <bit>
+#include <cmath>
+#include "bj_histogram.h"
+
+void Bj_histogram::record(uint64_t value)
+{
+    if (value > value_max)
+        value = value_max;
+    buckets[bucket_index(value)]++;
+    count++;
+    sum += value;
+    if (value < min)
+        min = value;
+    if (value > max)
+        max = value;
+}
+
+void Bj_histogram::merge(const Bj_histogram& histogram)
+{
+    for (int i = 0; i < bucket_count; i++) {
+        buckets[i] += histogram.buckets[i];
+    }
+    count += histogram.count;
+    sum += histogram.sum;
+    if (histogram.min < min)
+        min = histogram.min;
+    if (histogram.max > max)
+        max = histogram.max;
+}
+
+void Bj_histogram::reset()
+{
+    *this = Bj_histogram();
+}
+
+uint64_t Bj_histogram::get_count() const
+{
+    return count;
+}
+
+uint64_t Bj_histogram::get_min() const
+{
+    return count ? min : 0;
+}
+
+uint64_t Bj_histogram::get_max() const
+{
+    return max;
+}
+
+double Bj_histogram::get_mean() const
+{
+    return count ? (double)sum / (double)count : 0;
+}
+
+uint64_t Bj_histogram::get_percentile(double percentile) const
+{
+    if (count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)std::ceil(percentile / 100.0 * (double)count);
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t acc = 0;
+    for (int i = 0; i < bucket_count; i++) {
+        acc += buckets[i];
+        if (acc >= rank) {
+            uint64_t value = bucket_highest_value(i);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
+
+/**
+ * Values below `sub_bucket_count` have their own bucket. Above, the bucket
+ * is given by the position of the most significant bit and by the next
+ * `sub_bucket_bits` bits.
+ */
+int Bj_histogram::bucket_index(uint64_t value)
+{
+    if (value < sub_bucket_count)
+        return (int)value;
+    int msb = 63 - std::countl_zero(value);
+    int shift = msb - sub_bucket_bits;
+    int sub_bucket = (int)(value >> shift) & (sub_bucket_count - 1);
+    return (shift + 1) * sub_bucket_count + sub_bucket;
+}
+
+uint64_t Bj_histogram::bucket_highest_value(int index)
+{
+    if (index < sub_bucket_count)
+        return (uint64_t)index;
+    int shift = index / sub_bucket_count - 1;
+    uint64_t sub_bucket = (uint64_t)(index % sub_bucket_count);
+    uint64_t lowest = (sub_bucket_count + sub_bucket) << shift;
+    return lowest + ((uint64_t)1 << shift) - 1;
+}
@@ -0,0 +1,65 @@
+//
+//  bj_histogram.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+#include <array>
+#include <cstdint>
+
+/**
+ * Histogram with logarithmic buckets, in the spirit of HdrHistogram.
+ * Each power of two is split in 16 linear sub-buckets, which gives a relative
+ * precision of about 6%. Values up to 2^40 are recorded, bigger values are
+ * clamped. Recording is constant time and never allocates.
+ */
+class Bj_histogram {
+public:
+    static constexpr int sub_bucket_bits = 4;
+    static constexpr int sub_bucket_count = 1 << sub_bucket_bits;
+    static constexpr int value_bits = 40;
+    static constexpr uint64_t value_max = ((uint64_t)1 << value_bits) - 1;
+    static constexpr int bucket_count = (value_bits - sub_bucket_bits + 1) * sub_bucket_count;
+
+    void record(uint64_t value);
+    void merge(const Bj_histogram& histogram);
+    void reset();
+
+    uint64_t get_count() const;
+    uint64_t get_min() const;
+    uint64_t get_max() const;
+    double get_mean() const;
+
+    // highest value equivalent to the given percentile (0...100)
+    uint64_t get_percentile(double percentile) const;
+
+private:
+    std::array<uint64_t, bucket_count> buckets = {};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+
+    static int bucket_index(uint64_t value);
+    static uint64_t bucket_highest_value(int index);
+};
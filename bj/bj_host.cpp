@@ -47,6 +47,11 @@ Bj_host& Bj_host::operator= (const Bj_host& host)
     return *this;
 }
 
+const std::vector<Bj_net_address>& Bj_host::get_addresses() const
+{
+    return addresses;
+}
+
 const u2_dns_domain* Bj_host::domain_view()
 {
     build_view();
@@ -36,6 +36,7 @@ public:
     Bj_host(const Bj_host& host);
     Bj_host& operator= (const Bj_host& host);
 
+    const std::vector<Bj_net_address>& get_addresses() const;
     const u2_dns_domain* domain_view();
 
 private:
@@ -24,8 +24,9 @@
 //
 
 #include "bj_net.h"
-#include <sstream>
+#include <algorithm>
 #include <iomanip>
+#include <sstream>
 
 std::string Bj_net_address::as_str() const
 {
@@ -73,3 +74,36 @@ bool Bj_net_address::is_any() const
             return true;
     }
 }
+
+bool Bj_net_address::contains(const Bj_net_address& address) const
+{
+    if (address.protocol != protocol || protocol == Bj_net_protocol::undefined)
+        return false;
+
+    std::span<const unsigned char> bytes = protocol == Bj_net_protocol::ipv4 ? std::span<const unsigned char>(ipv4) : std::span<const unsigned char>(ipv6);
+    std::span<const unsigned char> other = protocol == Bj_net_protocol::ipv4 ? std::span<const unsigned char>(address.ipv4) : std::span<const unsigned char>(address.ipv6);
+    size_t bit_count = std::min((size_t)prefix_length, bytes.size() * 8);
+    for (size_t i = 0; i < bit_count / 8; i++) {
+        if (bytes[i] != other[i])
+            return false;
+    }
+    if (bit_count % 8) {
+        unsigned char mask = (unsigned char)(0xff << (8 - bit_count % 8));
+        if ((bytes[bit_count / 8] & mask) != (other[bit_count / 8] & mask))
+            return false;
+    }
+    return true;
+}
+
+bool Bj_net_address::is_on_link(const std::vector<Bj_net_address>& interface_addresses) const
+{
+    // ipv6 link-local sources (fe80::/10) are on the link whatever the subnets
+    if (protocol == Bj_net_protocol::ipv6 && ipv6[0] == 0xfe && (ipv6[1] & 0xc0) == 0x80)
+        return true;
+
+    for (auto& interface_address : interface_addresses) {
+        if (interface_address.contains(*this))
+            return true;
+    }
+    return false;
+}
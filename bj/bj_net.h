@@ -24,8 +24,14 @@
 //
 
 #pragma once
+#include <array>
 #include <functional>
+#include <map>
 #include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bj_histogram.h"
 
 enum class Bj_net_protocol {
     undefined,
@@ -40,6 +46,9 @@ struct Bj_net_address {
         std::array<unsigned char, 16> ipv6;
     };
 
+    // interface addresses only: length of the subnet prefix, not compared by operator==; 0 if unknown, the subnet is then everything
+    uint8_t prefix_length = 0;
+
     constexpr Bj_net_address() : Bj_net_address(Bj_net_protocol::undefined) {}
 
     constexpr Bj_net_address(Bj_net_protocol protocol) {
@@ -48,11 +57,14 @@ struct Bj_net_address {
     }
 
     constexpr Bj_net_address(std::initializer_list<unsigned char> bytes) {
+        ipv6.fill(0);
         switch (bytes.size()) {
             case 4:
+                protocol = Bj_net_protocol::ipv4;
                 std::copy(bytes.begin(), bytes.end(), ipv4.begin());
                 break;
             case 16:
+                protocol = Bj_net_protocol::ipv6;
                 std::copy(bytes.begin(), bytes.end(), ipv6.begin());
                 break;
             default:
@@ -75,6 +87,12 @@ struct Bj_net_address {
 
     std::string as_str() const;
     bool is_any() const;
+
+    // true if `address` is in the subnet of this interface address
+    bool contains(const Bj_net_address& address) const;
+
+    // true if this source address is on the link of an interface having `interface_addresses` (RFC 6762, section 11)
+    bool is_on_link(const std::vector<Bj_net_address>& interface_addresses) const;
     bool is_valid() const {
         return protocol == Bj_net_protocol::undefined;
     };
@@ -84,6 +102,22 @@ struct Bj_net_mtu {
     size_t mtu;
     size_t ip_header_size;
     size_t udp_header_size;
+
+    // UDP over `protocol` on a link of the given MTU
+    static constexpr Bj_net_mtu udp(Bj_net_protocol protocol, size_t mtu) {
+        return {
+            .mtu = mtu,
+            .ip_header_size = size_t(protocol == Bj_net_protocol::ipv6 ? 40 : 20),
+            .udp_header_size = 8
+        };
+    }
+};
+
+// receive path instrumentation of an interface
+struct Bj_net_rx_stats {
+    uint64_t drop_count = 0;     // datagrams dropped by the kernel because the socket queue was full, or by a socket filter
+    bool filtered = false;       // a query filter is attached: drop_count also counts its rejections, not only overflows
+    Bj_histogram delay;          // from the arrival in the kernel to the rx data handler, in nanoseconds
 };
 
 class Bj_net_executor {
@@ -92,12 +126,25 @@ public:
     virtual void invoke_async(std::function<void()>) const = 0;
 };
 
-using Bj_net_send = std::function<void(std::span<unsigned char> data)>;
+// where a datagram comes from; undefined if the backend cannot reply by unicast
+struct Bj_net_source {
+    Bj_net_address address;
+    uint16_t port = 0;
+    bool direct = false; // sent to an address of this host rather than to the group
+
+    bool is_defined() const {
+        return address.protocol != Bj_net_protocol::undefined;
+    }
+};
+
+// to the multicast group if `destination` is undefined, by unicast otherwise
+using Bj_net_reply = std::function<void(std::span<unsigned char> data, const Bj_net_source& destination)>;
 
 // TODO: should we group these 3 handlers in a single delegate?
 using Bj_net_rx_begin_handler = std::function<void(int interface_id, const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu)>;
-using Bj_net_rx_data_handler = std::function<void(int interface_id, std::span<unsigned char> data, Bj_net_send reply)>;
+using Bj_net_rx_data_handler = std::function<void(int interface_id, std::span<unsigned char> data, const Bj_net_source& source, const Bj_net_reply& reply)>;
 using Bj_net_rx_end_handler = std::function<void(int interface_id)>;
+using Bj_net_rx_update_handler = std::function<void(int interface_id, const std::vector<Bj_net_address>& addresses)>;
 
 class Bj_net {
 public:
@@ -109,6 +156,16 @@ public:
     virtual void set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler) = 0;
     virtual void set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler) = 0;
 
+    /*
+     * Optional, must be set before opening. When the addresses of an open
+     * interface change, backends able to keep its sockets call this handler
+     * instead of the rx end and rx begin handlers, and the interface keeps
+     * its id. Without it, the interface is closed and reopened. Some of the
+     * replies given for the interface may not be valid anymore once it
+     * returns.
+     */
+    virtual void set_rx_update_handler(Bj_net_rx_update_handler rx_update_handler) {}
+
     virtual void set_log_level(int log_level) = 0;
 
     virtual void open() = 0;
@@ -116,6 +173,22 @@ public:
 
     // send to multicast group
     virtual void send(std::span<unsigned char> data) = 0;
+
+    // send to multicast group on one interface only; backends serving several interfaces override it
+    virtual void send_on_interface(int interface_id, std::span<unsigned char> data) { send(data); }
+
+    /*
+     * True if the reply given to the rx data handler can be copied and called
+     * from any thread, until the rx end or rx update handler of its interface
+     * returns. Otherwise, it must be called from the rx data handler only.
+     * The same reply object is given for all the packets received by a
+     * socket, users may keep one copy per reply object rather than one per
+     * packet.
+     */
+    virtual bool is_reply_thread_safe() const { return false; }
+
+    // key = interface_id; empty if the backend is not instrumented
+    virtual std::map<int, Bj_net_rx_stats> get_rx_stats() { return {}; }
 };
 
 class Bj_net_open_error : public std::exception {
@@ -31,6 +31,18 @@ Bj_net_interface_database::Bj_net_interface_database(const Bj_host& host, const
     view_available = false;
 }
 
+const Bj_host& Bj_net_interface_database::get_host() const
+{
+    return host;
+}
+
+void Bj_net_interface_database::set_host(const Bj_host& host)
+{
+    // the service collection keeps its view, only the host domain is rebuilt
+    this->host = host;
+    view_available = false;
+}
+
 Bj_service_collection& Bj_net_interface_database::get_service_collection()
 {
     return service_collection;
@@ -48,6 +60,23 @@ const u2_dns_database* Bj_net_interface_database::database_view()
     return &database;
 }
 
+void Bj_net_interface_database::set_multicast_time(const u2_dns_record *record, uint64_t time)
+{
+    // under load, the same records are multicast over and over: skip the writes that change nearly nothing
+    auto it = multicast_times.find(record);
+    if (it != multicast_times.end() && time - it->second.load(std::memory_order_relaxed) >= 1000000000)
+        it->second.store(time, std::memory_order_relaxed);
+}
+
+bool Bj_net_interface_database::is_recently_multicast(const u2_dns_record *record, uint64_t now) const
+{
+    auto it = multicast_times.find(record);
+    if (it == multicast_times.end())
+        return false;
+    uint64_t time = it->second.load(std::memory_order_relaxed);
+    return time != 0 && now - time <= (uint64_t)record->ttl * 1000000000 / 4;
+}
+
 void Bj_net_interface_database::build_view()
 {
     if (view_available)
@@ -61,5 +90,13 @@ void Bj_net_interface_database::build_view()
     database.domain_list = domains.data();
     database.domain_count = (int)domains.size();
 
+    // a rebuilt record may reuse the address of an older one: the history starts over
+    std::unordered_map<const u2_dns_record*, std::atomic<uint64_t>> times;
+    for (auto domain : domains) {
+        for (int i = 0; i < domain->record_count; i++)
+            times.emplace(std::piecewise_construct, std::forward_as_tuple(domain->record_list[i]), std::forward_as_tuple(0));
+    }
+    multicast_times.swap(times);
+
     view_available = true;
 }
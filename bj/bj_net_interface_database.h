@@ -25,6 +25,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <unordered_map>
 #include "bj_host.h"
 #include "bj_service_collection.h"
 
@@ -36,11 +38,22 @@ public:
     Bj_net_interface_database(const Bj_net_interface_database&) = delete;
     Bj_net_interface_database& operator= (const Bj_net_interface_database&) = delete;
 
+    const Bj_host& get_host() const;
+    void set_host(const Bj_host& host);
     Bj_service_collection& get_service_collection();
     void set_service_collection(const Bj_service_collection& service_collection);
 
     const u2_dns_database* database_view();
 
+    /*
+     * When the records of the view were last multicast, to decide whether a
+     * QU question can be answered by unicast (RFC 6762, section 5.4). Times
+     * are monotonic, in nanoseconds. Both can be called from any thread, but
+     * not while the view is being rebuilt.
+     */
+    void set_multicast_time(const u2_dns_record *record, uint64_t time);
+    bool is_recently_multicast(const u2_dns_record *record, uint64_t now) const;
+
 private:
     // input data
     Bj_host host;
@@ -50,6 +63,7 @@ private:
     bool view_available;
     std::vector<const u2_dns_domain*> domains;
     u2_dns_database database;
+    std::unordered_map<const u2_dns_record*, std::atomic<uint64_t>> multicast_times; // 0 = never
 
     void build_view();
 };
@@ -23,7 +23,12 @@
 //  DEALINGS IN THE SOFTWARE.
 //
 
+#include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
 #include "bj_server.h"
 #include "bj_util.h"
 #include "u2_base.h"
@@ -33,6 +38,62 @@
 
 const size_t mdns_msg_size_max = U2_MDNS_MSG_SIZE_MAX;
 
+struct Question_context {
+    Bj_heavy_hitters *heavy_hitters;
+    int interface_id;
+};
+
+static void count_question(void *context, const char *name, int type, int klass, bool matched)
+{
+    Question_context *question_context = (Question_context *)context;
+    question_context->heavy_hitters->add(question_context->interface_id, name, type);
+}
+
+static bool check_multicast(void *context, const u2_dns_record *record)
+{
+    auto database = (const Bj_net_interface_database *)context;
+    return database->is_recently_multicast(record, bj_util::monotonic_ns());
+}
+
+/*
+ * Queriers using another port than 5353 are legacy resolvers, only able to
+ * receive unicast responses (RFC 6762, section 6.7). Queries sent directly
+ * to this host are answered by unicast too (section 5.5). The others get
+ * unicast responses to their QU questions when the records were multicast
+ * recently (section 5.4). Without known source, everything is multicast.
+ *
+ * Only the sources on the link of the interface get unicast responses
+ * (section 11): the legacy and direct queries of the other ones are ignored,
+ * and their QU questions answered by multicast. False if the query must be
+ * ignored.
+ */
+static bool enable_unicast_responses(u2_mdns_query_proc& proc, const Bj_net_source& source, const Bj_net_interface_database& database)
+{
+    if (!source.is_defined())
+        return true;
+    bool on_link = source.address.is_on_link(database.get_host().get_addresses());
+    if (source.port != 5353) {
+        if (!on_link)
+            return false;
+        u2_mdns_query_proc_set_legacy(&proc);
+    } else if (source.direct) {
+        if (!on_link)
+            return false;
+        u2_mdns_query_proc_set_direct(&proc);
+    } else if (on_link) {
+        u2_mdns_query_proc_set_multicast_check(&proc, check_multicast, (void *)&database);
+    }
+    return true;
+}
+
+// the records of the last message of `emitter` were multicast
+static void update_multicast_times(Bj_net_interface_database& database, const u2_mdns_emitter& emitter)
+{
+    uint64_t now = bj_util::monotonic_ns();
+    for (int i = emitter.message_record_index; i < emitter.record_index; i++)
+        database.set_multicast_time(emitter.record_list[i].record, now);
+}
+
 Bj_server::Bj_server(std::string_view host_name, Bj_net& net) : host_name(host_name), net(net)
 {
     domain_name = "local";
@@ -43,22 +104,93 @@ void Bj_server::set_log_level(int log_level)
     this->log_level = log_level;
 }
 
+/**
+ * Enable the per stage latency histograms. Measuring costs a few clock reads
+ * per packet, this is why it is disabled by default.
+ */
+void Bj_server::set_latency_tracking(bool enabled)
+{
+    if (running)
+        throw std::logic_error("latency tracking must be set before starting");
+
+    latency_tracking = enabled;
+}
+
+/**
+ * Record all packets received and sent in the given capture, or stop
+ * recording if null. Can be called while running.
+ */
+void Bj_server::set_capture(std::shared_ptr<Bj_capture> capture)
+{
+    if (!running) {
+        this->capture = capture;
+        return;
+    }
+
+    net.executor().invoke_async([this, capture]() {
+        this->capture = capture;
+    });
+}
+
+/**
+ * Track the most frequent questions, including the ones about names not
+ * owned by this server. Costs a hash and a few counter updates per question.
+ */
+void Bj_server::set_heavy_hitter_tracking(bool enabled)
+{
+    if (running)
+        throw std::logic_error("heavy hitter tracking must be set before starting");
+
+    if (enabled && !heavy_hitters)
+        heavy_hitters = std::make_unique<Bj_heavy_hitters>();
+    else if (!enabled)
+        heavy_hitters.reset();
+}
+
+/**
+ * Process the queries on `worker_count` threads rather than on the executor,
+ * which then only receives them. Replies are sent directly by the workers, so
+ * the network backend must support it (Bj_net::is_reply_thread_safe()). The
+ * workers read an immutable copy of the interface databases, replaced when a
+ * service is registered. Replies are not recorded in the capture, and latency
+ * and heavy hitter tracking are not available in this mode. 0, the default,
+ * processes the queries on the executor.
+ */
+void Bj_server::set_worker_count(int worker_count)
+{
+    if (running)
+        throw std::logic_error("the worker count must be set before starting");
+
+    this->worker_count = worker_count;
+}
+
 void Bj_server::start()
 {
     if (running)
         throw std::logic_error("already started");
 
+    if (worker_count > 0) {
+        if (latency_tracking || heavy_hitters)
+            throw std::logic_error("latency and heavy hitter tracking are not supported with workers");
+        if (!net.is_reply_thread_safe())
+            throw std::logic_error("the network does not support workers");
+        workers = std::make_unique<Bj_worker_pool<Worker_job>>(worker_count, worker_queue_size, &Bj_server::handle_worker_job);
+    }
+
     running = true;
 
     Bj_net_rx_begin_handler f1 = std::bind(&Bj_server::rx_begin_handler, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
     net.set_rx_begin_handler(f1);
 
-    Bj_net_rx_data_handler f2 = std::bind(&Bj_server::rx_data_handler, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+    Bj_net_rx_data_handler f2 = std::bind(&Bj_server::rx_data_handler, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
     net.set_rx_data_handler(f2);
 
     Bj_net_rx_end_handler f3 = std::bind(&Bj_server::rx_end_handler, this, std::placeholders::_1);
     net.set_rx_end_handler(f3);
 
+    Bj_net_rx_update_handler f4 = std::bind(&Bj_server::rx_update_handler, this, std::placeholders::_1, std::placeholders::_2);
+    net.set_rx_update_handler(f4);
+
     net.executor().invoke_async([this]() {
         net.open();
         send_unsolicited_announcements();
@@ -87,6 +219,8 @@ void Bj_server::stop()
         }
     }
 
+    // all the interfaces are closed, the workers are idle
+    workers.reset();
     running = false;
 }
 
@@ -96,10 +230,80 @@ void Bj_server::register_service(std::string_view instance_name, std::string_vie
     net.executor().invoke_async([this, service]() {
         service_instances.push_back(service);
         Bj_service_collection service_collection(host_name, domain_name, service_instances);
-        for (auto& [_, interface] : interfaces) {
-            interface.database->set_service_collection(service_collection);
+        for (auto& [interface_id, interface] : interfaces) {
+            if (workers) {
+                // the workers may be reading the current database: replace it rather than modifying it
+                interface.database = std::make_shared<Bj_net_interface_database>(interface.database->get_host(), service_collection);
+                interface.database->database_view();
+                update_worker_interface(interface_id, interface, interface.worker_interface->stats);
+            } else {
+                interface.database->set_service_collection(service_collection);
+                interface.database->database_view(); // build the view now rather than while handling a query
+            }
+        }
+    });
+}
+
+std::map<int, Bj_server_latency> Bj_server::get_latency_snapshot()
+{
+    std::map<int, Bj_server_latency> snapshot;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+
+    net.executor().invoke_async([&]() {
+        for (auto& [interface_id, interface] : interfaces) {
+            snapshot[interface_id] = *interface.latency;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        done = true;
+        cv.notify_one();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!done) {
+            cv.wait(lock);
         }
+    }
+
+    return snapshot;
+}
+
+std::map<int, Bj_stats> Bj_server::get_stats_snapshot() const
+{
+    return stats_registry.snapshot();
+}
+
+std::vector<Bj_heavy_hitter> Bj_server::get_heavy_hitters(size_t count, bool reset)
+{
+    if (!heavy_hitters)
+        return {};
+
+    std::vector<Bj_heavy_hitter> result;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+
+    net.executor().invoke_async([&]() {
+        result = heavy_hitters->top(count);
+        if (reset)
+            heavy_hitters->reset();
+        std::unique_lock<std::mutex> lock(mutex);
+        done = true;
+        cv.notify_one();
     });
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!done) {
+            cv.wait(lock);
+        }
+    }
+
+    return result;
 }
 
 void Bj_server::rx_begin_handler(int interface_id, const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu)
@@ -108,22 +312,40 @@ void Bj_server::rx_begin_handler(int interface_id, const std::vector<Bj_net_addr
     Bj_host host(host_name, domain_name, addresses);
     Bj_service_collection service_collection(host_name, domain_name, service_instances);
     auto interface_db = std::make_shared<Bj_net_interface_database>(host, service_collection);
+    interface_db->database_view(); // build the view now rather than while handling a query
+    // in worker mode, each worker has its own counters, the executor keeps the first ones
+    auto stats = stats_registry.add_interface(interface_id, worker_count + 1);
     Interface interface = {
         .database = interface_db,
-        .mtu = mtu
+        .mtu = mtu,
+        .latency = std::make_shared<Bj_server_latency>(),
+        .stats = stats[0]
     };
+    if (workers)
+        update_worker_interface(interface_id, interface, stats);
     interfaces[interface_id] = interface;
     if (log_level >= 1) {
         u2_dns_database_dump(interface_db->database_view(), 0);
         printf("\n");
     }
-    send_unsolicited_announcements(interface);
+    send_unsolicited_announcements(interface_id, interface);
 }
 
-void Bj_server::rx_data_handler(int interface_id, std::span<unsigned char> data, Bj_net_send reply)
+void Bj_server::rx_data_handler(int interface_id, std::span<unsigned char> data, const Bj_net_source& source, const Bj_net_reply& reply)
 {
-    assert(interfaces.contains(interface_id));
-    auto interface = interfaces[interface_id];
+    auto it = interfaces.find(interface_id);
+    assert(it != interfaces.end());
+    Interface& interface = it->second;
+
+    uint64_t start_time = latency_tracking ? bj_util::monotonic_ns() : 0;
+    uint64_t send_time = 0;
+
+    Bj_stats stats;
+    stats.rx_packet_count = 1;
+    stats.rx_byte_count = data.size();
+
+    if (capture)
+        capture->record(interface_id, Bj_capture_direction::rx, data);
 
     if (log_level >= 2) {
         printf("### INPUT MSG\n");
@@ -132,6 +354,22 @@ void Bj_server::rx_data_handler(int interface_id, std::span<unsigned char> data,
         printf("\n");
     }
 
+    if (workers) {
+        Worker_job *job = data.size() <= sizeof(job->data) ? workers->reserve() : nullptr;
+        if (!job) {
+            stats.dropped_packet_count = 1;
+            interface.stats->add(stats);
+            return;
+        }
+        job->interface = interface.worker_interface;
+        job->source = source;
+        job->reply = get_worker_reply(interface, reply);
+        job->size = data.size();
+        memcpy(job->data, data.data(), data.size());
+        workers->commit();
+        return;
+    }
+
     size_t msg_mtu = U2_MIN(mdns_msg_size_max, interface.mtu.mtu);
     size_t msg_header_size = interface.mtu.ip_header_size + interface.mtu.udp_header_size;
     assert(msg_header_size < msg_mtu);
@@ -141,12 +379,36 @@ void Bj_server::rx_data_handler(int interface_id, std::span<unsigned char> data,
 
     struct u2_mdns_query_proc proc;
     u2_mdsn_query_proc_init(&proc, data.data(), data.size(), interface.database->database_view());
+    if (!enable_unicast_responses(proc, source, *interface.database)) {
+        stats.off_link_query_count = 1;
+        interface.stats->add(stats);
+        return;
+    }
+    if (latency_tracking)
+        u2_mdns_query_proc_set_clock(&proc, bj_util::monotonic_ns);
+    Question_context question_context = { heavy_hitters.get(), interface_id };
+    if (heavy_hitters)
+        u2_mdns_query_proc_set_question_handler(&proc, count_question, &question_context);
     for (;;) {
         unsigned char out_msg[mdns_msg_size_max];
         size_t out_size = u2_mdns_query_proc_run(&proc, out_msg, msg_ideal_size, msg_max_size);
         if (out_size == 0)
             break;
-        reply(std::span(out_msg, out_size));
+        bool unicast = u2_mdns_query_proc_is_unicast(&proc);
+        stats.tx_packet_count++;
+        stats.tx_unicast_packet_count += unicast;
+        stats.tx_byte_count += out_size;
+        if (latency_tracking) {
+            uint64_t t0 = bj_util::monotonic_ns();
+            reply(std::span(out_msg, out_size), unicast ? source : Bj_net_source());
+            send_time += bj_util::monotonic_ns() - t0;
+        } else {
+            reply(std::span(out_msg, out_size), unicast ? source : Bj_net_source());
+        }
+        if (!unicast)
+            update_multicast_times(*interface.database, proc.emitter);
+        if (capture)
+            capture->record(interface_id, Bj_capture_direction::tx, std::span(out_msg, out_size));
         if (log_level >= 1) {
             printf("### OUTPUT MSG - REPLY\n");
             u2_dns_data_dump(out_msg, out_size, 2);
@@ -154,21 +416,142 @@ void Bj_server::rx_data_handler(int interface_id, std::span<unsigned char> data,
             printf("\n");
         }
     }
+
+    if (proc.decoding_error)
+        stats.decoding_error_count = 1;
+    stats.add_query_stats(proc.stats);
+    interface.stats->add(stats);
+
+    // messages without questions (responses from other hosts) are not taken into account
+    if (latency_tracking && proc.question_count > 0) {
+        Bj_server_latency& latency = *interface.latency;
+        latency.decode.record(proc.stage_time[U2_MDNS_STAGE_DECODE]);
+        latency.known_answers.record(proc.stage_time[U2_MDNS_STAGE_KNOWN_ANSWERS]);
+        latency.additional_records.record(proc.stage_time[U2_MDNS_STAGE_ADDITIONAL]);
+        latency.emission.record(proc.stage_time[U2_MDNS_STAGE_EMIT]);
+        latency.send.record(send_time);
+        latency.total.record(bj_util::monotonic_ns() - start_time);
+    }
 }
 
 void Bj_server::rx_end_handler(int interface_id)
 {
+    // the reply of this interface must not be used anymore once we return
+    if (workers)
+        workers->drain();
+
     interfaces.erase(interface_id);
+    stats_registry.remove_interface(interface_id);
+}
+
+void Bj_server::rx_update_handler(int interface_id, const std::vector<Bj_net_address>& addresses)
+{
+    auto it = interfaces.find(interface_id);
+    assert(it != interfaces.end());
+    Interface& interface = it->second;
+
+    // only the host records change, the services and the counters are kept
+    std::vector<Bj_net_address> previous_addresses = interface.database->get_host().get_addresses();
+    Bj_host host(host_name, domain_name, addresses);
+    if (workers) {
+        // no job may use a reply of this interface anymore, the backend may have released some of them
+        workers->drain();
+        interface.worker_replies.clear();
+
+        // the workers may be reading the current database: replace it rather than modifying it
+        auto interface_db = std::make_shared<Bj_net_interface_database>(host, interface.database->get_service_collection());
+        interface_db->database_view();
+        interface.database = interface_db;
+        update_worker_interface(interface_id, interface, interface.worker_interface->stats);
+    } else {
+        interface.database->set_host(host);
+        interface.database->database_view(); // build the view now rather than while handling a query
+    }
+    if (log_level >= 1) {
+        u2_dns_database_dump(interface.database->database_view(), 0);
+        printf("\n");
+    }
+    send_address_announcements(interface_id, interface, previous_addresses);
+}
+
+void Bj_server::update_worker_interface(int interface_id, Interface& interface, std::vector<std::shared_ptr<Bj_stats_counters>> stats)
+{
+    auto worker_interface = std::make_shared<Worker_interface>();
+    worker_interface->interface_id = interface_id;
+    worker_interface->database = interface.database;
+    worker_interface->database_view = interface.database->database_view();
+    worker_interface->mtu = interface.mtu;
+    worker_interface->stats = stats;
+    interface.worker_interface = worker_interface;
+}
+
+// the backend reply objects stay valid until the rx end or rx update handler of their interface
+const Bj_net_reply *Bj_server::get_worker_reply(Interface& interface, const Bj_net_reply& reply)
+{
+    for (auto& [key, copy] : interface.worker_replies) {
+        if (key == &reply)
+            return copy.get();
+    }
+    interface.worker_replies.push_back({ &reply, std::make_shared<const Bj_net_reply>(reply) });
+    return interface.worker_replies.back().second.get();
+}
+
+void Bj_server::handle_worker_job(int worker_index, Worker_job& job)
+{
+    const Worker_interface& interface = *job.interface;
+
+    Bj_stats stats;
+    stats.rx_packet_count = 1;
+    stats.rx_byte_count = job.size;
+
+    size_t msg_mtu = U2_MIN(mdns_msg_size_max, interface.mtu.mtu);
+    size_t msg_header_size = interface.mtu.ip_header_size + interface.mtu.udp_header_size;
+    assert(msg_header_size < msg_mtu);
+
+    size_t msg_ideal_size = msg_mtu - msg_header_size;
+    size_t msg_max_size = mdns_msg_size_max - msg_header_size;
+
+    struct u2_mdns_query_proc proc;
+    u2_mdsn_query_proc_init(&proc, job.data, job.size, interface.database_view);
+    if (!enable_unicast_responses(proc, job.source, *interface.database)) {
+        stats.off_link_query_count = 1;
+        interface.stats[worker_index + 1]->add(stats);
+        job.interface.reset();
+        job.reply = nullptr;
+        return;
+    }
+    for (;;) {
+        unsigned char out_msg[mdns_msg_size_max];
+        size_t out_size = u2_mdns_query_proc_run(&proc, out_msg, msg_ideal_size, msg_max_size);
+        if (out_size == 0)
+            break;
+        bool unicast = u2_mdns_query_proc_is_unicast(&proc);
+        stats.tx_packet_count++;
+        stats.tx_unicast_packet_count += unicast;
+        stats.tx_byte_count += out_size;
+        (*job.reply)(std::span(out_msg, out_size), unicast ? job.source : Bj_net_source());
+        if (!unicast)
+            update_multicast_times(*interface.database, proc.emitter);
+    }
+
+    if (proc.decoding_error)
+        stats.decoding_error_count = 1;
+    stats.add_query_stats(proc.stats);
+    interface.stats[worker_index + 1]->add(stats);
+
+    // the job is reused, do not keep the interface alive
+    job.interface.reset();
+    job.reply = nullptr;
 }
 
 void Bj_server::send_unsolicited_announcements()
 {
-    for (auto& [_, interface] : interfaces) {
-        send_unsolicited_announcements(interface);
+    for (auto& [interface_id, interface] : interfaces) {
+        send_unsolicited_announcements(interface_id, interface);
     }
 }
 
-void Bj_server::send_unsolicited_announcements(Interface& interface)
+void Bj_server::send_unsolicited_announcements(int interface_id, Interface& interface)
 {
     std::vector<u2_mdns_response_record> records;
 
@@ -186,6 +569,60 @@ void Bj_server::send_unsolicited_announcements(Interface& interface)
         }
     }
 
+    send_unsolicited_records(interface_id, interface, records, false);
+}
+
+/*
+ * Goodbyes (RFC 6762, section 10.1) for the addresses that are gone, then
+ * the new address records. The records are announced with the cache-flush
+ * bit, which makes the other hosts forget the older records of the same
+ * type: all the records of a type are announced as soon as one of them
+ * changed, the types left untouched are not announced.
+ */
+void Bj_server::send_address_announcements(int interface_id, Interface& interface, const std::vector<Bj_net_address>& previous_addresses)
+{
+    const std::vector<Bj_net_address>& addresses = interface.database->get_host().get_addresses();
+
+    std::vector<Bj_net_address> removed_addresses;
+    bool changed[2] = { false, false }; // ipv4, ipv6
+    for (auto& address : previous_addresses) {
+        if (std::find(addresses.begin(), addresses.end(), address) == addresses.end()) {
+            removed_addresses.push_back(address);
+            changed[address.protocol == Bj_net_protocol::ipv6] = true;
+        }
+    }
+    for (auto& address : addresses) {
+        if (std::find(previous_addresses.begin(), previous_addresses.end(), address) == previous_addresses.end())
+            changed[address.protocol == Bj_net_protocol::ipv6] = true;
+    }
+
+    // a goodbye must not flush the records still valid
+    Bj_host removed_host(host_name, domain_name, removed_addresses);
+    const u2_dns_domain *removed_domain = removed_host.domain_view();
+    std::vector<u2_dns_record> goodbye_records;
+    for (int i = 0; i < removed_domain->record_count; i++) {
+        if (removed_domain->record_list[i]->type == U2_DNS_RR_TYPE_NSEC)
+            continue;
+        goodbye_records.push_back(*removed_domain->record_list[i]);
+        goodbye_records.back().cache_flush = false;
+    }
+    std::vector<u2_mdns_response_record> records;
+    for (auto& record : goodbye_records)
+        records.push_back({ .category = U2_DNS_RR_CATEGORY_ANSWER, .record = &record });
+    send_unsolicited_records(interface_id, interface, records, true);
+
+    records.clear();
+    const u2_dns_domain *host_domain = interface.database->database_view()->domain_list[0]; // the host domain comes first
+    for (int i = 0; i < host_domain->record_count; i++) {
+        const u2_dns_record *record = host_domain->record_list[i];
+        if ((record->type == U2_DNS_RR_TYPE_A && changed[0]) || (record->type == U2_DNS_RR_TYPE_AAAA && changed[1]))
+            records.push_back({ .category = U2_DNS_RR_CATEGORY_ANSWER, .record = record });
+    }
+    send_unsolicited_records(interface_id, interface, records, false);
+}
+
+void Bj_server::send_unsolicited_records(int interface_id, Interface& interface, const std::vector<u2_mdns_response_record>& records, bool tear_down)
+{
     size_t msg_mtu = U2_MIN(mdns_msg_size_max, interface.mtu.mtu);
     size_t msg_header_size = interface.mtu.ip_header_size + interface.mtu.udp_header_size;
     assert(msg_header_size < msg_mtu);
@@ -194,14 +631,21 @@ void Bj_server::send_unsolicited_announcements(Interface& interface)
     size_t msg_max_size = mdns_msg_size_max - msg_header_size;
 
     if (!records.empty()) {
+        Bj_stats stats;
         struct u2_mdns_emitter emitter;
-        u2_mdns_emitter_init(&emitter, records.data(), (int)records.size(), 0, false);
+        u2_mdns_emitter_init(&emitter, records.data(), (int)records.size(), 0, tear_down);
         unsigned char out_msg[mdns_msg_size_max];
         for (;;) {
             size_t out_size = u2_mdns_emitter_run(&emitter, out_msg, msg_ideal_size, msg_max_size);
             if (!out_size)
                 break;
-            net.send(std::span(out_msg, out_size));
+            stats.tx_packet_count++;
+            stats.tx_byte_count += out_size;
+            net.send_on_interface(interface_id, std::span(out_msg, out_size));
+            if (!tear_down)
+                update_multicast_times(*interface.database, emitter);
+            if (capture)
+                capture->record(interface_id, Bj_capture_direction::tx, std::span(out_msg, out_size));
             if (log_level >= 1) {
                 printf("### OUTPUT MSG - UNSOLICITED\n");
                 u2_dns_data_dump(out_msg, out_size, 2);
@@ -209,5 +653,7 @@ void Bj_server::send_unsolicited_announcements(Interface& interface)
                 printf("\n");
             }
         }
+        stats.dropped_record_count = emitter.dropped_record_count;
+        interface.stats->add(stats);
     }
 }
@@ -25,29 +25,89 @@
 
 #pragma once
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include "bj_net.h"
 #include "bj_host.h"
 #include "bj_service_collection.h"
 #include "bj_net_interface_database.h"
+#include "bj_capture.h"
+#include "bj_heavy_hitters.h"
+#include "bj_histogram.h"
+#include "bj_stats.h"
+#include "bj_worker_pool.h"
 #include "u2_mdns.h"
 
+// per packet time spent in each stage of the rx data handler, in nanoseconds
+struct Bj_server_latency {
+    Bj_histogram decode;
+    Bj_histogram known_answers;
+    Bj_histogram additional_records;
+    Bj_histogram emission;
+    Bj_histogram send;
+    Bj_histogram total;
+};
+
 class Bj_server {
 public:
     Bj_server(std::string_view host_name, Bj_net& net);
     void set_log_level(int log_level);
+    void set_latency_tracking(bool enabled);
+    void set_capture(std::shared_ptr<Bj_capture> capture);
+    void set_heavy_hitter_tracking(bool enabled);
+    void set_worker_count(int worker_count);
     void start();
     void stop();
     void register_service(std::string_view instance_name, std::string_view service_name, uint16_t port, std::span<const char> txt_record);
 
+    // key = interface_id; must not be called from the executor
+    std::map<int, Bj_server_latency> get_latency_snapshot();
+
+    // key = interface_id; can be called from any thread
+    std::map<int, Bj_stats> get_stats_snapshot() const;
+
+    // most queried (name, type, interface) tuples; must not be called from the executor
+    std::vector<Bj_heavy_hitter> get_heavy_hitters(size_t count, bool reset = false);
+
 private:
+    static constexpr uint32_t worker_queue_size = 256;
+
+    // what the workers need from an interface; replaced, never modified, once shared
+    struct Worker_interface {
+        int interface_id;
+        std::shared_ptr<Bj_net_interface_database> database; // owns the view
+        const u2_dns_database *database_view;
+        Bj_net_mtu mtu;
+        std::vector<std::shared_ptr<Bj_stats_counters>> stats; // index = worker index + 1
+    };
+
+    struct Worker_job {
+        std::shared_ptr<const Worker_interface> interface;
+        Bj_net_source source;
+        const Bj_net_reply *reply; // owned by Interface::worker_replies
+        size_t size;
+        unsigned char data[U2_MDNS_MSG_SIZE_MAX];
+    };
+
     struct Interface {
         std::shared_ptr<Bj_net_interface_database> database;
         Bj_net_mtu mtu;
+        std::shared_ptr<Bj_server_latency> latency;
+        std::shared_ptr<Bj_stats_counters> stats;
+        std::shared_ptr<const Worker_interface> worker_interface; // worker mode only
+
+        // worker mode only: copies of the replies given by the backend, one per reply object (sub-layer),
+        // made once so that handing a packet to a worker does not allocate; cleared once the workers are drained
+        std::vector<std::pair<const Bj_net_reply *, std::shared_ptr<const Bj_net_reply>>> worker_replies;
     };
 
     int log_level = 0;
+    bool latency_tracking = false;
+    std::shared_ptr<Bj_capture> capture;
+    std::unique_ptr<Bj_heavy_hitters> heavy_hitters;
+    int worker_count = 0;
+    std::unique_ptr<Bj_worker_pool<Worker_job>> workers;
     std::string host_name;
     std::string domain_name;
     bool running = false;
@@ -55,10 +115,17 @@ private:
     std::vector<Bj_service_instance> service_instances;
 
     std::map<int, Interface> interfaces; // key = interface_id
+    Bj_stats_registry stats_registry;
 
     void rx_begin_handler(int interface_id, const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu);
-    void rx_data_handler(int interface_id, std::span<unsigned char> data, Bj_net_send reply);
+    void rx_data_handler(int interface_id, std::span<unsigned char> data, const Bj_net_source& source, const Bj_net_reply& reply);
     void rx_end_handler(int interface_id);
+    void rx_update_handler(int interface_id, const std::vector<Bj_net_address>& addresses);
+    void update_worker_interface(int interface_id, Interface& interface, std::vector<std::shared_ptr<Bj_stats_counters>> stats);
+    static const Bj_net_reply *get_worker_reply(Interface& interface, const Bj_net_reply& reply);
+    static void handle_worker_job(int worker_index, Worker_job& job);
     void send_unsolicited_announcements();
-    void send_unsolicited_announcements(Interface& interface);
+    void send_unsolicited_announcements(int interface_id, Interface& interface);
+    void send_address_announcements(int interface_id, Interface& interface, const std::vector<Bj_net_address>& previous_addresses);
+    void send_unsolicited_records(int interface_id, Interface& interface, const std::vector<u2_mdns_response_record>& records, bool tear_down);
 };
@@ -57,6 +57,8 @@ void Bj_service::build_view()
     if (view_available)
         return;
 
+    domains.clear();
+    records.clear();
     for (auto& instance : service_instances) {
         const u2_dns_domain* instance_domain = instance.domain_view();
         domains.push_back(instance_domain);
@@ -73,6 +75,7 @@ void Bj_service::build_view()
         records.push_back(r);
     }
 
+    record_ptrs.clear();
     for (auto& record : records) {
         record_ptrs.push_back(&record);
     }
@@ -73,6 +73,8 @@ void Bj_service_collection::build_view()
 
     // create services
 
+    services.clear();
+    dns_service_names.clear();
     for (const auto& [key, value] : service_map) {
         services.push_back(Bj_service(key, domain_name, value));
         dns_service_names.push_back(bj_util::dns_name(key + "." + domain_name));
@@ -80,6 +82,7 @@ void Bj_service_collection::build_view()
 
     // create enum service
 
+    enum_service_records.clear();
     for (auto& dns_service_name : dns_service_names) {
         u2_dns_record r = {
             .domain = &enum_service_domain,
@@ -93,6 +96,7 @@ void Bj_service_collection::build_view()
         enum_service_records.push_back(r);
     }
 
+    enum_service_record_ptrs.clear();
     for (auto& record : enum_service_records) {
         enum_service_record_ptrs.push_back(&record);
     }
@@ -103,6 +107,7 @@ void Bj_service_collection::build_view()
 
     // put all domains in a list
 
+    domains.clear();
     for (auto& service : services) {
         auto service_domains = service.domains_view();
         domains.insert(domains.end(), service_domains.begin(), service_domains.end());
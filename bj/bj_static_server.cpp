@@ -24,6 +24,8 @@
 //
 
 #include <cassert>
+#include <condition_variable>
+#include <mutex>
 #include "bj_static_server.h"
 #include "bj_util.h"
 #include "u2_base.h"
@@ -38,6 +40,22 @@ void Bj_static_server::set_log_level(int log_level)
     this->log_level = log_level;
 }
 
+/**
+ * Record all packets received and sent in the given capture, or stop
+ * recording if null. Can be called while running.
+ */
+void Bj_static_server::set_capture(std::shared_ptr<Bj_capture> capture)
+{
+    if (!running) {
+        this->capture = capture;
+        return;
+    }
+
+    net.executor().invoke_async([this, capture]() {
+        this->capture = capture;
+    });
+}
+
 void Bj_static_server::start()
 {
     if (running)
@@ -48,7 +66,7 @@ void Bj_static_server::start()
     Bj_net_rx_begin_handler f1 = std::bind(&Bj_static_server::rx_begin_handler, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
     net.set_rx_begin_handler(f1);
 
-    Bj_net_rx_data_handler f2 = std::bind(&Bj_static_server::rx_data_handler, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+    Bj_net_rx_data_handler f2 = std::bind(&Bj_static_server::rx_data_handler, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
     net.set_rx_data_handler(f2);
 
     net.executor().invoke_async([this]() {
@@ -82,14 +100,25 @@ void Bj_static_server::stop()
     running = false;
 }
 
+std::map<int, Bj_stats> Bj_static_server::get_stats_snapshot() const
+{
+    return stats_registry.snapshot();
+}
+
 void Bj_static_server::rx_begin_handler(int interface_id, const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu)
 {
     assert(this->mtu.mtu == 0);
+    this->interface_id = interface_id;
     this->mtu = mtu;
+    this->addresses = addresses;
+    stats = stats_registry.add_interface(interface_id);
 }
 
-void Bj_static_server::rx_data_handler(int interface_id, std::span<unsigned char> data, Bj_net_send reply)
+void Bj_static_server::rx_data_handler(int interface_id, std::span<unsigned char> data, const Bj_net_source& source, const Bj_net_reply& reply)
 {
+    if (capture)
+        capture->record(interface_id, Bj_capture_direction::rx, data);
+
     if (log_level >= 1) {
         printf("### INPUT MSG\n");
         u2_dns_data_dump(data.data(), data.size(), 2);
@@ -105,14 +134,37 @@ void Bj_static_server::rx_data_handler(int interface_id, std::span<unsigned char
     size_t msg_ideal_size = msg_mtu - msg_header_size;
     size_t msg_max_size = mdns_msg_size_max - msg_header_size;
 
+    Bj_stats stats;
+    stats.rx_packet_count = 1;
+    stats.rx_byte_count = data.size();
+
     struct u2_mdns_query_proc proc;
     u2_mdsn_query_proc_init(&proc, data.data(), data.size(), &database);
+
+    // legacy queriers and direct queries only; without multicast history, QU questions are answered by multicast
+    // RFC 6762, section 11: legacy and direct queries from off-link sources are ignored
+    if (source.is_defined() && (source.port != 5353 || source.direct) && !source.address.is_on_link(addresses)) {
+        stats.off_link_query_count = 1;
+        this->stats->add(stats);
+        return;
+    }
+    if (source.is_defined() && source.port != 5353)
+        u2_mdns_query_proc_set_legacy(&proc);
+    else if (source.is_defined() && source.direct)
+        u2_mdns_query_proc_set_direct(&proc);
+
     for (;;) {
         unsigned char out_msg[mdns_msg_size_max];
         size_t out_size = u2_mdns_query_proc_run(&proc, out_msg, msg_ideal_size, msg_max_size);
         if (out_size == 0)
             break;
-        reply(std::span(out_msg, out_size));
+        bool unicast = u2_mdns_query_proc_is_unicast(&proc);
+        stats.tx_packet_count++;
+        stats.tx_unicast_packet_count += unicast;
+        stats.tx_byte_count += out_size;
+        reply(std::span(out_msg, out_size), unicast ? source : Bj_net_source());
+        if (capture)
+            capture->record(interface_id, Bj_capture_direction::tx, std::span(out_msg, out_size));
         if (log_level >= 1) {
             printf("### OUTPUT MSG - REPLY\n");
             u2_dns_data_dump(out_msg, out_size, 2);
@@ -120,6 +172,11 @@ void Bj_static_server::rx_data_handler(int interface_id, std::span<unsigned char
             printf("\n");
         }
     }
+
+    if (proc.decoding_error)
+        stats.decoding_error_count = 1;
+    stats.add_query_stats(proc.stats);
+    this->stats->add(stats);
 }
 
 void Bj_static_server::send_unsolicited_announcements()
@@ -151,6 +208,7 @@ void Bj_static_server::send_unsolicited_announcements()
     size_t msg_max_size = mdns_msg_size_max - msg_header_size;
 
     if (record_count) {
+        Bj_stats stats;
         struct u2_mdns_emitter emitter;
         u2_mdns_emitter_init(&emitter, record_list, record_count, 0, false);
         unsigned char out_msg[mdns_msg_size_max];
@@ -158,7 +216,11 @@ void Bj_static_server::send_unsolicited_announcements()
             size_t out_size = u2_mdns_emitter_run(&emitter, out_msg, msg_ideal_size, msg_max_size);
             if (!out_size)
                 break;
+            stats.tx_packet_count++;
+            stats.tx_byte_count += out_size;
             net.send(std::span(out_msg, out_size));
+            if (capture)
+                capture->record(interface_id, Bj_capture_direction::tx, std::span(out_msg, out_size));
             if (log_level >= 1) {
                 printf("### OUTPUT MSG - UNSOLICITED\n");
                 u2_dns_data_dump(out_msg, out_size, 2);
@@ -166,5 +228,7 @@ void Bj_static_server::send_unsolicited_announcements()
                 printf("\n");
             }
         }
+        stats.dropped_record_count = emitter.dropped_record_count;
+        this->stats->add(stats);
     }
 }
@@ -24,24 +24,35 @@
 //
 
 #pragma once
+#include "bj_capture.h"
 #include "bj_net.h"
+#include "bj_stats.h"
 #include "u2_mdns.h"
 
 class Bj_static_server {
 public:
-    constexpr Bj_static_server(Bj_net& net, const struct u2_dns_database& database): net(net), database(database) {}
+    Bj_static_server(Bj_net& net, const struct u2_dns_database& database): database(database), net(net) {}
     void set_log_level(int log_level);
+    void set_capture(std::shared_ptr<Bj_capture> capture);
     void start();
     void stop();
 
+    // key = interface_id; can be called from any thread
+    std::map<int, Bj_stats> get_stats_snapshot() const;
+
 private:
     int log_level = 0;
     bool running = false;
     const struct u2_dns_database& database;
     Bj_net& net;
-    Bj_net_mtu mtu;
+    int interface_id = 0;
+    Bj_net_mtu mtu = {};
+    std::vector<Bj_net_address> addresses; // of the interface
+    std::shared_ptr<Bj_capture> capture;
+    Bj_stats_registry stats_registry;
+    std::shared_ptr<Bj_stats_counters> stats; // single interface
 
     void rx_begin_handler(int interface_id, const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu);
-    void rx_data_handler(int interface_id, std::span<unsigned char> data, Bj_net_send reply);
+    void rx_data_handler(int interface_id, std::span<unsigned char> data, const Bj_net_source& source, const Bj_net_reply& reply);
     void send_unsolicited_announcements();
 };
@@ -0,0 +1,108 @@
+//
+//  bj_stats.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#include "bj_stats.h"
+
+void Bj_stats::add_query_stats(const u2_mdns_query_stats& stats)
+{
+    question_count += stats.question_count;
+    matched_question_count += stats.matched_question_count;
+    unmatched_question_count += stats.question_count - stats.matched_question_count;
+    known_answer_count += stats.known_answer_count;
+    overflow_record_count += stats.overflow_record_count;
+    dropped_record_count += stats.dropped_record_count;
+}
+
+void Bj_stats_counters::add(const Bj_stats& delta)
+{
+    // single writer: plain loads and stores are enough, no read-modify-write needed
+    uint64_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < field_count; i++) {
+        uint64_t value = delta.*fields[i];
+        if (value)
+            values[i].store(values[i].load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+Bj_stats Bj_stats_counters::load() const
+{
+    Bj_stats stats;
+    for (;;) {
+        uint64_t seq1 = sequence.load(std::memory_order_acquire);
+        if (seq1 & 1)
+            continue; // update in progress
+        for (size_t i = 0; i < field_count; i++) {
+            stats.*fields[i] = values[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t seq2 = sequence.load(std::memory_order_relaxed);
+        if (seq1 == seq2)
+            return stats;
+    }
+}
+
+void Bj_stats_counters::add_to(Bj_stats& stats) const
+{
+    Bj_stats values = load();
+    for (size_t i = 0; i < field_count; i++) {
+        stats.*fields[i] += values.*fields[i];
+    }
+}
+
+std::shared_ptr<Bj_stats_counters> Bj_stats_registry::add_interface(int interface_id)
+{
+    return add_interface(interface_id, 1)[0];
+}
+
+std::vector<std::shared_ptr<Bj_stats_counters>> Bj_stats_registry::add_interface(int interface_id, size_t writer_count)
+{
+    std::vector<std::shared_ptr<Bj_stats_counters>> interface_counters;
+    for (size_t i = 0; i < writer_count; i++)
+        interface_counters.push_back(std::make_shared<Bj_stats_counters>());
+    std::unique_lock<std::mutex> lock(mutex);
+    counters[interface_id] = interface_counters;
+    return interface_counters;
+}
+
+void Bj_stats_registry::remove_interface(int interface_id)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    counters.erase(interface_id);
+}
+
+std::map<int, Bj_stats> Bj_stats_registry::snapshot() const
+{
+    std::map<int, Bj_stats> stats;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto& [interface_id, interface_counters] : counters) {
+        Bj_stats& interface_stats = stats[interface_id];
+        for (auto& writer_counters : interface_counters)
+            writer_counters->add_to(interface_stats);
+    }
+    return stats;
+}
@@ -0,0 +1,105 @@
+//
+//  bj_stats.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "u2_mdns.h"
+
+struct Bj_stats {
+    uint64_t rx_packet_count = 0;
+    uint64_t rx_byte_count = 0;
+    uint64_t question_count = 0;
+    uint64_t matched_question_count = 0;
+    uint64_t unmatched_question_count = 0;
+    uint64_t known_answer_count = 0;      // answers suppressed by known answers
+    uint64_t tx_packet_count = 0;
+    uint64_t tx_unicast_packet_count = 0; // part of tx_packet_count, sent to the querier only
+    uint64_t tx_byte_count = 0;
+    uint64_t decoding_error_count = 0;
+    uint64_t overflow_record_count = 0;   // answers lost because u2_mdns_query_proc.record_list was full
+    uint64_t dropped_record_count = 0;    // records too big to fit in a message
+    uint64_t dropped_packet_count = 0;    // packets received but not handled because the workers were late
+    uint64_t off_link_query_count = 0;    // unicast queries ignored because their source is not on the link (RFC 6762, section 11)
+
+    void add_query_stats(const u2_mdns_query_stats& stats);
+};
+
+/**
+ * Statistics of one interface.
+ * There must be a single writer, typically the executor. Readers can run on
+ * any thread: a sequence counter ensures that they get a consistent snapshot
+ * without ever blocking the writer.
+ */
+class alignas(64) Bj_stats_counters {
+public:
+    void add(const Bj_stats& delta);
+    Bj_stats load() const;
+    void add_to(Bj_stats& stats) const;
+
+private:
+    static constexpr uint64_t Bj_stats::* fields[] = {
+        &Bj_stats::rx_packet_count,
+        &Bj_stats::rx_byte_count,
+        &Bj_stats::question_count,
+        &Bj_stats::matched_question_count,
+        &Bj_stats::unmatched_question_count,
+        &Bj_stats::known_answer_count,
+        &Bj_stats::tx_packet_count,
+        &Bj_stats::tx_unicast_packet_count,
+        &Bj_stats::tx_byte_count,
+        &Bj_stats::decoding_error_count,
+        &Bj_stats::overflow_record_count,
+        &Bj_stats::dropped_record_count,
+        &Bj_stats::dropped_packet_count,
+        &Bj_stats::off_link_query_count,
+    };
+    static constexpr size_t field_count = sizeof(fields) / sizeof(*fields);
+
+    std::atomic<uint64_t> sequence = 0;
+    std::array<std::atomic<uint64_t>, field_count> values = {};
+};
+
+/**
+ * Set of per interface counters. Adding and removing interfaces takes a
+ * lock, updating the counters does not. An interface updated from several
+ * threads gets one set of counters per writer, summed in snapshots.
+ */
+class Bj_stats_registry {
+public:
+    std::shared_ptr<Bj_stats_counters> add_interface(int interface_id);
+    std::vector<std::shared_ptr<Bj_stats_counters>> add_interface(int interface_id, size_t writer_count);
+    void remove_interface(int interface_id);
+    std::map<int, Bj_stats> snapshot() const; // key = interface_id
+
+private:
+    mutable std::mutex mutex;
+    std::map<int, std::vector<std::shared_ptr<Bj_stats_counters>>> counters;
+};
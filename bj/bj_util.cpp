@@ -25,6 +25,8 @@
 
 #include "bj_util.h"
 #include <stdio.h>
+#include <chrono>
+#include <stdexcept>
 #include "u2_dns_dump.h"
 
 namespace bj_util
@@ -62,4 +64,13 @@ std::string dns_name(std::string_view name)
     return dns_name;
 }
 
+/**
+ * Monotonic clock, in nanoseconds. Usable as `u2_mdns_clock_t`.
+ */
+uint64_t monotonic_ns()
+{
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
+
 } // namespace
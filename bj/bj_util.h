@@ -24,6 +24,7 @@
 //
 
 #pragma once
+#include <cstdint>
 #include <span>
 #include <string>
 
@@ -32,5 +33,6 @@ namespace bj_util
 
 void dump_data(std::span<unsigned char> data, int indent = 0);
 std::string dns_name(std::string_view name);
+uint64_t monotonic_ns();
 
 }
@@ -0,0 +1,190 @@
+//
+//  bj_worker_pool.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+/**
+ * Threads handling jobs handed over by a single producer, typically the
+ * network executor. Each worker has its own bounded lock-free queue of
+ * preallocated jobs: the producer fills a job in place with reserve() and
+ * publishes it with commit(), and jobs are spread round-robin over the
+ * workers. A worker spins for a while when its queue gets empty, then sleeps
+ * until the producer wakes it up.
+ *
+ * Jobs are reused: the handler should release what they hold.
+ */
+template <class Job>
+class Bj_worker_pool {
+public:
+    using Handler = std::function<void(int worker_index, Job& job)>;
+
+    // queue_size must be a power of two
+    Bj_worker_pool(int worker_count, uint32_t queue_size, Handler handler);
+    ~Bj_worker_pool();
+
+    Bj_worker_pool(const Bj_worker_pool&) = delete;
+    Bj_worker_pool& operator= (const Bj_worker_pool&) = delete;
+
+    int get_worker_count() const { return worker_count; }
+
+    // producer side; null if all the queues are full
+    Job *reserve();
+    void commit();
+
+    // producer side; wait until all the committed jobs are handled
+    void drain();
+
+private:
+    static constexpr int spin_count = 2000;
+
+    struct Queue {
+        std::unique_ptr<Job[]> jobs;
+        alignas(64) std::atomic<uint32_t> tail = 0; // written by the producer
+        std::atomic<uint32_t> signal = 0;           // bumped to wake up the worker
+        alignas(64) std::atomic<uint32_t> head = 0; // written by the worker
+        std::atomic<bool> sleeping = false;
+    };
+
+    int worker_count;
+    uint32_t queue_size;
+    Handler handler;
+    std::unique_ptr<Queue[]> queues;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping = false;
+    int next_queue = 0;
+    int reserved_queue = -1;
+
+    void run(int worker_index);
+    static void wake_up(Queue& queue);
+};
+
+template <class Job>
+Bj_worker_pool<Job>::Bj_worker_pool(int worker_count, uint32_t queue_size, Handler handler) : worker_count(worker_count), queue_size(queue_size), handler(handler)
+{
+    if (worker_count <= 0 || queue_size == 0 || (queue_size & (queue_size - 1)))
+        throw std::invalid_argument("invalid worker pool size");
+
+    queues = std::make_unique<Queue[]>(worker_count);
+    for (int i = 0; i < worker_count; i++)
+        queues[i].jobs = std::make_unique<Job[]>(queue_size);
+    for (int i = 0; i < worker_count; i++)
+        threads.emplace_back(&Bj_worker_pool::run, this, i);
+}
+
+template <class Job>
+Bj_worker_pool<Job>::~Bj_worker_pool()
+{
+    // the jobs still queued are handled before the workers exit
+    stopping.store(true);
+    for (int i = 0; i < worker_count; i++)
+        wake_up(queues[i]);
+    for (auto& thread : threads)
+        thread.join();
+}
+
+template <class Job>
+Job *Bj_worker_pool<Job>::reserve()
+{
+    for (int i = 0; i < worker_count; i++) {
+        int index = (next_queue + i) % worker_count;
+        Queue& queue = queues[index];
+        uint32_t tail = queue.tail.load(std::memory_order_relaxed);
+        if (tail - queue.head.load(std::memory_order_acquire) < queue_size) {
+            reserved_queue = index;
+            next_queue = (index + 1) % worker_count;
+            return &queue.jobs[tail & (queue_size - 1)];
+        }
+    }
+    return nullptr;
+}
+
+template <class Job>
+void Bj_worker_pool<Job>::commit()
+{
+    Queue& queue = queues[reserved_queue];
+    reserved_queue = -1;
+
+    // sequentially consistent, so that either the worker sees the job or we see it sleeping
+    queue.tail.store(queue.tail.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+    if (queue.sleeping.load(std::memory_order_seq_cst))
+        wake_up(queue);
+}
+
+template <class Job>
+void Bj_worker_pool<Job>::drain()
+{
+    for (int i = 0; i < worker_count; i++) {
+        Queue& queue = queues[i];
+        while (queue.head.load(std::memory_order_acquire) != queue.tail.load(std::memory_order_relaxed))
+            std::this_thread::yield();
+    }
+}
+
+template <class Job>
+void Bj_worker_pool<Job>::wake_up(Queue& queue)
+{
+    queue.signal.fetch_add(1, std::memory_order_seq_cst);
+    queue.signal.notify_one();
+}
+
+template <class Job>
+void Bj_worker_pool<Job>::run(int worker_index)
+{
+    Queue& queue = queues[worker_index];
+    int idle_count = 0;
+
+    for (;;) {
+        uint32_t head = queue.head.load(std::memory_order_relaxed);
+        if (head != queue.tail.load(std::memory_order_acquire)) {
+            handler(worker_index, queue.jobs[head & (queue_size - 1)]);
+            queue.head.store(head + 1, std::memory_order_release);
+            idle_count = 0;
+            continue;
+        }
+
+        if (stopping.load(std::memory_order_relaxed))
+            return;
+
+        if (idle_count < spin_count) {
+            idle_count++;
+            continue;
+        }
+
+        uint32_t signal = queue.signal.load(std::memory_order_seq_cst);
+        queue.sleeping.store(true, std::memory_order_seq_cst);
+        if (head == queue.tail.load(std::memory_order_seq_cst) && !stopping.load(std::memory_order_seq_cst))
+            queue.signal.wait(signal, std::memory_order_seq_cst);
+        queue.sleeping.store(false, std::memory_order_relaxed);
+        idle_count = 0;
+    }
+}
@@ -0,0 +1,246 @@
+//
+//  bj_net_executor_linux.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "bj_net_executor_linux.h"
+
+static const int max_event_count = 64;
+
+// epoll user data of the eventfd, watch ids start at 1
+static const uint64_t wakeup_id = 0;
+
+struct Bj_net_executor_linux::State {
+    int epoll_fd = -1;
+    int event_fd = -1;
+
+    std::mutex mutex;
+    std::deque<std::function<void()>> queue;
+    std::map<int, std::pair<int, std::shared_ptr<std::function<void()>>>> watches; // id -> fd, handler
+    int watch_id_generator = 0;
+    bool stopping = false;
+
+    ~State() {
+        if (event_fd >= 0)
+            ::close(event_fd);
+        if (epoll_fd >= 0)
+            ::close(epoll_fd);
+    }
+
+    void wake_up() {
+        uint64_t one = 1;
+        ssize_t rv = write(event_fd, &one, sizeof(one));
+        (void)rv; // the counter cannot overflow in practice, and a pending wakeup is enough
+    }
+};
+
+/*
+ * The thread keeps its own reference to the state, so that the last copy of
+ * the executor can be released by a handler running on the executor itself.
+ */
+struct Bj_net_executor_linux::Loop {
+    std::shared_ptr<State> state;
+    std::thread thread;
+
+    ~Loop() {
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->stopping = true;
+        }
+        state->wake_up();
+        if (std::this_thread::get_id() == thread.get_id())
+            thread.detach();
+        else
+            thread.join();
+    }
+};
+
+Bj_net_executor_linux::Bj_net_executor_linux()
+{
+    auto state = std::make_shared<State>();
+
+    state->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (state->epoll_fd < 0)
+        throw std::runtime_error("cannot create epoll instance, errno=" + std::to_string(errno));
+
+    state->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (state->event_fd < 0)
+        throw std::runtime_error("cannot create eventfd, errno=" + std::to_string(errno));
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = wakeup_id;
+    if (epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, state->event_fd, &event) != 0)
+        throw std::runtime_error("cannot watch eventfd, errno=" + std::to_string(errno));
+
+    loop = std::make_shared<Loop>();
+    loop->state = state;
+    loop->thread = std::thread(&Bj_net_executor_linux::run, state);
+}
+
+void Bj_net_executor_linux::invoke_async(std::function<void()> handler) const
+{
+    auto& state = loop->state;
+    bool was_empty;
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        was_empty = state->queue.empty();
+        state->queue.push_back(std::move(handler));
+    }
+    // a non empty queue means a wakeup is already pending
+    if (was_empty)
+        state->wake_up();
+}
+
+void Bj_net_executor_linux::invoke_sync(std::function<void()> handler) const
+{
+    if (is_current()) {
+        handler();
+        return;
+    }
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    std::exception_ptr exception;
+
+    invoke_async([&]() {
+        try {
+            handler();
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done = true;
+        done_cv.notify_one();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        while (!done) {
+            done_cv.wait(lock);
+        }
+    }
+
+    // exceptions are forwarded to the caller
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+bool Bj_net_executor_linux::is_current() const
+{
+    return std::this_thread::get_id() == loop->thread.get_id();
+}
+
+int Bj_net_executor_linux::watch(int fd, std::function<void()> handler) const
+{
+    auto& state = loop->state;
+    int watch_id;
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        watch_id = ++state->watch_id_generator;
+        state->watches[watch_id] = { fd, std::make_shared<std::function<void()>>(std::move(handler)) };
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = (uint64_t)watch_id;
+    if (epoll_ctl(state->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        int error = errno;
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->watches.erase(watch_id);
+        throw std::runtime_error("cannot watch file descriptor, errno=" + std::to_string(error));
+    }
+
+    return watch_id;
+}
+
+void Bj_net_executor_linux::unwatch(int watch_id) const
+{
+    auto& state = loop->state;
+    std::unique_lock<std::mutex> lock(state->mutex);
+    auto it = state->watches.find(watch_id);
+    if (it == state->watches.end())
+        return;
+    epoll_ctl(state->epoll_fd, EPOLL_CTL_DEL, it->second.first, nullptr);
+    state->watches.erase(it);
+}
+
+void Bj_net_executor_linux::run(std::shared_ptr<State> state)
+{
+    struct epoll_event events[max_event_count];
+    std::deque<std::function<void()>> handlers;
+
+    for (;;) {
+        int count = epoll_wait(state->epoll_fd, events, max_event_count, -1);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("epoll_wait failed, errno=" + std::to_string(errno));
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.u64 == wakeup_id) {
+                uint64_t value;
+                ssize_t rv = read(state->event_fd, &value, sizeof(value));
+                (void)rv;
+
+                // handlers queued while these ones run are taken by the next wakeup
+                {
+                    std::unique_lock<std::mutex> lock(state->mutex);
+                    handlers.swap(state->queue);
+                }
+                for (auto& handler : handlers)
+                    handler();
+                handlers.clear();
+            } else {
+                // the watch may have been removed by a previous handler of this batch
+                std::shared_ptr<std::function<void()>> handler;
+                {
+                    std::unique_lock<std::mutex> lock(state->mutex);
+                    auto it = state->watches.find((int)events[i].data.u64);
+                    if (it != state->watches.end())
+                        handler = it->second.second;
+                }
+                if (handler)
+                    (*handler)();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if (state->stopping && state->queue.empty())
+            return;
+    }
+}
@@ -0,0 +1,72 @@
+//
+//  bj_net_executor_linux.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <functional>
+#include <memory>
+#include "bj_net.h"
+
+/**
+ * Executor running its handlers in order on a dedicated thread, around an
+ * epoll event loop.
+ *
+ * Besides the handlers queued with `invoke_async()`, which wake the loop up
+ * through an eventfd, the loop watches file descriptors and runs a handler
+ * when one of them becomes readable. Copies share the same thread, which
+ * stops once the last copy is destroyed and the queue is empty.
+ */
+class Bj_net_executor_linux : public Bj_net_executor {
+public:
+    Bj_net_executor_linux();
+    Bj_net_executor_linux(const Bj_net_executor_linux& executor) = default;
+    Bj_net_executor_linux& operator= (const Bj_net_executor_linux& executor) = default;
+    ~Bj_net_executor_linux() = default;
+
+    bool operator== (const Bj_net_executor_linux& executor) const {
+        return loop == executor.loop;
+    }
+
+    void invoke_async(std::function<void()> handler) const override;
+
+    // run the handler on the executor thread and wait for its completion
+    void invoke_sync(std::function<void()> handler) const;
+
+    bool is_current() const;
+
+    // invoke `handler` on the executor while `fd` is readable (level triggered)
+    int watch(int fd, std::function<void()> handler) const;
+
+    // no handler is invoked for this watch once this returns on the executor thread
+    void unwatch(int watch_id) const;
+
+private:
+    struct State;
+    struct Loop;
+
+    std::shared_ptr<Loop> loop;
+
+    static void run(std::shared_ptr<State> state);
+};
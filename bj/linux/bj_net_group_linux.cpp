@@ -0,0 +1,471 @@
+//
+//  bj_net_group_linux.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <cassert>
+#include <iostream>
+#include "bj_net_group_linux.h"
+#include "u2_probe.h"
+
+Bj_net_group_linux::Bj_net_group_linux() : link_monitor(exec)
+{
+    link_monitor.set_update_handler([this](const Bj_net_link_map& links) {
+        update(links);
+    });
+}
+
+Bj_net_group_linux::~Bj_net_group_linux()
+{
+    assert(!opened);
+}
+
+const Bj_net_executor& Bj_net_group_linux::executor() const
+{
+    return exec;
+}
+
+void Bj_net_group_linux::set_rx_begin_handler(Bj_net_rx_begin_handler rx_begin_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_begin_handler = rx_begin_handler;
+}
+
+void Bj_net_group_linux::set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_data_handler = rx_data_handler;
+}
+
+void Bj_net_group_linux::set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_end_handler = rx_end_handler;
+}
+
+void Bj_net_group_linux::set_rx_update_handler(Bj_net_rx_update_handler rx_update_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_update_handler = rx_update_handler;
+}
+
+void Bj_net_group_linux::set_shared_socket(bool enabled)
+{
+    if (opened)
+        throw std::logic_error("the socket mode must be set before opening");
+
+    shared_socket = enabled;
+}
+
+void Bj_net_group_linux::set_query_filter(bool enabled)
+{
+    if (opened)
+        throw std::logic_error("the query filter must be set before opening");
+
+    query_filter = enabled;
+}
+
+void Bj_net_group_linux::set_ipv6(bool enabled)
+{
+    if (opened)
+        throw std::logic_error("ipv6 must be enabled before opening");
+
+    ipv6 = enabled;
+}
+
+void Bj_net_group_linux::set_unicast(bool enabled)
+{
+    if (opened)
+        throw std::logic_error("the unicast listener must be enabled before opening");
+
+    unicast = enabled;
+}
+
+void Bj_net_group_linux::set_log_level(int log_level)
+{
+    this->log_level = log_level;
+}
+
+void Bj_net_group_linux::open()
+{
+    if (opened)
+        throw std::logic_error("already open");
+
+    // the link monitor must run on the executor, like everything else
+    if (!exec.is_current()) {
+        exec.invoke_sync([this]() {
+            open();
+        });
+        return;
+    }
+
+    if (shared_socket) {
+        shared = std::make_unique<Bj_net_shared_socket_linux>(exec);
+        shared->open([this](int index, std::span<unsigned char> data, const Bj_net_source& source) {
+            handle_shared_rx_data(index, data, source);
+        }, query_filter);
+    }
+
+    link_monitor.start();
+    opened = true;
+    update(link_monitor.get_links());
+}
+
+void Bj_net_group_linux::close(std::function<void()> completion)
+{
+    if (!opened)
+        throw std::logic_error("not open");
+
+    if (close_completion)
+        throw std::logic_error("already closing");
+
+    close_completion = completion;
+
+    exec.invoke_async([this]() {
+        cancel();
+    });
+}
+
+void Bj_net_group_linux::send(std::span<unsigned char> data)
+{
+    for (auto& [index, endpoint] : endpoints) {
+        if (endpoint.net) {
+            endpoint.net->send(data);
+            if (endpoint.net6)
+                endpoint.net6->send(data);
+        } else {
+            U2_PROBE3(bj, send, endpoint.interface_id, data.data(), data.size());
+            shared->send(index, data);
+        }
+    }
+}
+
+void Bj_net_group_linux::send_on_interface(int interface_id, std::span<unsigned char> data)
+{
+    for (auto& [index, endpoint] : endpoints) {
+        if (endpoint.interface_id != interface_id)
+            continue;
+        if (endpoint.net) {
+            endpoint.net->send(data);
+            if (endpoint.net6)
+                endpoint.net6->send(data);
+        } else {
+            U2_PROBE3(bj, send, endpoint.interface_id, data.data(), data.size());
+            shared->send(index, data);
+        }
+    }
+}
+
+bool Bj_net_group_linux::is_reply_thread_safe() const
+{
+    return true;
+}
+
+std::map<int, Bj_net_rx_stats> Bj_net_group_linux::get_rx_stats()
+{
+    std::map<int, Bj_net_rx_stats> stats;
+    exec.invoke_sync([&]() {
+        for (auto& [index, endpoint] : endpoints) {
+            if (endpoint.net) {
+                for (auto& net : endpoint.get_nets()) {
+                    auto net_stats = net->get_rx_stats(); // runs inline, we are on the executor
+                    if (net_stats.contains(0)) {
+                        stats[endpoint.interface_id].drop_count += net_stats[0].drop_count;
+                        stats[endpoint.interface_id].filtered |= net_stats[0].filtered;
+                        stats[endpoint.interface_id].delay.merge(net_stats[0].delay);
+                    }
+                }
+            } else if (auto shared_stats = shared->get_rx_stats(index)) {
+                stats[endpoint.interface_id] = *shared_stats;
+                stats[endpoint.interface_id].filtered = query_filter;
+            }
+        }
+    });
+    return stats;
+}
+
+void Bj_net_group_linux::update(const Bj_net_link_map& links)
+{
+    if (log_level >= 1) {
+        std::cout << "links:\n";
+        for (auto& [index, link] : links) {
+            std::cout << "  interface: index=" << index << " name=" << link.name << " flags=0x" << std::hex << link.flags << std::dec
+                      << " mtu=" << link.mtu << (link.is_usable() ? "" : " (unused)") << "\n";
+            for (auto& address : link.addresses) {
+                std::cout << "   " << address.as_str() << "\n";
+            }
+        }
+    }
+
+    // close the endpoints of the interfaces that disappeared or changed, update the ones whose addresses only changed
+
+    for (auto it = endpoints.begin(); it != endpoints.end();) {
+        int index = it->first;
+        auto link = links.find(index);
+        ++it;
+        if (link == links.end() || !link->second.is_usable() || !endpoints.at(index).link.is_equivalent(link->second))
+            close_endpoint(index);
+        else if (!endpoints.at(index).link.has_same_addresses(link->second) && !update_endpoint(link->second))
+            close_endpoint(index);
+    }
+
+    // open the new ones
+
+    for (auto& [index, link] : links) {
+        if (link.is_usable() && !endpoints.contains(index))
+            open_endpoint(link);
+    }
+}
+
+void Bj_net_group_linux::open_endpoint(const Bj_net_link& link)
+{
+    if (shared_socket) {
+        open_shared_endpoint(link);
+        return;
+    }
+
+    int interface_id = ++interface_id_generator;
+
+    // we only subscribe one address per protocol to the multicast group
+    auto net = open_net(link, link.get_ipv4_address(), interface_id);
+    if (!net)
+        return;
+
+    // without ipv6, the interface is still served over ipv4
+    Bj_net_address address6 = link.get_ipv6_address();
+    std::shared_ptr<Bj_net_single_linux> net6;
+    if (ipv6 && address6.protocol == Bj_net_protocol::ipv6)
+        net6 = open_net(link, address6, interface_id);
+
+    // without unicast listener, direct queries are left to the other responders of the host
+    std::shared_ptr<Bj_net_single_linux> unicast_net, unicast_net6;
+    if (unicast)
+        unicast_net = open_net(link, link.get_ipv4_address(), interface_id, false);
+    if (unicast && net6)
+        unicast_net6 = open_net(link, address6, interface_id, false);
+
+    endpoints[link.index] = { link, interface_id, net, net6, unicast_net, unicast_net6, nullptr };
+
+    // sized for the bigger ipv6 header, ipv6 addresses may show up later
+    Bj_net_mtu mtu = Bj_net_mtu::udp(ipv6 ? Bj_net_protocol::ipv6 : Bj_net_protocol::ipv4, link.mtu);
+
+    if (rx_begin_handler)
+        rx_begin_handler(interface_id, link.addresses, mtu);
+}
+
+// the rx begin, end and update handlers of the interface are called by the group, for all its sub-nets at once
+std::shared_ptr<Bj_net_single_linux> Bj_net_group_linux::open_net(const Bj_net_link& link, const Bj_net_address& address, int interface_id, bool multicast)
+{
+    auto net = std::make_shared<Bj_net_single_linux>(address, link.addresses, multicast, exec);
+    net->set_log_level(log_level);
+    net->set_mtu(link.mtu);
+    net->set_query_filter(query_filter);
+    net->set_rx_data_handler([this, interface_id](int sublayer_interface_id, std::span<unsigned char> data, const Bj_net_source& source, const Bj_net_reply& reply) {
+        if (this->rx_data_handler)
+            this->rx_data_handler(interface_id, data, source, reply);
+    });
+
+    try {
+        net->open();
+    } catch (Bj_net_open_error& error) {
+        // error while opening - this interface cannot be used
+        std::cout << link.name << " " << address.as_str() << (multicast ? "" : " unicast") << " cannot be used (" << error.what() << ")\n";
+        return nullptr;
+    }
+
+    return net;
+}
+
+void Bj_net_group_linux::open_shared_endpoint(const Bj_net_link& link)
+{
+    try {
+        shared->join(link.index);
+    } catch (Bj_net_open_error& error) {
+        std::cout << link.name << " cannot be used (" << error.what() << ")\n";
+        return;
+    }
+
+    int interface_id = ++interface_id_generator;
+    int index = link.index;
+    Bj_net_reply reply = [this, index, interface_id](std::span<unsigned char> data, const Bj_net_source& destination) {
+        U2_PROBE3(bj, reply, interface_id, data.data(), data.size());
+        shared->send(index, data, destination);
+    };
+    endpoints[index] = { link, interface_id, nullptr, nullptr, nullptr, nullptr, reply };
+
+    // the shared socket is ipv4 only
+    Bj_net_mtu mtu = Bj_net_mtu::udp(Bj_net_protocol::ipv4, link.mtu);
+
+    if (rx_begin_handler)
+        rx_begin_handler(interface_id, link.addresses, mtu);
+}
+
+// `completion` is called after the rx end handler
+void Bj_net_group_linux::close_endpoint(int index, std::function<void()> completion)
+{
+    Net_endpoint& endpoint = endpoints.at(index);
+    int interface_id = endpoint.interface_id;
+    if (endpoint.net) {
+        /*
+         * Closing sub-nets deliver nothing more, but only close their sockets
+         * asynchronously: the rx end handler runs first, the replies of the
+         * interface may be in use on other threads until it returns.
+         */
+        auto nets = endpoint.get_nets();
+        auto pending = std::make_shared<size_t>(nets.size());
+        for (auto net : nets) {
+            net->close([net, pending, completion]() mutable {
+                net.reset();
+                if (--*pending == 0 && completion)
+                    completion();
+            });
+        }
+        if (rx_end_handler)
+            rx_end_handler(interface_id);
+    } else {
+        if (rx_end_handler)
+            rx_end_handler(interface_id);
+        shared->leave(index);
+        if (completion)
+            completion();
+    }
+    endpoints.erase(index);
+}
+
+// false if the endpoint must be reopened instead
+bool Bj_net_group_linux::update_endpoint(const Bj_net_link& link)
+{
+    if (!rx_update_handler)
+        return false;
+
+    // the shared sockets select the interface by index, and the source address per datagram
+    Net_endpoint& endpoint = endpoints.at(link.index);
+    if (endpoint.net) {
+        Bj_net_address address6 = link.get_ipv6_address();
+        try {
+            endpoint.net->update_addresses(link.get_ipv4_address(), link.addresses);
+            if (endpoint.unicast_net)
+                endpoint.unicast_net->update_addresses(link.get_ipv4_address(), link.addresses);
+            if (address6.protocol == Bj_net_protocol::ipv6) {
+                if (endpoint.net6)
+                    endpoint.net6->update_addresses(address6, link.addresses);
+                if (endpoint.unicast_net6)
+                    endpoint.unicast_net6->update_addresses(address6, link.addresses);
+            }
+        } catch (Bj_net_open_error& error) {
+            std::cout << link.name << " cannot be updated (" << error.what() << ")\n";
+            return false;
+        }
+
+        /*
+         * The ipv6 sub-nets follow the ipv6 addresses of the interface. Closed
+         * sub-nets deliver nothing more, and close their sockets asynchronously,
+         * after the rx update handler below: its users drop their copies of the
+         * replies there, like in the rx end handler.
+         */
+        if (endpoint.net6 && address6.protocol != Bj_net_protocol::ipv6) {
+            for (auto net : { endpoint.net6, endpoint.unicast_net6 }) {
+                if (!net)
+                    continue;
+                net->close([net]() mutable {
+                    net.reset();
+                });
+            }
+            endpoint.net6 = nullptr;
+            endpoint.unicast_net6 = nullptr;
+        } else if (!endpoint.net6 && ipv6 && address6.protocol == Bj_net_protocol::ipv6) {
+            endpoint.net6 = open_net(link, address6, endpoint.interface_id);
+            if (unicast && endpoint.net6)
+                endpoint.unicast_net6 = open_net(link, address6, endpoint.interface_id, false);
+        }
+    }
+    endpoint.link = link;
+
+    rx_update_handler(endpoint.interface_id, link.addresses);
+    return true;
+}
+
+std::vector<std::shared_ptr<Bj_net_single_linux>> Bj_net_group_linux::Net_endpoint::get_nets() const
+{
+    std::vector<std::shared_ptr<Bj_net_single_linux>> nets;
+    for (auto& sub_net : { net, net6, unicast_net, unicast_net6 }) {
+        if (sub_net)
+            nets.push_back(sub_net);
+    }
+    return nets;
+}
+
+void Bj_net_group_linux::handle_shared_rx_data(int index, std::span<unsigned char> data, const Bj_net_source& source)
+{
+    // datagrams still queued for an interface that was left are ignored
+    auto it = endpoints.find(index);
+    if (it == endpoints.end())
+        return;
+
+    U2_PROBE3(bj, rx, it->second.interface_id, data.data(), data.size());
+    if (rx_data_handler)
+        rx_data_handler(it->second.interface_id, data, source, it->second.reply);
+}
+
+void Bj_net_group_linux::cancel()
+{
+    link_monitor.stop();
+
+    auto finish = [this]() {
+        endpoints.clear();
+        opened = false;
+        auto f = close_completion;
+        close_completion = nullptr;
+        f();
+    };
+
+    if (shared) {
+        while (!endpoints.empty())
+            close_endpoint(endpoints.begin()->first);
+        shared->close();
+        shared.reset();
+    }
+
+    if (endpoints.empty()) {
+        finish();
+        return;
+    }
+
+    close_step_count = endpoints.size();
+    while (!endpoints.empty()) {
+        close_endpoint(endpoints.begin()->first, [this, finish]() {
+            close_step_count--;
+            if (close_step_count == 0)
+                finish();
+        });
+    }
+}
@@ -0,0 +1,132 @@
+//
+//  bj_net_group_linux.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <map>
+#include <memory>
+#include "bj_net.h"
+#include "bj_net_link_monitor_linux.h"
+#include "bj_net_shared_socket_linux.h"
+#include "bj_net_single_linux.h"
+
+/**
+ * Bj_net over all the multicast capable interfaces of the host, each one
+ * served by a Bj_net_single_linux sharing the same executor. Interfaces and
+ * addresses are tracked with rtnetlink: when an interface changes, its
+ * endpoint is closed and a new one is opened with a new interface id, the
+ * others are left untouched. When only its addresses change, and an rx
+ * update handler is set, the endpoint and its sockets are kept instead.
+ *
+ * Unless disabled, each interface having an IPv6 address is also served on
+ * the IPv6 group by a second Bj_net_single_linux. Both belong to the same
+ * interface id, so that the two address families share one database and
+ * replies go back on the family of the query. An interface is only served
+ * if it has an IPv4 address.
+ *
+ * Unless disabled, each interface also has a unicast listener per address
+ * family, a Bj_net_single_linux without multicast receiving the queries sent
+ * directly to the address used for the group, as clients do to refresh
+ * records. Its data is delivered under the interface id too, so that these
+ * queries are answered from the same database, by unicast.
+ *
+ * In shared socket mode, the interfaces are not served by their own
+ * Bj_net_single_linux but all by a single Bj_net_shared_socket_linux, so that
+ * hundreds of interfaces do not cost hundreds of sockets and wakeup sources.
+ * The handlers are called the same way in both modes, but the shared socket
+ * is IPv4 only and has no unicast listener.
+ */
+class Bj_net_group_linux : public Bj_net {
+public:
+    Bj_net_group_linux();
+    ~Bj_net_group_linux();
+
+    // must be called before opening
+    void set_shared_socket(bool enabled);
+
+    // must be called before opening; enabled by default, see bj_net_linux::attach_query_filter()
+    void set_query_filter(bool enabled);
+
+    // must be called before opening; enabled by default, ignored in shared socket mode
+    void set_ipv6(bool enabled);
+
+    // must be called before opening; enabled by default, ignored in shared socket mode
+    void set_unicast(bool enabled);
+
+    const Bj_net_executor& executor() const override;
+    void set_rx_begin_handler(Bj_net_rx_begin_handler rx_begin_handler) override;
+    void set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler) override;
+    void set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler) override;
+    void set_rx_update_handler(Bj_net_rx_update_handler rx_update_handler) override;
+    void set_log_level(int log_level) override;
+    void open() override;
+    void close(std::function<void()> completion) override;
+    void send(std::span<unsigned char> data) override;
+    void send_on_interface(int interface_id, std::span<unsigned char> data) override;
+    bool is_reply_thread_safe() const override;
+    std::map<int, Bj_net_rx_stats> get_rx_stats() override;
+
+private:
+    struct Net_endpoint {
+        Bj_net_link link;
+        int interface_id;
+        std::shared_ptr<Bj_net_single_linux> net; // null in shared socket mode
+        std::shared_ptr<Bj_net_single_linux> net6; // null without ipv6
+        std::shared_ptr<Bj_net_single_linux> unicast_net; // null without unicast listener
+        std::shared_ptr<Bj_net_single_linux> unicast_net6; // null without ipv6 or unicast listener
+        Bj_net_reply reply;                       // shared socket mode only
+
+        std::vector<std::shared_ptr<Bj_net_single_linux>> get_nets() const;
+    };
+
+    int log_level = 0;
+    bool opened = false;
+    bool shared_socket = false;
+    bool query_filter = true;
+    bool ipv6 = true;
+    bool unicast = true;
+    std::unique_ptr<Bj_net_shared_socket_linux> shared;
+    Bj_net_executor_linux exec;
+    Bj_net_link_monitor_linux link_monitor;
+    int interface_id_generator = 0;
+
+    Bj_net_rx_begin_handler rx_begin_handler;
+    Bj_net_rx_data_handler rx_data_handler;
+    Bj_net_rx_end_handler rx_end_handler;
+    Bj_net_rx_update_handler rx_update_handler;
+
+    std::map<int, Net_endpoint> endpoints; // key = interface index
+    std::function<void()> close_completion;
+    size_t close_step_count = 0;
+
+    void update(const Bj_net_link_map& links);
+    void open_endpoint(const Bj_net_link& link);
+    void open_shared_endpoint(const Bj_net_link& link);
+    std::shared_ptr<Bj_net_single_linux> open_net(const Bj_net_link& link, const Bj_net_address& address, int interface_id, bool multicast = true);
+    void close_endpoint(int index, std::function<void()> completion = nullptr);
+    bool update_endpoint(const Bj_net_link& link);
+    void handle_shared_rx_data(int index, std::span<unsigned char> data, const Bj_net_source& source);
+    void cancel();
+};
@@ -0,0 +1,382 @@
+//
+//  bj_net_link_monitor_linux.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include "bj_net_link_monitor_linux.h"
+
+static const size_t netlink_buf_size = 32768;
+static const int dump_timeout_ms = 1000;
+static const int resync_retry_delay_ms = 1000;
+
+bool Bj_net_link::is_usable() const
+{
+    unsigned required_flags = IFF_UP | IFF_RUNNING | IFF_MULTICAST;
+    if ((flags & required_flags) != required_flags)
+        return false;
+    return get_ipv4_address().protocol == Bj_net_protocol::ipv4;
+}
+
+Bj_net_address Bj_net_link::get_ipv4_address() const
+{
+    for (auto& address : addresses) {
+        if (address.protocol == Bj_net_protocol::ipv4)
+            return address;
+    }
+    return Bj_net_address();
+}
+
+Bj_net_address Bj_net_link::get_ipv6_address() const
+{
+    for (auto& address : addresses) {
+        if (address.protocol == Bj_net_protocol::ipv6)
+            return address;
+    }
+    return Bj_net_address();
+}
+
+bool Bj_net_link::operator== (const Bj_net_link& link) const
+{
+    return index == link.index && name == link.name && flags == link.flags && mtu == link.mtu && has_same_addresses(link);
+}
+
+static bool is_same_interface_address(const Bj_net_address& a, const Bj_net_address& b)
+{
+    return a == b && a.prefix_length == b.prefix_length;
+}
+
+bool Bj_net_link::has_same_addresses(const Bj_net_link& link) const
+{
+    // a prefix change alone must be reported, the on-link checks depend on it
+    return std::equal(addresses.begin(), addresses.end(), link.addresses.begin(), link.addresses.end(), is_same_interface_address);
+}
+
+bool Bj_net_link::is_equivalent(const Bj_net_link& link) const
+{
+    return name == link.name && mtu == link.mtu;
+}
+
+Bj_net_link_monitor_linux::Bj_net_link_monitor_linux(const Bj_net_executor_linux& executor) : exec(executor)
+{
+    netlink_buf = std::make_unique<unsigned char[]>(netlink_buf_size);
+}
+
+Bj_net_link_monitor_linux::~Bj_net_link_monitor_linux()
+{
+    stop();
+}
+
+void Bj_net_link_monitor_linux::set_update_handler(std::function<void(const Bj_net_link_map& links)> update_handler)
+{
+    this->update_handler = update_handler;
+}
+
+void Bj_net_link_monitor_linux::set_debounce_delay_ms(int debounce_delay_ms)
+{
+    if (netlink_socket >= 0)
+        throw std::logic_error("the debounce delay must be set before starting");
+
+    this->debounce_delay_ms = debounce_delay_ms;
+}
+
+void Bj_net_link_monitor_linux::start()
+{
+    if (netlink_socket >= 0)
+        throw std::logic_error("already started");
+
+    netlink_socket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (netlink_socket < 0)
+        throw Bj_net_open_error("cannot create netlink socket, errno=" + std::to_string(errno));
+
+    try {
+        // subscribe before dumping, so that no change can be missed in between
+        struct sockaddr_nl addr = {};
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+        if (bind(netlink_socket, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+            throw Bj_net_open_error("cannot bind netlink socket, errno=" + std::to_string(errno));
+
+        dump_all();
+        reported_links = links;
+
+        timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (timer < 0)
+            throw Bj_net_open_error("cannot create timer, errno=" + std::to_string(errno));
+        timer_armed = false;
+        timer_watch = exec.watch(timer, [this]() {
+            uint64_t expirations;
+            if (read(timer, &expirations, sizeof(expirations)) < 0)
+                return;
+            timer_armed = false;
+            if (sync())
+                report();
+        });
+
+        netlink_watch = exec.watch(netlink_socket, [this]() {
+            handle_rx_data();
+        });
+    } catch (...) {
+        if (timer_watch)
+            exec.unwatch(timer_watch);
+        timer_watch = 0;
+        if (timer >= 0)
+            ::close(timer);
+        timer = -1;
+        ::close(netlink_socket);
+        netlink_socket = -1;
+        throw;
+    }
+}
+
+void Bj_net_link_monitor_linux::stop()
+{
+    if (netlink_socket < 0)
+        return;
+
+    exec.unwatch(netlink_watch);
+    netlink_watch = 0;
+    exec.unwatch(timer_watch);
+    timer_watch = 0;
+    ::close(netlink_socket);
+    netlink_socket = -1;
+    ::close(timer);
+    timer = -1;
+}
+
+void Bj_net_link_monitor_linux::dump_all()
+{
+    links.clear();
+    dump(RTM_GETLINK);
+    dump(RTM_GETADDR);
+}
+
+void Bj_net_link_monitor_linux::dump(int type)
+{
+    struct {
+        struct nlmsghdr header;
+        struct rtgenmsg message;
+    } request = {};
+
+    request.header.nlmsg_len = NLMSG_LENGTH(sizeof(request.message));
+    request.header.nlmsg_type = type;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = ++sequence;
+    request.message.rtgen_family = AF_UNSPEC;
+
+    struct sockaddr_nl kernel = {};
+    kernel.nl_family = AF_NETLINK;
+    if (sendto(netlink_socket, &request, request.header.nlmsg_len, 0, (struct sockaddr *)&kernel, sizeof(kernel)) < 0)
+        throw Bj_net_open_error("cannot send netlink dump request, errno=" + std::to_string(errno));
+
+    while (!receive(request.header.nlmsg_seq)) {
+    }
+}
+
+/*
+ * Read one datagram and apply all the messages it contains, notifications
+ * and dump parts alike. Return true when the end of the given dump is found
+ * or, out of a dump (sequence 0), when nothing is left to read.
+ */
+bool Bj_net_link_monitor_linux::receive(uint32_t dump_sequence)
+{
+    ssize_t size = recv(netlink_socket, netlink_buf.get(), netlink_buf_size, 0);
+    if (size < 0) {
+        if (errno == EINTR)
+            return false;
+        if (errno == ENOBUFS) {
+            // notifications were lost, the link map must be dumped again
+            resync_needed = true;
+            return false;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            throw Bj_net_open_error("cannot read netlink socket, errno=" + std::to_string(errno));
+        if (dump_sequence == 0)
+            return true;
+        struct pollfd pfd = { .fd = netlink_socket, .events = POLLIN, .revents = 0 };
+        if (poll(&pfd, 1, dump_timeout_ms) <= 0)
+            throw Bj_net_open_error("no netlink dump reply");
+        return false;
+    }
+
+    bool done = false;
+    for (auto header = (const struct nlmsghdr *)netlink_buf.get(); NLMSG_OK(header, size); header = NLMSG_NEXT(header, size)) {
+        if (header->nlmsg_type == NLMSG_DONE || header->nlmsg_type == NLMSG_ERROR) {
+            if (dump_sequence != 0 && header->nlmsg_seq == dump_sequence)
+                done = true;
+            continue;
+        }
+        handle_message(header);
+    }
+    return done;
+}
+
+void Bj_net_link_monitor_linux::handle_message(const struct nlmsghdr *header)
+{
+    switch (header->nlmsg_type) {
+        case RTM_NEWLINK:
+        case RTM_DELLINK: {
+            auto info = (const struct ifinfomsg *)NLMSG_DATA(header);
+            if (header->nlmsg_type == RTM_DELLINK) {
+                links.erase(info->ifi_index);
+                break;
+            }
+
+            Bj_net_link& link = links[info->ifi_index];
+            link.index = info->ifi_index;
+            link.flags = info->ifi_flags;
+            int length = (int)IFLA_PAYLOAD(header);
+            for (auto attr = IFLA_RTA(info); RTA_OK(attr, length); attr = RTA_NEXT(attr, length)) {
+                switch (attr->rta_type) {
+                    case IFLA_IFNAME:
+                        link.name = std::string((const char *)RTA_DATA(attr), strnlen((const char *)RTA_DATA(attr), RTA_PAYLOAD(attr)));
+                        break;
+                    case IFLA_MTU:
+                        if (RTA_PAYLOAD(attr) >= sizeof(uint32_t))
+                            link.mtu = *(const uint32_t *)RTA_DATA(attr);
+                        break;
+                }
+            }
+            break;
+        }
+        case RTM_NEWADDR:
+        case RTM_DELADDR: {
+            auto info = (const struct ifaddrmsg *)NLMSG_DATA(header);
+            Bj_net_address address;
+            uint32_t flags = info->ifa_flags;
+            int length = (int)IFA_PAYLOAD(header);
+            for (auto attr = IFA_RTA(info); RTA_OK(attr, length); attr = RTA_NEXT(attr, length)) {
+                // ifa_flags only has the lower 8 bits
+                if (attr->rta_type == IFA_FLAGS && RTA_PAYLOAD(attr) >= sizeof(uint32_t))
+                    flags = *(const uint32_t *)RTA_DATA(attr);
+                // on point-to-point links, IFA_ADDRESS is the peer and IFA_LOCAL the local address
+                if (attr->rta_type != IFA_LOCAL && !(attr->rta_type == IFA_ADDRESS && address.protocol == Bj_net_protocol::undefined))
+                    continue;
+                if (info->ifa_family == AF_INET && RTA_PAYLOAD(attr) == 4) {
+                    address.protocol = Bj_net_protocol::ipv4;
+                    memcpy(address.ipv4.data(), RTA_DATA(attr), 4);
+                } else if (info->ifa_family == AF_INET6 && RTA_PAYLOAD(attr) == 16) {
+                    address.protocol = Bj_net_protocol::ipv6;
+                    memcpy(address.ipv6.data(), RTA_DATA(attr), 16);
+                }
+            }
+            if (address.protocol == Bj_net_protocol::undefined)
+                break;
+            address.prefix_length = info->ifa_prefixlen;
+
+            auto it = links.find((int)info->ifa_index);
+            if (it == links.end())
+                break;
+            auto& addresses = it->second.addresses;
+            // the same address may be added with several prefixes, changing the prefix deletes and adds it
+            auto pos = std::find_if(addresses.begin(), addresses.end(), [&address](const Bj_net_address& other) {
+                return is_same_interface_address(other, address);
+            });
+            /*
+             * An IPv6 address cannot be bound while duplicate address detection
+             * runs, unless it is optimistic, nor once it failed. It is reported
+             * again by an RTM_NEWADDR without these flags when DAD succeeds.
+             */
+            bool usable = !(flags & IFA_F_DADFAILED) && (!(flags & IFA_F_TENTATIVE) || (flags & IFA_F_OPTIMISTIC));
+            if (header->nlmsg_type == RTM_NEWADDR && usable && pos == addresses.end())
+                addresses.push_back(address);
+            if ((header->nlmsg_type == RTM_DELADDR || !usable) && pos != addresses.end())
+                addresses.erase(pos);
+            break;
+        }
+    }
+}
+
+/*
+ * Apply all the pending notifications and, if some were lost, dump the
+ * whole state again. On failure, the link map may be partial: it must not be
+ * reported, and the dump is retried by the timer or by the next notification.
+ */
+bool Bj_net_link_monitor_linux::sync()
+{
+    try {
+        while (!receive(0)) {
+        }
+        while (resync_needed) {
+            resync_needed = false;
+            dump_all();
+        }
+        return true;
+    } catch (Bj_net_open_error& error) {
+        std::cout << "link monitor out of sync (" << error.what() << "), dumping again\n";
+        resync_needed = true;
+        if (!timer_armed)
+            arm_timer(resync_retry_delay_ms);
+        return false;
+    }
+}
+
+bool Bj_net_link_monitor_linux::arm_timer(int delay_ms)
+{
+    struct itimerspec delay = {};
+    delay.it_value.tv_sec = delay_ms / 1000;
+    delay.it_value.tv_nsec = (long)(delay_ms % 1000) * 1000000;
+    timer_armed = timerfd_settime(timer, 0, &delay, nullptr) == 0;
+    return timer_armed;
+}
+
+void Bj_net_link_monitor_linux::handle_rx_data()
+{
+    // all pending notifications are applied before reporting
+    if (!sync())
+        return;
+
+    if (links == reported_links || timer_armed)
+        return;
+
+    if (debounce_delay_ms <= 0) {
+        report();
+        return;
+    }
+
+    // the delay runs from the first change, so that a steady flow of changes cannot postpone the report forever
+    if (!arm_timer(debounce_delay_ms))
+        report();
+}
+
+void Bj_net_link_monitor_linux::report()
+{
+    // changes undone within the delay are not reported
+    if (links == reported_links)
+        return;
+
+    reported_links = links;
+    if (update_handler)
+        update_handler(links);
+}
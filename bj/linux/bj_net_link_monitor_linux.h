@@ -0,0 +1,119 @@
+//
+//  bj_net_link_monitor_linux.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bj_net.h"
+#include "bj_net_executor_linux.h"
+
+struct Bj_net_link {
+    int index;
+    std::string name;
+    unsigned flags; // IFF_xxx
+    size_t mtu;
+    std::vector<Bj_net_address> addresses;
+
+    // unlike Bj_net_address::operator==, also compares the prefix lengths
+    bool operator== (const Bj_net_link& link) const;
+    bool has_same_addresses(const Bj_net_link& link) const;
+
+    // up, running, multicast capable and having an ipv4 address
+    bool is_usable() const;
+
+    // first ipv4 address, undefined if none
+    Bj_net_address get_ipv4_address() const;
+    Bj_net_address get_ipv6_address() const;
+
+    // true if the sockets of an endpoint opened for this link can still be used for `link`, whose addresses may differ
+    bool is_equivalent(const Bj_net_link& link) const;
+};
+
+using Bj_net_link_map = std::map<int, Bj_net_link>; // key = interface index
+
+/**
+ * Tracks the network interfaces and their addresses with rtnetlink, the
+ * Linux counterpart of nw_path_monitor.
+ *
+ * `start()` dumps the current state synchronously; afterwards, the update
+ * handler is invoked on the executor with the whole link map when it
+ * changed. Changes are debounced: the first one arms a timer, and the
+ * handler only sees the state reached when it expires, so that an interface
+ * flapping during a DHCP renewal or a Wi-Fi roam is not reported at all.
+ *
+ * When notifications are lost (ENOBUFS) or the socket fails once started,
+ * the whole state is dumped again, and nothing is reported until a dump
+ * succeeds; failed dumps are retried every second.
+ */
+class Bj_net_link_monitor_linux {
+public:
+    Bj_net_link_monitor_linux(const Bj_net_executor_linux& executor);
+    ~Bj_net_link_monitor_linux();
+
+    Bj_net_link_monitor_linux(const Bj_net_link_monitor_linux&) = delete;
+    Bj_net_link_monitor_linux& operator= (const Bj_net_link_monitor_linux&) = delete;
+
+    void set_update_handler(std::function<void(const Bj_net_link_map& links)> update_handler);
+
+    // must be called before starting; 0 reports every batch of kernel notifications right away
+    void set_debounce_delay_ms(int debounce_delay_ms);
+
+    // must be called on the executor, throws Bj_net_open_error
+    void start();
+    void stop();
+
+    // as last reported
+    const Bj_net_link_map& get_links() const {
+        return reported_links;
+    }
+
+private:
+    Bj_net_executor_linux exec;
+    int netlink_socket = -1;
+    int netlink_watch = 0;
+    int debounce_delay_ms = 250;
+    int timer = -1;
+    int timer_watch = 0;
+    bool timer_armed = false;
+    uint32_t sequence = 0;
+    bool resync_needed = false;
+    std::unique_ptr<unsigned char[]> netlink_buf;
+    Bj_net_link_map links;
+    Bj_net_link_map reported_links;
+    std::function<void(const Bj_net_link_map& links)> update_handler;
+
+    void dump_all();
+    void dump(int type);
+    bool receive(uint32_t dump_sequence);
+    void handle_message(const struct nlmsghdr *header);
+    bool sync();
+    bool arm_timer(int delay_ms);
+    void handle_rx_data();
+    void report();
+};
@@ -0,0 +1,266 @@
+//
+//  bj_net_shared_socket_linux.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <unistd.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include "bj_net_shared_socket_linux.h"
+#include "bj_net_socket_linux.h"
+#include "u2_mdns.h"
+
+static const size_t batch_slot_size = U2_MDNS_MSG_SIZE_MAX;
+static const size_t tx_control_size = CMSG_SPACE(sizeof(struct in_pktinfo));
+
+// the output interface is selected by the ifindex of the packet info, the source address is left to the kernel
+static void fill_tx_msghdr(struct msghdr& hdr, void *name, socklen_t name_size, struct iovec *iov, unsigned char *control, int interface_index)
+{
+    memset(control, 0, tx_control_size);
+    hdr = {};
+    hdr.msg_name = name;
+    hdr.msg_namelen = name_size;
+    hdr.msg_iov = iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = tx_control_size;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+    cmsg->cmsg_level = IPPROTO_IP;
+    cmsg->cmsg_type = IP_PKTINFO;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+    struct in_pktinfo *info = (struct in_pktinfo *)CMSG_DATA(cmsg);
+    info->ipi_ifindex = interface_index;
+}
+
+Bj_net_shared_socket_linux::Bj_net_shared_socket_linux(Bj_net_executor_linux executor) : exec(executor)
+{
+}
+
+Bj_net_shared_socket_linux::~Bj_net_shared_socket_linux()
+{
+    assert(rx_sockets.empty());
+}
+
+void Bj_net_shared_socket_linux::open(Rx_handler rx_handler, bool query_filter)
+{
+    if (!rx_sockets.empty())
+        throw std::logic_error("already open");
+
+    try {
+        multicast_group = bj_net_linux::multicast_group();
+        tx_socket = bj_net_linux::open_multicast_shared_tx_socket();
+        add_rx_socket(bj_net_linux::open_multicast_shared_rx_socket(query_filter));
+    } catch (Bj_net_open_error& exc) {
+        close_sockets();
+        throw;
+    }
+
+    this->rx_handler = rx_handler;
+    this->query_filter = query_filter;
+
+    if (!rx_msgs) {
+        rx_batch_buf = std::make_unique<unsigned char[]>(rx_batch_max * batch_slot_size);
+        tx_batch_buf = std::make_unique<unsigned char[]>(rx_batch_max * batch_slot_size);
+        rx_control_buf = std::make_unique<unsigned char[]>(rx_batch_max * bj_net_linux::rx_control_size);
+        tx_control_buf = std::make_unique<unsigned char[]>(rx_batch_max * tx_control_size);
+        rx_msgs = std::make_unique<struct mmsghdr[]>(rx_batch_max);
+        tx_msgs = std::make_unique<struct mmsghdr[]>(rx_batch_max);
+        rx_iovs = std::make_unique<struct iovec[]>(rx_batch_max);
+        tx_iovs = std::make_unique<struct iovec[]>(rx_batch_max);
+        rx_names = std::make_unique<struct sockaddr_storage[]>(rx_batch_max);
+        tx_names = std::make_unique<struct sockaddr_storage[]>(rx_batch_max);
+        for (int i = 0; i < rx_batch_max; i++)
+            rx_iovs[i] = { .iov_base = rx_batch_buf.get() + i * batch_slot_size, .iov_len = batch_slot_size };
+    }
+}
+
+void Bj_net_shared_socket_linux::close()
+{
+    if (rx_sockets.empty())
+        throw std::logic_error("not open");
+
+    close_sockets();
+    rx_handler = nullptr;
+}
+
+void Bj_net_shared_socket_linux::join(int interface_index)
+{
+    Rx_socket *rx = nullptr;
+    for (Rx_socket& candidate : rx_sockets) {
+        if (bj_net_linux::try_join_multicast_group(candidate.socket, interface_index)) {
+            rx = &candidate;
+            break;
+        }
+    }
+
+    // every rx socket has reached the membership limit
+    if (!rx) {
+        int socket = bj_net_linux::open_multicast_shared_rx_socket(query_filter);
+        try {
+            bj_net_linux::join_multicast_group(socket, interface_index);
+        } catch (Bj_net_open_error& exc) {
+            ::close(socket);
+            throw;
+        }
+        rx = &add_rx_socket(socket);
+    }
+
+    rx_socket_of[interface_index] = rx;
+    rx_instrumentation[interface_index] = {};
+}
+
+void Bj_net_shared_socket_linux::leave(int interface_index)
+{
+    auto it = rx_socket_of.find(interface_index);
+    if (it != rx_socket_of.end()) {
+        bj_net_linux::leave_multicast_group(it->second->socket, interface_index);
+        rx_socket_of.erase(it);
+    }
+    rx_instrumentation.erase(interface_index);
+}
+
+const Bj_net_rx_stats *Bj_net_shared_socket_linux::get_rx_stats(int interface_index) const
+{
+    auto it = rx_instrumentation.find(interface_index);
+    return it != rx_instrumentation.end() ? &it->second.get_stats() : nullptr;
+}
+
+void Bj_net_shared_socket_linux::send(int interface_index, std::span<unsigned char> data, const Bj_net_source& destination)
+{
+    if (data.size() > batch_slot_size)
+        return; // cannot be sent over mDNS anyway
+
+    // the batch belongs to the executor thread, others send right away
+    if (!exec.is_current()) {
+        struct iovec iov = { .iov_base = data.data(), .iov_len = data.size() };
+        alignas(struct cmsghdr) unsigned char control[tx_control_size];
+        struct sockaddr_storage addr;
+        struct msghdr hdr;
+        if (destination.is_defined())
+            fill_tx_msghdr(hdr, &addr, bj_net_linux::sockaddr_of(destination, interface_index, addr), &iov, control, interface_index);
+        else
+            fill_tx_msghdr(hdr, &multicast_group, sizeof(multicast_group), &iov, control, interface_index);
+        sendmsg(tx_socket, &hdr, 0);
+        return;
+    }
+
+    if (tx_count == rx_batch_max)
+        flush();
+
+    unsigned char *slot = tx_batch_buf.get() + tx_count * batch_slot_size;
+    memcpy(slot, data.data(), data.size());
+    tx_iovs[tx_count] = { .iov_base = slot, .iov_len = data.size() };
+    unsigned char *control = tx_control_buf.get() + tx_count * tx_control_size;
+    if (destination.is_defined()) {
+        socklen_t name_size = bj_net_linux::sockaddr_of(destination, interface_index, tx_names[tx_count]);
+        fill_tx_msghdr(tx_msgs[tx_count].msg_hdr, &tx_names[tx_count], name_size, &tx_iovs[tx_count], control, interface_index);
+    } else {
+        fill_tx_msghdr(tx_msgs[tx_count].msg_hdr, &multicast_group, sizeof(multicast_group), &tx_iovs[tx_count], control, interface_index);
+    }
+    tx_count++;
+
+    // out of an rx batch, send right away
+    if (!in_rx_batch)
+        flush();
+}
+
+Bj_net_shared_socket_linux::Rx_socket& Bj_net_shared_socket_linux::add_rx_socket(int socket)
+{
+    Rx_socket& rx = rx_sockets.emplace_back();
+    rx.socket = socket;
+    rx.watch = exec.watch(socket, [this, &rx]() {
+        handle_rx_data(rx);
+    });
+    return rx;
+}
+
+void Bj_net_shared_socket_linux::close_sockets()
+{
+    if (tx_socket != -1)
+        ::close(tx_socket);
+    tx_socket = -1;
+    for (Rx_socket& rx : rx_sockets) {
+        exec.unwatch(rx.watch);
+        ::close(rx.socket);
+    }
+    rx_sockets.clear();
+    rx_socket_of.clear();
+}
+
+void Bj_net_shared_socket_linux::flush()
+{
+    // messages that cannot be sent are dropped, as with sendto()
+    int sent = 0;
+    while (sent < tx_count) {
+        int rv = sendmmsg(tx_socket, &tx_msgs[sent], tx_count - sent, 0);
+        if (rv < 0) {
+            if (errno == EINTR)
+                continue;
+            sent++; // skip the failing message
+        } else {
+            sent += rv;
+        }
+    }
+    tx_count = 0;
+}
+
+void Bj_net_shared_socket_linux::handle_rx_data(Rx_socket& rx)
+{
+    // recvmmsg() updates the lengths, they must be reset for every batch
+    for (int i = 0; i < rx_batch_max; i++) {
+        struct msghdr& hdr = rx_msgs[i].msg_hdr;
+        hdr = {};
+        hdr.msg_name = &rx_names[i];
+        hdr.msg_namelen = sizeof(rx_names[i]);
+        hdr.msg_iov = &rx_iovs[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = rx_control_buf.get() + i * bj_net_linux::rx_control_size;
+        hdr.msg_controllen = bj_net_linux::rx_control_size;
+    }
+
+    int count = recvmmsg(rx.socket, rx_msgs.get(), rx_batch_max, MSG_DONTWAIT, nullptr);
+    if (count <= 0)
+        return;
+
+    in_rx_batch = true;
+    for (int i = 0; i < count; i++) {
+        struct msghdr& hdr = rx_msgs[i].msg_hdr;
+        size_t size = rx_msgs[i].msg_len;
+        bj_net_linux::Rx_control control = bj_net_linux::parse_rx_control(hdr);
+        uint32_t drop_count = rx.drop_counter.update(control);
+        auto it = rx_instrumentation.find(control.interface_index);
+        if (it != rx_instrumentation.end())
+            it->second.update(control, drop_count);
+        if (size == 0 || (hdr.msg_flags & MSG_TRUNC) || control.interface_index == 0)
+            continue;
+
+        if (rx_handler)
+            rx_handler(control.interface_index, std::span((unsigned char *)rx_iovs[i].iov_base, size), bj_net_linux::source_of(rx_names[i]));
+    }
+    in_rx_batch = false;
+
+    if (tx_count > 0)
+        flush();
+}
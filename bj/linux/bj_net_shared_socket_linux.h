@@ -0,0 +1,116 @@
+//
+//  bj_net_shared_socket_linux.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <span>
+#include "bj_net_executor_linux.h"
+#include "bj_net_socket_linux.h"
+
+/**
+ * A single pair of sockets serving the IPv4 mDNS multicast group on any
+ * number of interfaces, identified by their index.
+ *
+ * The rx socket joins the group on each interface and the interface of every
+ * datagram is taken from its IP_PKTINFO control message; the tx socket
+ * selects the output interface of every datagram the same way. Datagrams are
+ * read by batches with recvmmsg(), and what is sent while handling a batch
+ * goes out with a single sendmmsg().
+ *
+ * Linux limits the memberships of a socket to net.ipv4.igmp_max_memberships
+ * (20 by default). Past it, join() opens another rx socket, watched by the
+ * same executor; each one only receives the datagrams of its own memberships.
+ * Rx sockets left without membership are kept for later joins until close().
+ *
+ * Since the queue of an rx socket is shared, the datagrams it dropped are
+ * counted once, on the interface of the next datagram it receives.
+ *
+ * Must be used on the executor it was created with.
+ */
+class Bj_net_shared_socket_linux {
+public:
+    typedef std::function<void(int interface_index, std::span<unsigned char> data, const Bj_net_source& source)> Rx_handler;
+
+    static constexpr int rx_batch_max = 64;
+
+    Bj_net_shared_socket_linux(Bj_net_executor_linux executor);
+    ~Bj_net_shared_socket_linux();
+
+    Bj_net_shared_socket_linux(const Bj_net_shared_socket_linux&) = delete;
+    Bj_net_shared_socket_linux& operator= (const Bj_net_shared_socket_linux&) = delete;
+
+    void open(Rx_handler rx_handler, bool query_filter);
+    void close();
+    void join(int interface_index);
+    void leave(int interface_index);
+    // to the group, or by unicast to `destination` if defined
+    void send(int interface_index, std::span<unsigned char> data, const Bj_net_source& destination = Bj_net_source());
+
+    // null if the interface was not joined
+    const Bj_net_rx_stats *get_rx_stats(int interface_index) const;
+
+private:
+    Bj_net_executor_linux exec;
+    Rx_handler rx_handler;
+
+    struct Rx_socket {
+        int socket = -1;
+        int watch = 0;
+        bj_net_linux::Rx_drop_counter drop_counter; // shared by the interfaces of the socket
+    };
+
+    struct sockaddr_in multicast_group;
+    bool query_filter = false;
+    std::list<Rx_socket> rx_sockets; // the first one opened by open(), the others by join()
+    std::map<int, Rx_socket *> rx_socket_of; // key = interface index
+    int tx_socket = -1;
+
+    bool in_rx_batch = false;
+    std::unique_ptr<unsigned char[]> rx_batch_buf; // rx_batch_max slots of U2_MDNS_MSG_SIZE_MAX
+    std::unique_ptr<unsigned char[]> tx_batch_buf; // rx_batch_max slots of U2_MDNS_MSG_SIZE_MAX
+    std::unique_ptr<unsigned char[]> rx_control_buf;
+    std::unique_ptr<unsigned char[]> tx_control_buf;
+    std::unique_ptr<struct mmsghdr[]> rx_msgs;
+    std::unique_ptr<struct mmsghdr[]> tx_msgs;
+    std::unique_ptr<struct iovec[]> rx_iovs;
+    std::unique_ptr<struct iovec[]> tx_iovs;
+    std::unique_ptr<struct sockaddr_storage[]> rx_names;
+    std::unique_ptr<struct sockaddr_storage[]> tx_names;
+    int tx_count = 0;
+
+    std::map<int, bj_net_linux::Rx_instrumentation> rx_instrumentation; // key = interface index
+
+    // watches `socket`, owned from then on
+    Rx_socket& add_rx_socket(int socket);
+    void close_sockets();
+    void flush();
+    void handle_rx_data(Rx_socket& rx);
+};
@@ -0,0 +1,407 @@
+//
+//  bj_net_single_linux.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "bj_net_single_linux.h"
+#include "bj_net_socket_linux.h"
+#include "u2_mdns.h"
+#include "u2_probe.h"
+
+static const size_t batch_slot_size = U2_MDNS_MSG_SIZE_MAX;
+
+Bj_net_single_linux::Bj_net_single_linux(const Bj_net_address& bound_address, const std::vector<Bj_net_address>& interface_addresses, bool multicast, std::optional<Bj_net_executor_linux> executor) : exec(executor.has_value() ? executor.value() : Bj_net_executor_linux())
+{
+    this->multicast = multicast;
+    this->bound_address = bound_address;
+    this->interface_addresses = interface_addresses;
+    this->reply_proxy = std::bind(&Bj_net_single_linux::reply, this, std::placeholders::_1, std::placeholders::_2);
+    this->rx_buf = std::make_unique<uint8_t[]>(rx_buf_size);
+    this->rx_control_buf = std::make_unique<uint8_t[]>(rx_batch_max * bj_net_linux::rx_control_size);
+    this->rx_names = std::make_unique<struct sockaddr_storage[]>(rx_batch_max);
+}
+
+Bj_net_single_linux::~Bj_net_single_linux()
+{
+    assert(!opened);
+}
+
+const Bj_net_executor& Bj_net_single_linux::executor() const
+{
+    return exec;
+}
+
+void Bj_net_single_linux::set_rx_begin_handler(Bj_net_rx_begin_handler rx_begin_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_begin_handler = rx_begin_handler;
+}
+
+void Bj_net_single_linux::set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_data_handler = rx_data_handler;
+}
+
+void Bj_net_single_linux::set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_end_handler = rx_end_handler;
+}
+
+void Bj_net_single_linux::set_rx_update_handler(Bj_net_rx_update_handler rx_update_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_update_handler = rx_update_handler;
+}
+
+void Bj_net_single_linux::set_batched_io(bool enabled)
+{
+    if (opened)
+        throw std::logic_error("the I/O mode must be set before opening");
+
+    batched_io = enabled;
+}
+
+void Bj_net_single_linux::set_query_filter(bool enabled)
+{
+    if (opened)
+        throw std::logic_error("the query filter must be set before opening");
+
+    query_filter = enabled;
+}
+
+void Bj_net_single_linux::set_mtu(size_t mtu)
+{
+    if (opened)
+        throw std::logic_error("the MTU must be set before opening");
+
+    this->mtu = mtu;
+}
+
+void Bj_net_single_linux::update_addresses(const Bj_net_address& bound_address, const std::vector<Bj_net_address>& interface_addresses)
+{
+    if (!opened)
+        throw std::logic_error("not open");
+
+    if (!exec.is_current()) {
+        exec.invoke_sync([&]() {
+            update_addresses(bound_address, interface_addresses);
+        });
+        return;
+    }
+
+    // the membership belongs to the interface, only the source of the outgoing messages depends on the address
+    if (bound_address != this->bound_address) {
+        // the unicast rx socket is bound to the address, a new one replaces it
+        if (!multicast) {
+            int socket = bj_net_linux::open_unicast_rx_socket(bound_address, query_filter);
+            exec.unwatch(rx_watch);
+            ::close(rx_socket);
+            rx_socket = socket;
+            watch_rx_socket();
+        }
+        bj_net_linux::set_multicast_tx_address(tx_socket, bound_address, false);
+        this->bound_address = bound_address;
+    }
+    this->interface_addresses = interface_addresses;
+
+    if (rx_update_handler)
+        rx_update_handler(0, interface_addresses);
+}
+
+void Bj_net_single_linux::set_log_level(int log_level)
+{
+    this->log_level = log_level;
+}
+
+void Bj_net_single_linux::open()
+{
+    if (opened)
+        throw std::logic_error("already open");
+
+    open_sockets();
+
+    opened = true;
+
+    Bj_net_mtu mtu = Bj_net_mtu::udp(bound_address.protocol, this->mtu ? this->mtu : bj_net_linux::interface_mtu(bound_address));
+
+    if (batched_io && !rx_msgs) {
+        rx_batch_buf = std::make_unique<unsigned char[]>(rx_batch_max * batch_slot_size);
+        tx_batch_buf = std::make_unique<unsigned char[]>(rx_batch_max * batch_slot_size);
+        rx_msgs = std::make_unique<struct mmsghdr[]>(rx_batch_max);
+        tx_msgs = std::make_unique<struct mmsghdr[]>(rx_batch_max);
+        rx_iovs = std::make_unique<struct iovec[]>(rx_batch_max);
+        tx_iovs = std::make_unique<struct iovec[]>(rx_batch_max);
+        tx_names = std::make_unique<struct sockaddr_storage[]>(rx_batch_max);
+        for (int i = 0; i < rx_batch_max; i++)
+            rx_iovs[i] = { .iov_base = rx_batch_buf.get() + i * batch_slot_size, .iov_len = batch_slot_size };
+    }
+
+    rx_instrumentation = {};
+
+    if (rx_begin_handler)
+        rx_begin_handler(0, interface_addresses, mtu);
+
+    watch_rx_socket();
+}
+
+void Bj_net_single_linux::close(std::function<void()> completion)
+{
+    if (!opened)
+        throw std::logic_error("not open");
+
+    if (close_completion)
+        throw std::logic_error("already closing");
+
+    close_completion = completion;
+
+    // from now on, the datagrams still queued are read but not delivered: the
+    // owner may stop serving the replies before the completion is invoked
+
+    // like the Apple backend, the completion is invoked on the executor
+    exec.invoke_async([this]() {
+        exec.unwatch(rx_watch);
+        rx_watch = 0;
+
+        if (rx_end_handler)
+            rx_end_handler(0);
+
+        close_sockets();
+        opened = false;
+
+        auto f = close_completion;
+        close_completion = nullptr;
+        f();
+    });
+}
+
+void Bj_net_single_linux::send(std::span<unsigned char> data)
+{
+    U2_PROBE3(bj, send, 0, data.data(), data.size());
+    transmit(data);
+}
+
+bool Bj_net_single_linux::is_reply_thread_safe() const
+{
+    return true;
+}
+
+std::map<int, Bj_net_rx_stats> Bj_net_single_linux::get_rx_stats()
+{
+    std::map<int, Bj_net_rx_stats> stats;
+    exec.invoke_sync([&]() {
+        if (opened) {
+            stats[0] = rx_instrumentation.get_stats();
+            stats[0].filtered = query_filter;
+        }
+    });
+    return stats;
+}
+
+void Bj_net_single_linux::open_sockets()
+{
+    try {
+        interface_index = bj_net_linux::interface_index(bound_address);
+        if (bound_address.protocol == Bj_net_protocol::ipv6) {
+            struct sockaddr_in6 group = bj_net_linux::multicast_group6(interface_index);
+            memcpy(&multicast_group, &group, sizeof(group));
+            multicast_group_size = sizeof(group);
+        } else {
+            struct sockaddr_in group = bj_net_linux::multicast_group();
+            memcpy(&multicast_group, &group, sizeof(group));
+            multicast_group_size = sizeof(group);
+        }
+        tx_socket = bj_net_linux::open_multicast_tx_socket(bound_address, false);
+        if (multicast)
+            rx_socket = bj_net_linux::open_multicast_rx_socket(bound_address, query_filter);
+        else
+            rx_socket = bj_net_linux::open_unicast_rx_socket(bound_address, query_filter);
+    } catch (Bj_net_open_error& exc) {
+        close_sockets();
+        throw;
+    }
+}
+
+Bj_net_source Bj_net_single_linux::source_of(const struct sockaddr_storage& name) const
+{
+    Bj_net_source source = bj_net_linux::source_of(name);
+    source.direct = !multicast;
+    return source;
+}
+
+void Bj_net_single_linux::watch_rx_socket()
+{
+    rx_watch = exec.watch(rx_socket, [this]() {
+        if (batched_io)
+            handle_rx_data_batched();
+        else
+            handle_rx_data();
+    });
+}
+
+void Bj_net_single_linux::close_sockets()
+{
+    if (tx_socket != -1)
+        ::close(tx_socket);
+    tx_socket = -1;
+    if (rx_socket != -1)
+        ::close(rx_socket);
+    rx_socket = -1;
+}
+
+void Bj_net_single_linux::reply(std::span<unsigned char> data, const Bj_net_source& destination)
+{
+    U2_PROBE3(bj, reply, 0, data.data(), data.size());
+    transmit(data, destination);
+}
+
+void Bj_net_single_linux::transmit(std::span<unsigned char> data, const Bj_net_source& destination)
+{
+    // out of an rx batch, from another thread, or if the message does not fit in a slot, send right away
+    if (!exec.is_current() || !in_rx_batch || data.size() > batch_slot_size) {
+        if (destination.is_defined()) {
+            struct sockaddr_storage addr;
+            socklen_t addr_size = bj_net_linux::sockaddr_of(destination, interface_index, addr);
+            sendto(tx_socket, data.data(), data.size(), 0, (struct sockaddr *)&addr, addr_size);
+        } else {
+            sendto(tx_socket, data.data(), data.size(), 0, (struct sockaddr *)&multicast_group, multicast_group_size);
+        }
+        return;
+    }
+
+    if (tx_count == rx_batch_max)
+        flush();
+
+    unsigned char *slot = tx_batch_buf.get() + tx_count * batch_slot_size;
+    memcpy(slot, data.data(), data.size());
+    tx_iovs[tx_count] = { .iov_base = slot, .iov_len = data.size() };
+    struct msghdr& hdr = tx_msgs[tx_count].msg_hdr;
+    hdr = {};
+    if (destination.is_defined()) {
+        hdr.msg_name = &tx_names[tx_count];
+        hdr.msg_namelen = bj_net_linux::sockaddr_of(destination, interface_index, tx_names[tx_count]);
+    } else {
+        hdr.msg_name = &multicast_group;
+        hdr.msg_namelen = multicast_group_size;
+    }
+    hdr.msg_iov = &tx_iovs[tx_count];
+    hdr.msg_iovlen = 1;
+    tx_count++;
+}
+
+void Bj_net_single_linux::flush()
+{
+    // messages that cannot be sent are dropped, as with sendto()
+    int sent = 0;
+    while (sent < tx_count) {
+        int rv = sendmmsg(tx_socket, &tx_msgs[sent], tx_count - sent, 0);
+        if (rv < 0) {
+            if (errno == EINTR)
+                continue;
+            sent++; // skip the failing message
+        } else {
+            sent += rv;
+        }
+    }
+    tx_count = 0;
+}
+
+void Bj_net_single_linux::handle_rx_data()
+{
+    /*
+     * The socket is drained by batches: the watch is level triggered, so
+     * whatever is left after `rx_batch_max` datagrams is handled at the next
+     * loop iteration, after the other sources. Errors, including EAGAIN,
+     * end the batch.
+     */
+    for (int i = 0; i < rx_batch_max; i++) {
+        struct iovec iov = { .iov_base = rx_buf.get(), .iov_len = rx_buf_size };
+        struct msghdr hdr = {};
+        hdr.msg_name = &rx_names[0];
+        hdr.msg_namelen = sizeof(rx_names[0]);
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = rx_control_buf.get();
+        hdr.msg_controllen = bj_net_linux::rx_control_size;
+        ssize_t rv = recvmsg(rx_socket, &hdr, 0);
+        if (rv < 0)
+            break;
+        rx_instrumentation.update(bj_net_linux::parse_rx_control(hdr));
+        if (rv == 0)
+            continue;
+        U2_PROBE3(bj, rx, 0, rx_buf.get(), rv);
+        if (rx_data_handler && !close_completion)
+            rx_data_handler(0, std::span(rx_buf.get(), rv), source_of(rx_names[0]), reply_proxy);
+    }
+}
+
+void Bj_net_single_linux::handle_rx_data_batched()
+{
+    // recvmmsg() updates the lengths, they must be reset for every batch
+    for (int i = 0; i < rx_batch_max; i++) {
+        struct msghdr& hdr = rx_msgs[i].msg_hdr;
+        hdr = {};
+        hdr.msg_name = &rx_names[i];
+        hdr.msg_namelen = sizeof(rx_names[i]);
+        hdr.msg_iov = &rx_iovs[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = rx_control_buf.get() + i * bj_net_linux::rx_control_size;
+        hdr.msg_controllen = bj_net_linux::rx_control_size;
+    }
+
+    int count = recvmmsg(rx_socket, rx_msgs.get(), rx_batch_max, MSG_DONTWAIT, nullptr);
+    if (count <= 0)
+        return;
+
+    in_rx_batch = true;
+    for (int i = 0; i < count; i++) {
+        size_t size = rx_msgs[i].msg_len;
+        rx_instrumentation.update(bj_net_linux::parse_rx_control(rx_msgs[i].msg_hdr));
+        if (size == 0 || (rx_msgs[i].msg_hdr.msg_flags & MSG_TRUNC))
+            continue;
+        unsigned char *data = (unsigned char *)rx_iovs[i].iov_base;
+        U2_PROBE3(bj, rx, 0, data, size);
+        if (rx_data_handler && !close_completion)
+            rx_data_handler(0, std::span(data, size), source_of(rx_names[i]), reply_proxy);
+    }
+    in_rx_batch = false;
+
+    if (tx_count > 0)
+        flush();
+}
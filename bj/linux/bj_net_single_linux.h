@@ -0,0 +1,142 @@
+//
+//  bj_net_single_linux.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <memory>
+#include <optional>
+#include "bj_net.h"
+#include "bj_net_executor_linux.h"
+#include "bj_net_socket_linux.h"
+
+/**
+ * Bj_net over the mDNS multicast group on a single interface, the one
+ * having `bound_address`. The protocol of `bound_address` selects the group,
+ * 224.0.0.251 or ff02::fb.
+ *
+ * Without `multicast`, the queries sent directly to port 5353 of
+ * `bound_address` are received instead, see
+ * bj_net_linux::open_unicast_rx_socket(), and their source is flagged as
+ * direct. Sending still goes to the group.
+ *
+ * Each wakeup of the rx socket drains up to `rx_batch_max` datagrams, so
+ * that a burst of queries costs a single pass through the event loop.
+ *
+ * In batched I/O mode (the default), these datagrams are read with a single
+ * recvmmsg() and everything sent while handling them, replies included, is
+ * queued and flushed with a single sendmmsg() at the end of the batch.
+ * Datagrams bigger than U2_MDNS_MSG_SIZE_MAX are dropped in this mode.
+ */
+class Bj_net_single_linux : public Bj_net {
+public:
+    static constexpr int rx_batch_max = 64;
+
+    Bj_net_single_linux(const Bj_net_address& bound_address, const std::vector<Bj_net_address>& interface_addresses, bool multicast, std::optional<Bj_net_executor_linux> executor = std::nullopt);
+    ~Bj_net_single_linux();
+
+    Bj_net_single_linux(const Bj_net_single_linux&) = delete;
+    Bj_net_single_linux& operator= (const Bj_net_single_linux&) = delete;
+
+    // must be called before opening
+    void set_batched_io(bool enabled);
+
+    // must be called before opening; enabled by default, see bj_net_linux::attach_query_filter()
+    void set_query_filter(bool enabled);
+
+    // must be called before opening; by default, the MTU is read from the interface when opening
+    void set_mtu(size_t mtu);
+
+    // must be called while open, the sockets are kept, except a unicast rx socket bound to the previous address,
+    // and the rx update handler is called; throws Bj_net_open_error
+    void update_addresses(const Bj_net_address& bound_address, const std::vector<Bj_net_address>& interface_addresses);
+
+    const Bj_net_executor& executor() const override;
+    void set_rx_begin_handler(Bj_net_rx_begin_handler rx_handler) override;
+    void set_rx_data_handler(Bj_net_rx_data_handler rx_handler) override;
+    void set_rx_end_handler(Bj_net_rx_end_handler rx_handler) override;
+    void set_rx_update_handler(Bj_net_rx_update_handler rx_handler) override;
+    void set_log_level(int log_level) override;
+    void open() override;
+    void close(std::function<void()> completion) override;
+
+    void send(std::span<unsigned char> data) override;
+    bool is_reply_thread_safe() const override;
+    std::map<int, Bj_net_rx_stats> get_rx_stats() override;
+
+private:
+    Bj_net_address bound_address;
+    std::vector<Bj_net_address> interface_addresses;
+    bool multicast;
+    size_t mtu = 0; // 0 = read from the interface
+    Bj_net_executor_linux exec;
+    int log_level = 0;
+
+    struct sockaddr_storage multicast_group;
+    socklen_t multicast_group_size = 0;
+    int interface_index = 0;
+    int rx_socket = -1;
+    int tx_socket = -1;
+    int rx_watch = 0;
+    const size_t rx_buf_size = 65536;
+    std::unique_ptr<unsigned char[]> rx_buf;
+    std::unique_ptr<unsigned char[]> rx_control_buf; // rx_batch_max slots of bj_net_linux::rx_control_size
+    std::unique_ptr<struct sockaddr_storage[]> rx_names; // rx_batch_max slots
+    bj_net_linux::Rx_instrumentation rx_instrumentation;
+
+    // batched I/O
+    bool batched_io = true;
+    bool query_filter = true;
+    bool in_rx_batch = false;
+    std::unique_ptr<unsigned char[]> rx_batch_buf; // rx_batch_max slots of U2_MDNS_MSG_SIZE_MAX
+    std::unique_ptr<unsigned char[]> tx_batch_buf; // rx_batch_max slots of U2_MDNS_MSG_SIZE_MAX
+    std::unique_ptr<struct mmsghdr[]> rx_msgs;
+    std::unique_ptr<struct mmsghdr[]> tx_msgs;
+    std::unique_ptr<struct iovec[]> rx_iovs;
+    std::unique_ptr<struct iovec[]> tx_iovs;
+    std::unique_ptr<struct sockaddr_storage[]> tx_names; // unicast destinations
+    int tx_count = 0;
+
+    bool opened = false;
+
+    Bj_net_rx_begin_handler rx_begin_handler;
+    Bj_net_rx_data_handler rx_data_handler;
+    Bj_net_rx_end_handler rx_end_handler;
+    Bj_net_rx_update_handler rx_update_handler;
+    Bj_net_reply reply_proxy;
+
+    std::function<void()> close_completion;
+
+    void open_sockets();
+    void watch_rx_socket();
+    void close_sockets();
+    Bj_net_source source_of(const struct sockaddr_storage& name) const;
+    void reply(std::span<unsigned char> data, const Bj_net_source& destination);
+    void transmit(std::span<unsigned char> data, const Bj_net_source& destination = Bj_net_source());
+    void flush();
+    void handle_rx_data();
+    void handle_rx_data_batched();
+};
@@ -0,0 +1,594 @@
+//
+//  bj_net_socket_linux.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <linux/filter.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include "bj_net_socket_linux.h"
+
+#ifndef IPV6_MULTICAST_ALL
+#define IPV6_MULTICAST_ALL 29 // linux/in6.h, not exposed by netinet/in.h
+#endif
+
+namespace bj_net_linux
+{
+
+struct sockaddr_in multicast_group()
+{
+    Bj_net_address group_addr = { 224, 0, 0, 251 };
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    std::copy(group_addr.ipv4.begin(), group_addr.ipv4.end(), reinterpret_cast<unsigned char*>(&addr.sin_addr.s_addr));
+    addr.sin_port = htons(5353);
+    return addr;
+}
+
+struct sockaddr_in6 multicast_group6(int interface_index)
+{
+    static const Bj_net_address group_addr = { 0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xfb };
+    struct sockaddr_in6 addr = {};
+    addr.sin6_family = AF_INET6;
+    std::copy(group_addr.ipv6.begin(), group_addr.ipv6.end(), addr.sin6_addr.s6_addr);
+    addr.sin6_port = htons(5353);
+    addr.sin6_scope_id = interface_index; // the group is link-local
+    return addr;
+}
+
+Bj_net_source source_of(const struct sockaddr_storage& addr)
+{
+    Bj_net_source source;
+    if (addr.ss_family == AF_INET) {
+        auto addr4 = (const struct sockaddr_in *)&addr;
+        source.address = Bj_net_address(Bj_net_protocol::ipv4);
+        memcpy(source.address.ipv4.data(), &addr4->sin_addr, source.address.ipv4.size());
+        source.port = ntohs(addr4->sin_port);
+    } else if (addr.ss_family == AF_INET6) {
+        auto addr6 = (const struct sockaddr_in6 *)&addr;
+        source.address = Bj_net_address(Bj_net_protocol::ipv6);
+        memcpy(source.address.ipv6.data(), &addr6->sin6_addr, source.address.ipv6.size());
+        source.port = ntohs(addr6->sin6_port);
+    }
+    return source;
+}
+
+socklen_t sockaddr_of(const Bj_net_source& destination, int interface_index, struct sockaddr_storage& addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    if (destination.address.protocol == Bj_net_protocol::ipv6) {
+        auto addr6 = (struct sockaddr_in6 *)&addr;
+        addr6->sin6_family = AF_INET6;
+        memcpy(&addr6->sin6_addr, destination.address.ipv6.data(), destination.address.ipv6.size());
+        addr6->sin6_port = htons(destination.port);
+        addr6->sin6_scope_id = interface_index; // ignored by the kernel for global addresses
+        return sizeof(*addr6);
+    }
+    auto addr4 = (struct sockaddr_in *)&addr;
+    addr4->sin_family = AF_INET;
+    memcpy(&addr4->sin_addr, destination.address.ipv4.data(), destination.address.ipv4.size());
+    addr4->sin_port = htons(destination.port);
+    return sizeof(*addr4);
+}
+
+static struct in_addr interface_in_addr(const Bj_net_address& interface_address)
+{
+    if (interface_address.protocol != Bj_net_protocol::ipv4)
+        throw Bj_net_open_error("only ipv4 is supported");
+
+    struct in_addr addr;
+    std::copy(interface_address.ipv4.begin(), interface_address.ipv4.end(), reinterpret_cast<unsigned char*>(&addr.s_addr));
+    return addr;
+}
+
+static void set_reuse(int socket)
+{
+    // allow sharing port 5353 with other responders and with the sockets of other interfaces
+    int reuse = 1;
+    if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0)
+        throw Bj_net_open_error("cannot configure the socket to be reused");
+    if (setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) != 0)
+        throw Bj_net_open_error("cannot configure the socket to be reused");
+}
+
+/*
+ * By default, Linux delivers a multicast datagram to every socket bound to
+ * the group and port, whatever the interface the membership was added on.
+ * With IP_MULTICAST_ALL disabled, a socket only gets the datagrams of the
+ * memberships it added itself, on their interface.
+ */
+static void disable_multicast_all(int socket)
+{
+    int zero = 0;
+    if (setsockopt(socket, IPPROTO_IP, IP_MULTICAST_ALL, &zero, sizeof(zero)) != 0)
+        throw Bj_net_open_error("cannot restrict the socket multicast reception");
+}
+
+// IPv6 counterpart of disable_multicast_all()
+static void disable_multicast6_all(int socket)
+{
+    int zero = 0;
+    if (setsockopt(socket, IPPROTO_IPV6, IPV6_MULTICAST_ALL, &zero, sizeof(zero)) != 0)
+        throw Bj_net_open_error("cannot restrict the socket multicast reception");
+}
+
+// the IPv4 traffic has its own sockets
+static void set_ipv6_only(int socket)
+{
+    int one = 1;
+    if (setsockopt(socket, IPPROTO_IPV6, IPV6_V6ONLY, &one, sizeof(one)) != 0)
+        throw Bj_net_open_error("cannot restrict the socket to ipv6");
+}
+
+// filter and instrumentation, whatever the protocol
+static void configure_rx_socket(int rx_socket, bool query_filter)
+{
+    if (query_filter)
+        attach_query_filter(rx_socket);
+
+    int one = 1;
+    if (setsockopt(rx_socket, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one)) != 0)
+        throw Bj_net_open_error("cannot enable SO_TIMESTAMPNS, errno=" + std::to_string(errno));
+    if (setsockopt(rx_socket, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one)) != 0)
+        throw Bj_net_open_error("cannot enable SO_RXQ_OVFL, errno=" + std::to_string(errno));
+}
+
+// socket bound to the group, not yet member of it
+static int open_rx_socket(bool query_filter)
+{
+    struct sockaddr_in group = multicast_group();
+
+    int rx_socket = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (rx_socket < 0)
+        throw Bj_net_open_error("cannot create dns-sd rx socket");
+
+    try {
+        set_reuse(rx_socket);
+        disable_multicast_all(rx_socket);
+
+        // bind to the group address, so that only multicast telegrams are received
+        if (bind(rx_socket, (struct sockaddr *)&group, sizeof(group)) != 0)
+            throw Bj_net_open_error("cannot bind port to socket, errno=" + std::to_string(errno));
+
+        configure_rx_socket(rx_socket, query_filter);
+    } catch (...) {
+        ::close(rx_socket);
+        throw;
+    }
+
+    return rx_socket;
+}
+
+// socket bound to port 5353, sending to the group
+static int open_tx_socket()
+{
+    int tx_socket = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (tx_socket < 0)
+        throw Bj_net_open_error("cannot create dns-sd tx socket");
+
+    try {
+        set_reuse(tx_socket);
+
+        // the tx socket is never read, it must not get the multicast traffic joined by other sockets
+        disable_multicast_all(tx_socket);
+
+        // bind tx socket
+        struct sockaddr_in tx_addr = {};
+        tx_addr.sin_family = AF_INET;
+        tx_addr.sin_port = htons(5353);
+        tx_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(tx_socket, (struct sockaddr *)&tx_addr, sizeof(tx_addr)) != 0)
+            throw Bj_net_open_error("cannot bind the tx socket, errno=" + std::to_string(errno));
+
+        // set multicast output TTL
+        unsigned char ttl = 10;
+        if (setsockopt(tx_socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0)
+            throw Bj_net_open_error("cannot set multicast ttl");
+    } catch (...) {
+        ::close(tx_socket);
+        throw;
+    }
+
+    return tx_socket;
+}
+
+// IPv6 counterpart of open_rx_socket() and of the membership, the group is bound to the interface
+static int open_rx_socket6(int interface_index, bool query_filter)
+{
+    struct sockaddr_in6 group = multicast_group6(interface_index);
+
+    int rx_socket = ::socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (rx_socket < 0)
+        throw Bj_net_open_error("cannot create dns-sd ipv6 rx socket");
+
+    try {
+        set_reuse(rx_socket);
+        set_ipv6_only(rx_socket);
+        disable_multicast6_all(rx_socket);
+
+        if (bind(rx_socket, (struct sockaddr *)&group, sizeof(group)) != 0)
+            throw Bj_net_open_error("cannot bind port to socket, errno=" + std::to_string(errno));
+
+        configure_rx_socket(rx_socket, query_filter);
+
+        struct ipv6_mreq mreq = {};
+        mreq.ipv6mr_multiaddr = group.sin6_addr;
+        mreq.ipv6mr_interface = interface_index;
+        if (setsockopt(rx_socket, IPPROTO_IPV6, IPV6_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+            throw Bj_net_open_error("cannot join multicast group, errno=" + std::to_string(errno));
+    } catch (...) {
+        ::close(rx_socket);
+        throw;
+    }
+
+    return rx_socket;
+}
+
+static int open_tx_socket6(int interface_index, bool connected)
+{
+    int tx_socket = ::socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (tx_socket < 0)
+        throw Bj_net_open_error("cannot create dns-sd ipv6 tx socket");
+
+    try {
+        set_reuse(tx_socket);
+        set_ipv6_only(tx_socket);
+        disable_multicast6_all(tx_socket);
+
+        struct sockaddr_in6 tx_addr = {};
+        tx_addr.sin6_family = AF_INET6;
+        tx_addr.sin6_port = htons(5353);
+        tx_addr.sin6_addr = in6addr_any;
+        if (bind(tx_socket, (struct sockaddr *)&tx_addr, sizeof(tx_addr)) != 0)
+            throw Bj_net_open_error("cannot bind the tx socket, errno=" + std::to_string(errno));
+
+        // RFC 6762, section 11
+        int hops = 255;
+        if (setsockopt(tx_socket, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof(hops)) != 0)
+            throw Bj_net_open_error("cannot set multicast hop limit");
+
+        // the source address is selected by the kernel for each datagram, from the addresses of the interface
+        unsigned index = interface_index;
+        if (setsockopt(tx_socket, IPPROTO_IPV6, IPV6_MULTICAST_IF, &index, sizeof(index)) != 0)
+            throw Bj_net_open_error("cannot set multicast output interface");
+
+        struct sockaddr_in6 group = multicast_group6(interface_index);
+        if (connected && connect(tx_socket, (struct sockaddr *)&group, sizeof(group)) != 0)
+            throw Bj_net_open_error("cannot connect the tx socket, errno=" + std::to_string(errno));
+    } catch (...) {
+        ::close(tx_socket);
+        throw;
+    }
+
+    return tx_socket;
+}
+
+// interface having `address`
+static int interface_index_of(const Bj_net_address& address)
+{
+    int index = interface_index(address);
+    if (index == 0)
+        throw Bj_net_open_error("no interface has " + address.as_str());
+    return index;
+}
+
+int open_multicast_rx_socket(const Bj_net_address& interface_address, bool query_filter)
+{
+    if (interface_address.protocol == Bj_net_protocol::ipv6)
+        return open_rx_socket6(interface_index_of(interface_address), query_filter);
+
+    struct in_addr interface_addr = interface_in_addr(interface_address);
+    struct sockaddr_in group = multicast_group();
+
+    int rx_socket = open_rx_socket(query_filter);
+    try {
+        // join multicast group
+        struct ip_mreq mreq = {};
+        mreq.imr_multiaddr = group.sin_addr;
+        mreq.imr_interface = interface_addr;
+        if (setsockopt(rx_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, (void*)&mreq, sizeof(mreq)) != 0)
+            throw Bj_net_open_error("cannot join multicast group, errno=" + std::to_string(errno));
+    } catch (...) {
+        ::close(rx_socket);
+        throw;
+    }
+
+    return rx_socket;
+}
+
+int open_multicast_tx_socket(const Bj_net_address& interface_address, bool connected)
+{
+    if (interface_address.protocol == Bj_net_protocol::ipv6)
+        return open_tx_socket6(interface_index_of(interface_address), connected);
+
+    int tx_socket = open_tx_socket();
+    try {
+        set_multicast_tx_address(tx_socket, interface_address, connected);
+    } catch (...) {
+        ::close(tx_socket);
+        throw;
+    }
+
+    return tx_socket;
+}
+
+void set_multicast_tx_address(int socket, const Bj_net_address& interface_address, bool connected)
+{
+    struct sockaddr_storage group = {};
+    socklen_t group_size;
+    if (interface_address.protocol == Bj_net_protocol::ipv6) {
+        // the interface is given by index, only the cached source address of a connected socket is stale
+        struct sockaddr_in6 group6 = multicast_group6(interface_index_of(interface_address));
+        memcpy(&group, &group6, sizeof(group6));
+        group_size = sizeof(group6);
+    } else {
+        struct in_addr interface_addr = interface_in_addr(interface_address);
+        struct sockaddr_in group4 = multicast_group();
+        memcpy(&group, &group4, sizeof(group4));
+        group_size = sizeof(group4);
+
+        // define on which interface, and from which address, to send multicast telegrams
+        if (setsockopt(socket, IPPROTO_IP, IP_MULTICAST_IF, &interface_addr, sizeof(interface_addr)) != 0)
+            throw Bj_net_open_error("cannot set multicast output interface");
+    }
+
+    if (!connected)
+        return;
+
+    // a connected socket keeps the source address it got when connecting, until it is disconnected
+    struct sockaddr unspec = {};
+    unspec.sa_family = AF_UNSPEC;
+    connect(socket, &unspec, sizeof(unspec));
+    if (connect(socket, (struct sockaddr *)&group, group_size) != 0)
+        throw Bj_net_open_error("cannot connect the tx socket, errno=" + std::to_string(errno));
+}
+
+/*
+ * Bound to the interface address, so that the kernel prefers it over the
+ * wildcard sockets of the same port, the tx sockets included, and to the
+ * device, so that the datagrams arriving on other interfaces are not
+ * received. Without membership and with IP_MULTICAST_ALL disabled, the
+ * group traffic is left to the multicast rx socket.
+ */
+int open_unicast_rx_socket(const Bj_net_address& interface_address, bool query_filter)
+{
+    bool is_ipv6 = interface_address.protocol == Bj_net_protocol::ipv6;
+    int index = interface_index_of(interface_address);
+    char name[IF_NAMESIZE] = {};
+    if (!if_indextoname(index, name))
+        throw Bj_net_open_error("no interface has " + interface_address.as_str());
+
+    int rx_socket = ::socket(is_ipv6 ? AF_INET6 : AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (rx_socket < 0)
+        throw Bj_net_open_error("cannot create dns-sd unicast rx socket");
+
+    try {
+        set_reuse(rx_socket);
+        if (is_ipv6) {
+            set_ipv6_only(rx_socket);
+            disable_multicast6_all(rx_socket);
+        } else {
+            disable_multicast_all(rx_socket);
+        }
+
+        if (setsockopt(rx_socket, SOL_SOCKET, SO_BINDTODEVICE, name, strlen(name)) != 0)
+            throw Bj_net_open_error("cannot bind the socket to " + std::string(name) + ", errno=" + std::to_string(errno));
+
+        Bj_net_source local = { interface_address, 5353 };
+        struct sockaddr_storage addr;
+        socklen_t addr_size = sockaddr_of(local, index, addr);
+        if (bind(rx_socket, (struct sockaddr *)&addr, addr_size) != 0)
+            throw Bj_net_open_error("cannot bind port to socket, errno=" + std::to_string(errno));
+
+        configure_rx_socket(rx_socket, query_filter);
+    } catch (...) {
+        ::close(rx_socket);
+        throw;
+    }
+
+    return rx_socket;
+}
+
+int open_multicast_shared_rx_socket(bool query_filter)
+{
+    int rx_socket = open_rx_socket(query_filter);
+    try {
+        // tell on which interface each datagram arrived
+        int one = 1;
+        if (setsockopt(rx_socket, IPPROTO_IP, IP_PKTINFO, &one, sizeof(one)) != 0)
+            throw Bj_net_open_error("cannot enable IP_PKTINFO, errno=" + std::to_string(errno));
+    } catch (...) {
+        ::close(rx_socket);
+        throw;
+    }
+
+    return rx_socket;
+}
+
+int open_multicast_shared_tx_socket()
+{
+    return open_tx_socket();
+}
+
+Rx_control parse_rx_control(const struct msghdr& hdr)
+{
+    Rx_control control;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR((struct msghdr *)&hdr, cmsg)) {
+        if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+            control.interface_index = ((struct in_pktinfo *)CMSG_DATA(cmsg))->ipi_ifindex;
+        } else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            control.timestamp_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        } else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+            memcpy(&control.drop_count, CMSG_DATA(cmsg), sizeof(control.drop_count));
+        }
+    }
+    return control;
+}
+
+uint32_t Rx_drop_counter::update(const Rx_control& control)
+{
+    if (control.drop_count <= last_drop_count)
+        return 0;
+    uint32_t drop_count = control.drop_count - last_drop_count;
+    last_drop_count = control.drop_count;
+    return drop_count;
+}
+
+void Rx_instrumentation::update(const Rx_control& control)
+{
+    update(control, drop_counter.update(control));
+}
+
+void Rx_instrumentation::update(const Rx_control& control, uint32_t drop_count)
+{
+    if (control.timestamp_ns) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+        if (now_ns > control.timestamp_ns)
+            stats.delay.record(now_ns - control.timestamp_ns);
+    }
+
+    stats.drop_count += drop_count;
+}
+
+void attach_query_filter(int socket)
+{
+    /*
+     * Classic BPF on a UDP socket sees the datagram from the UDP header:
+     * the DNS header starts at offset 8, its flags at 10 and the question
+     * count at 12.
+     */
+    static struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 8 + 12, 0, 5),  // shorter than a DNS header: drop
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 10),
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x80, 3, 0),   // response: drop
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 1, 0),       // no question: drop
+        BPF_STMT(BPF_RET | BPF_K, 0xffffffff),              // accept the whole datagram
+        BPF_STMT(BPF_RET | BPF_K, 0),
+    };
+    struct sock_fprog program = {
+        .len = sizeof(code) / sizeof(code[0]),
+        .filter = code,
+    };
+    if (setsockopt(socket, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) != 0)
+        throw Bj_net_open_error("cannot attach the socket filter, errno=" + std::to_string(errno));
+}
+
+// name of the interface having `interface_address`, empty if none
+static std::string interface_name(const Bj_net_address& interface_address)
+{
+    struct ifaddrs *list;
+    if (getifaddrs(&list) != 0)
+        return "";
+
+    std::string name;
+    for (struct ifaddrs *ifa = list; ifa && name.empty(); ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr)
+            continue;
+        if (ifa->ifa_addr->sa_family == AF_INET && interface_address.protocol == Bj_net_protocol::ipv4) {
+            auto addr = (const unsigned char *)&((struct sockaddr_in *)ifa->ifa_addr)->sin_addr;
+            if (std::equal(interface_address.ipv4.begin(), interface_address.ipv4.end(), addr))
+                name = ifa->ifa_name;
+        } else if (ifa->ifa_addr->sa_family == AF_INET6 && interface_address.protocol == Bj_net_protocol::ipv6) {
+            auto addr = ((struct sockaddr_in6 *)ifa->ifa_addr)->sin6_addr.s6_addr;
+            if (std::equal(interface_address.ipv6.begin(), interface_address.ipv6.end(), addr))
+                name = ifa->ifa_name;
+        }
+    }
+
+    freeifaddrs(list);
+    return name;
+}
+
+size_t interface_mtu(const Bj_net_address& interface_address)
+{
+    const size_t default_mtu = 1500;
+
+    std::string name = interface_name(interface_address);
+    if (name.empty())
+        return default_mtu;
+
+    size_t mtu = default_mtu;
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0) {
+        struct ifreq ifr = {};
+        strncpy(ifr.ifr_name, name.c_str(), IFNAMSIZ - 1);
+        if (ioctl(fd, SIOCGIFMTU, &ifr) == 0 && ifr.ifr_mtu > 0)
+            mtu = ifr.ifr_mtu;
+        ::close(fd);
+    }
+    return mtu;
+}
+
+int interface_index(const Bj_net_address& interface_address)
+{
+    std::string name = interface_name(interface_address);
+    return name.empty() ? 0 : (int)if_nametoindex(name.c_str());
+}
+
+static struct ip_mreqn interface_membership(int interface_index)
+{
+    struct ip_mreqn mreq = {};
+    mreq.imr_multiaddr = multicast_group().sin_addr;
+    mreq.imr_ifindex = interface_index;
+    return mreq;
+}
+
+void join_multicast_group(int socket, int interface_index)
+{
+    if (!try_join_multicast_group(socket, interface_index))
+        throw Bj_net_open_error("cannot join multicast group, errno=" + std::to_string(ENOBUFS));
+}
+
+bool try_join_multicast_group(int socket, int interface_index)
+{
+    struct ip_mreqn mreq = interface_membership(interface_index);
+    if (setsockopt(socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == 0)
+        return true;
+    if (errno == ENOBUFS)
+        return false;
+    throw Bj_net_open_error("cannot join multicast group, errno=" + std::to_string(errno));
+}
+
+void leave_multicast_group(int socket, int interface_index)
+{
+    // fails if the interface is already gone, in which case the kernel dropped the membership itself
+    struct ip_mreqn mreq = interface_membership(interface_index);
+    setsockopt(socket, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq));
+}
+
+} // namespace
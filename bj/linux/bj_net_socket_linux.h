@@ -0,0 +1,131 @@
+//
+//  bj_net_socket_linux.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include "bj_net.h"
+
+/*
+ * Sockets of the mDNS multicast groups, 224.0.0.251 and ff02::fb, and of the
+ * queries sent directly to this host, shared by the Linux backends. The
+ * functions taking an interface address open IPv6 sockets for an IPv6
+ * address, the others are IPv4 only. The open and join functions throw
+ * Bj_net_open_error.
+ */
+namespace bj_net_linux
+{
+
+// 224.0.0.251:5353
+struct sockaddr_in multicast_group();
+
+// [ff02::fb]:5353 on the given interface
+struct sockaddr_in6 multicast_group6(int interface_index);
+
+// source of a received datagram, undefined if not IPv4 or IPv6
+Bj_net_source source_of(const struct sockaddr_storage& addr);
+
+// address of a unicast destination, scoped to `interface_index` if IPv6; returns its size
+socklen_t sockaddr_of(const Bj_net_source& destination, int interface_index, struct sockaddr_storage& addr);
+
+/*
+ * The rx sockets deliver with each datagram its arrival time in the kernel
+ * (SO_TIMESTAMPNS) and, once the kernel dropped datagrams, the number
+ * dropped so far (SO_RXQ_OVFL). The kernel counts both the datagrams that
+ * did not fit in the socket queue and the ones rejected by the socket
+ * filter: queue overflows can only be told apart without query filter.
+ */
+const size_t rx_control_size = CMSG_SPACE(sizeof(struct in_pktinfo)) + CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t));
+
+struct Rx_control {
+    int interface_index = 0;     // shared rx sockets only
+    uint64_t timestamp_ns = 0;   // CLOCK_REALTIME, 0 if unknown
+    uint32_t drop_count = 0; // since the socket was opened
+};
+
+Rx_control parse_rx_control(const struct msghdr& hdr);
+
+// datagrams an rx socket dropped since its previous datagram; the kernel gives the total count, and only once it is not zero
+class Rx_drop_counter {
+public:
+    uint32_t update(const Rx_control& control);
+
+private:
+    uint32_t last_drop_count = 0;
+};
+
+// Bj_net_rx_stats of an rx socket, must be updated on the executor for every datagram received
+class Rx_instrumentation {
+public:
+    void update(const Rx_control& control);
+    // socket shared by several interfaces: its own Rx_drop_counter gives the drops
+    void update(const Rx_control& control, uint32_t drop_count);
+    const Bj_net_rx_stats& get_stats() const { return stats; }
+
+private:
+    Bj_net_rx_stats stats;
+    Rx_drop_counter drop_counter;
+};
+
+// non-blocking socket receiving the group traffic of the interface having `interface_address` only,
+// queries only if `query_filter` (see attach_query_filter())
+int open_multicast_rx_socket(const Bj_net_address& interface_address, bool query_filter);
+
+// socket bound to port 5353 sending to the group through the interface having `interface_address`,
+// connected to the group if `connected`
+int open_multicast_tx_socket(const Bj_net_address& interface_address, bool connected);
+
+// make a socket opened by open_multicast_tx_socket() send from another address of the same interface
+void set_multicast_tx_address(int socket, const Bj_net_address& interface_address, bool connected);
+
+// non-blocking socket receiving the datagrams sent to port 5353 of `interface_address` on its interface,
+// queries only if `query_filter`; replies go through a multicast tx socket
+int open_unicast_rx_socket(const Bj_net_address& interface_address, bool query_filter);
+
+// non-blocking socket receiving the group traffic of the interfaces joined with join_multicast_group(),
+// with an IP_PKTINFO control message telling the interface of each datagram, queries only if `query_filter`
+int open_multicast_shared_rx_socket(bool query_filter);
+
+// socket bound to port 5353, the output interface must be given per datagram with IP_PKTINFO
+int open_multicast_shared_tx_socket();
+
+// drop in the kernel the datagrams a responder ignores: responses (QR bit set),
+// messages without question and datagrams shorter than a DNS header
+void attach_query_filter(int socket);
+
+// MTU of the interface having `interface_address`, 1500 if it cannot be found
+size_t interface_mtu(const Bj_net_address& interface_address);
+
+// index of the interface having `interface_address`, 0 if it cannot be found
+int interface_index(const Bj_net_address& interface_address);
+
+void join_multicast_group(int socket, int interface_index);
+// false if the socket already has net.ipv4.igmp_max_memberships memberships, throws on other errors
+bool try_join_multicast_group(int socket, int interface_index);
+void leave_multicast_group(int socket, int interface_index);
+
+} // namespace
@@ -0,0 +1,577 @@
+//
+//  bj_net_uring_linux.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include "bj_net_socket_linux.h"
+#include "bj_net_uring_linux.h"
+#include "u2_mdns.h"
+#include "u2_probe.h"
+
+static const unsigned sq_entry_count = 512;
+static const unsigned cq_entry_count = 4096;
+static const uint16_t rx_buffer_group = 0;
+
+// an rx buffer holds the io_uring_recvmsg_out header, the source address and the control data followed by the datagram
+static const size_t rx_buffer_size = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_in) + bj_net_linux::rx_control_size + U2_MDNS_MSG_SIZE_MAX;
+static const size_t tx_buffer_size = U2_MDNS_MSG_SIZE_MAX;
+
+// the user data of a request is made of its kind and of an endpoint token or a tx buffer index
+enum : uint64_t {
+    request_recv = 1,
+    request_write = 2,
+    request_cancel = 3,
+};
+
+static uint64_t user_data(uint64_t kind, uint32_t value)
+{
+    return (kind << 32) | value;
+}
+
+Bj_net_uring_linux::Bj_net_uring_linux() : link_monitor(exec)
+{
+    link_monitor.set_update_handler([this](const Bj_net_link_map& links) {
+        update(links);
+    });
+}
+
+Bj_net_uring_linux::~Bj_net_uring_linux()
+{
+    assert(!opened);
+}
+
+const Bj_net_executor& Bj_net_uring_linux::executor() const
+{
+    return exec;
+}
+
+void Bj_net_uring_linux::set_rx_begin_handler(Bj_net_rx_begin_handler rx_begin_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_begin_handler = rx_begin_handler;
+}
+
+void Bj_net_uring_linux::set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_data_handler = rx_data_handler;
+}
+
+void Bj_net_uring_linux::set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_end_handler = rx_end_handler;
+}
+
+void Bj_net_uring_linux::set_rx_update_handler(Bj_net_rx_update_handler rx_update_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_update_handler = rx_update_handler;
+}
+
+void Bj_net_uring_linux::set_query_filter(bool enabled)
+{
+    if (opened)
+        throw std::logic_error("the query filter must be set before opening");
+
+    query_filter = enabled;
+}
+
+void Bj_net_uring_linux::set_log_level(int log_level)
+{
+    this->log_level = log_level;
+}
+
+void Bj_net_uring_linux::open()
+{
+    if (opened)
+        throw std::logic_error("already open");
+
+    // the ring and the link monitor must be used from the executor only
+    if (!exec.is_current()) {
+        exec.invoke_sync([this]() {
+            open();
+        });
+        return;
+    }
+
+    setup_uring();
+    try {
+        link_monitor.start();
+    } catch (...) {
+        release_uring();
+        throw;
+    }
+    opened = true;
+    update(link_monitor.get_links());
+    uring->submit();
+}
+
+void Bj_net_uring_linux::close(std::function<void()> completion)
+{
+    if (!opened)
+        throw std::logic_error("not open");
+
+    if (close_completion)
+        throw std::logic_error("already closing");
+
+    close_completion = completion;
+
+    exec.invoke_async([this]() {
+        link_monitor.stop();
+        while (!endpoints.empty())
+            close_endpoint(endpoints.begin()->first);
+        if (!drain_uring()) {
+            // the kernel may still write into the buffers, they are leaked rather than freed
+            std::cout << "io_uring requests still pending, leaking their buffers\n";
+            rx_ring = nullptr;
+            (void)rx_buffers.release();
+            (void)tx_buffers.release();
+        }
+        release_uring();
+        opened = false;
+
+        auto f = close_completion;
+        close_completion = nullptr;
+        f();
+    });
+}
+
+void Bj_net_uring_linux::send(std::span<unsigned char> data)
+{
+    U2_PROBE3(bj, send, 0, data.data(), data.size());
+    for (auto& [_, endpoint] : endpoints)
+        transmit(endpoint, data);
+}
+
+void Bj_net_uring_linux::send_on_interface(int interface_id, std::span<unsigned char> data)
+{
+    for (auto& [_, endpoint] : endpoints) {
+        if (endpoint.interface_id != interface_id)
+            continue;
+        U2_PROBE3(bj, send, endpoint.interface_id, data.data(), data.size());
+        transmit(endpoint, data);
+    }
+}
+
+bool Bj_net_uring_linux::is_reply_thread_safe() const
+{
+    return true;
+}
+
+std::map<int, Bj_net_rx_stats> Bj_net_uring_linux::get_rx_stats()
+{
+    std::map<int, Bj_net_rx_stats> stats;
+    exec.invoke_sync([&]() {
+        for (auto& [_, endpoint] : endpoints) {
+            stats[endpoint.interface_id] = endpoint.rx_instrumentation.get_stats();
+            stats[endpoint.interface_id].filtered = query_filter;
+        }
+    });
+    return stats;
+}
+
+void Bj_net_uring_linux::update(const Bj_net_link_map& links)
+{
+    if (log_level >= 1) {
+        std::cout << "links:\n";
+        for (auto& [index, link] : links) {
+            std::cout << "  interface: index=" << index << " name=" << link.name << (link.is_usable() ? "" : " (unused)") << "\n";
+        }
+    }
+
+    // close the endpoints of the interfaces that disappeared or changed, update the ones whose addresses only changed
+
+    std::vector<uint32_t> closing;
+    for (auto& [token, endpoint] : endpoints) {
+        auto it = links.find(endpoint.link.index);
+        if (it == links.end() || !it->second.is_usable() || !endpoint.link.is_equivalent(it->second))
+            closing.push_back(token);
+        else if (!endpoint.link.has_same_addresses(it->second) && !update_endpoint(endpoint, it->second))
+            closing.push_back(token);
+    }
+    for (uint32_t token : closing)
+        close_endpoint(token);
+
+    // open the new ones
+
+    for (auto& [index, link] : links) {
+        if (!link.is_usable())
+            continue;
+        bool found = false;
+        for (auto& [_, endpoint] : endpoints) {
+            if (endpoint.link.index == index)
+                found = true;
+        }
+        if (!found)
+            open_endpoint(link);
+    }
+
+    if (!in_completion)
+        uring->submit();
+}
+
+void Bj_net_uring_linux::open_endpoint(const Bj_net_link& link)
+{
+    Bj_net_address address = link.get_ipv4_address();
+
+    int rx_socket = -1;
+    int tx_socket = -1;
+    try {
+        rx_socket = bj_net_linux::open_multicast_rx_socket(address, query_filter);
+        tx_socket = bj_net_linux::open_multicast_tx_socket(address, true);
+    } catch (Bj_net_open_error& error) {
+        // error while opening - this interface cannot be used
+        std::cout << link.name << " " << address.as_str() << " cannot be used (" << error.what() << ")\n";
+        if (rx_socket >= 0)
+            ::close(rx_socket);
+        return;
+    }
+
+    uint32_t token = ++endpoint_token_generator;
+    Net_endpoint& endpoint = endpoints[token];
+    endpoint.link = link;
+    endpoint.interface_index = link.index;
+    endpoint.interface_id = ++interface_id_generator;
+    endpoint.rx_socket = rx_socket;
+    endpoint.tx_socket = tx_socket;
+    endpoint.reply = [this, &endpoint](std::span<unsigned char> data, const Bj_net_source& destination) {
+        U2_PROBE3(bj, reply, endpoint.interface_id, data.data(), data.size());
+        transmit(endpoint, data, destination);
+    };
+
+    Bj_net_mtu mtu = Bj_net_mtu::udp(Bj_net_protocol::ipv4, link.mtu);
+
+    if (rx_begin_handler)
+        rx_begin_handler(endpoint.interface_id, link.addresses, mtu);
+
+    arm_recv(token);
+}
+
+void Bj_net_uring_linux::close_endpoint(uint32_t token)
+{
+    auto it = endpoints.find(token);
+    if (it == endpoints.end())
+        return;
+
+    // the recv request keeps its own reference to the socket until it is canceled
+    struct io_uring_sqe *sqe = get_sqe();
+    if (sqe) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = user_data(request_recv, token);
+        sqe->user_data = user_data(request_cancel, token);
+    }
+
+    if (rx_end_handler)
+        rx_end_handler(it->second.interface_id);
+
+    ::close(it->second.rx_socket);
+    ::close(it->second.tx_socket);
+    endpoints.erase(it);
+}
+
+// false if the endpoint must be reopened instead
+bool Bj_net_uring_linux::update_endpoint(Net_endpoint& endpoint, const Bj_net_link& link)
+{
+    if (!rx_update_handler)
+        return false;
+
+    // the recv request and the membership stay, the tx socket is reconnected from the new address
+    if (link.get_ipv4_address() != endpoint.link.get_ipv4_address()) {
+        try {
+            bj_net_linux::set_multicast_tx_address(endpoint.tx_socket, link.get_ipv4_address(), true);
+        } catch (Bj_net_open_error& error) {
+            std::cout << link.name << " cannot be updated (" << error.what() << ")\n";
+            return false;
+        }
+    }
+    endpoint.link = link;
+    rx_update_handler(endpoint.interface_id, link.addresses);
+    return true;
+}
+
+void Bj_net_uring_linux::setup_uring()
+{
+    uring = std::make_unique<Bj_uring_linux>(sq_entry_count, cq_entry_count);
+
+    try {
+        // provided buffers for all the multishot receives
+        rx_ring_size = rx_buffer_count * sizeof(struct io_uring_buf);
+        void *ring = mmap(nullptr, rx_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED)
+            throw Bj_net_open_error("cannot allocate the buffer ring");
+        rx_ring = (struct io_uring_buf_ring *)ring;
+        rx_ring->tail = 0;
+        uring->register_buf_ring(rx_ring, rx_buffer_count, rx_buffer_group);
+
+        rx_buffers = std::make_unique<unsigned char[]>(rx_buffer_count * rx_buffer_size);
+        for (unsigned i = 0; i < rx_buffer_count; i++)
+            recycle_rx_buffer((uint16_t)i);
+
+        // buffers hold the header, the source address, the control data and the datagram
+        memset(&rx_msghdr, 0, sizeof(rx_msghdr));
+        rx_msghdr.msg_namelen = sizeof(struct sockaddr_in);
+        rx_msghdr.msg_controllen = bj_net_linux::rx_control_size;
+
+        // registered buffers for the outgoing messages
+        tx_buffers = std::make_unique<unsigned char[]>(tx_buffer_count * tx_buffer_size);
+        struct iovec iov = { .iov_base = tx_buffers.get(), .iov_len = tx_buffer_count * tx_buffer_size };
+        try {
+            uring->register_buffers(&iov, 1);
+            fixed_tx_buffers = true;
+        } catch (Bj_net_open_error& error) {
+            // typically RLIMIT_MEMLOCK: the same buffers are used, without registration
+            fixed_tx_buffers = false;
+            if (log_level >= 1)
+                std::cout << error.what() << ", sending from unregistered buffers\n";
+        }
+        free_tx_buffers.clear();
+        armed_recv_count = 0;
+        for (unsigned i = 0; i < tx_buffer_count; i++)
+            free_tx_buffers.push_back((uint16_t)i);
+
+        uring_watch = exec.watch(uring->get_fd(), [this]() {
+            handle_completions();
+        });
+    } catch (...) {
+        release_uring();
+        throw;
+    }
+}
+
+void Bj_net_uring_linux::release_uring()
+{
+    if (uring_watch)
+        exec.unwatch(uring_watch);
+    uring_watch = 0;
+
+    /*
+     * The ring is torn down asynchronously by the kernel, and the buffers are
+     * user memory: they may only be freed once no request uses them anymore,
+     * see drain_uring(). The registrations are dropped first, so that nothing
+     * new can pick them up while the ring goes away.
+     */
+    if (uring) {
+        uring->unregister_buf_ring(rx_buffer_group);
+        uring->unregister_buffers();
+    }
+    uring.reset();
+
+    if (rx_ring)
+        munmap(rx_ring, rx_ring_size);
+    rx_ring = nullptr;
+    rx_buffers.reset();
+    tx_buffers.reset();
+    free_tx_buffers.clear();
+}
+
+/*
+ * Submit the cancellations and reap completions until the kernel is done
+ * with the buffers: every recv request has delivered its final completion,
+ * the one without IORING_CQE_F_MORE, and every write has completed. False
+ * if the ring fails before.
+ */
+bool Bj_net_uring_linux::drain_uring()
+{
+    while (armed_recv_count > 0 || free_tx_buffers.size() < tx_buffer_count) {
+        if (uring->submit_and_wait() < 0)
+            return false;
+        handle_completions();
+    }
+    return true;
+}
+
+struct io_uring_sqe *Bj_net_uring_linux::get_sqe()
+{
+    struct io_uring_sqe *sqe = uring->get_sqe();
+    if (!sqe) {
+        // queue full: hand the prepared entries to the kernel now
+        uring->submit();
+        sqe = uring->get_sqe();
+    }
+    return sqe;
+}
+
+void Bj_net_uring_linux::arm_recv(uint32_t token)
+{
+    auto it = endpoints.find(token);
+    if (it == endpoints.end())
+        return;
+
+    struct io_uring_sqe *sqe = get_sqe();
+    if (!sqe)
+        return; // only if the kernel refuses the submissions, nothing better can be done
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = it->second.rx_socket;
+    sqe->addr = (uint64_t)(uintptr_t)&rx_msghdr;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = rx_buffer_group;
+    sqe->user_data = user_data(request_recv, token);
+    armed_recv_count++;
+}
+
+void Bj_net_uring_linux::recycle_rx_buffer(uint16_t buffer_id)
+{
+    unsigned short tail = rx_ring->tail;
+    // the ring entries overlay the header; bufs[] cannot be used because, in C++,
+    // the uapi flexible array wrapper shifts it by 8 bytes
+    struct io_uring_buf *buf = (struct io_uring_buf *)rx_ring + (tail & (rx_buffer_count - 1));
+    buf->addr = (uint64_t)(uintptr_t)(rx_buffers.get() + buffer_id * rx_buffer_size);
+    buf->len = (uint32_t)rx_buffer_size;
+    buf->bid = buffer_id;
+    __atomic_store_n(&rx_ring->tail, (unsigned short)(tail + 1), __ATOMIC_RELEASE);
+}
+
+void Bj_net_uring_linux::transmit(const Net_endpoint& endpoint, std::span<unsigned char> data, const Bj_net_source& destination)
+{
+    // unicast replies are rare, they do not use the ring; sendto() overrides the group the socket is connected to
+    if (destination.is_defined()) {
+        struct sockaddr_storage addr;
+        socklen_t addr_size = bj_net_linux::sockaddr_of(destination, endpoint.interface_index, addr);
+        sendto(endpoint.tx_socket, data.data(), data.size(), 0, (struct sockaddr *)&addr, addr_size);
+        return;
+    }
+
+    // the ring belongs to the executor thread
+    if (!exec.is_current()) {
+        ::send(endpoint.tx_socket, data.data(), data.size(), 0);
+        return;
+    }
+
+    struct io_uring_sqe *sqe = nullptr;
+    if (data.size() <= tx_buffer_size && !free_tx_buffers.empty())
+        sqe = get_sqe();
+
+    // no room left: fall back to a plain system call
+    if (!sqe) {
+        ::send(endpoint.tx_socket, data.data(), data.size(), 0);
+        return;
+    }
+
+    uint16_t index = free_tx_buffers.back();
+    free_tx_buffers.pop_back();
+    unsigned char *buffer = tx_buffers.get() + index * tx_buffer_size;
+    memcpy(buffer, data.data(), data.size());
+
+    // the socket is connected to the group, and a socket only accepts offset 0
+    sqe->opcode = fixed_tx_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_SEND;
+    sqe->fd = endpoint.tx_socket;
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = (uint32_t)data.size();
+    sqe->off = 0;
+    sqe->buf_index = 0;
+    sqe->user_data = user_data(request_write, index);
+
+    if (!in_completion)
+        uring->submit();
+}
+
+void Bj_net_uring_linux::handle_completions()
+{
+    in_completion = true;
+
+    const struct io_uring_cqe *cqe;
+    while ((cqe = uring->peek_cqe()) != nullptr) {
+        uint64_t kind = cqe->user_data >> 32;
+        uint32_t value = (uint32_t)cqe->user_data;
+        int32_t res = cqe->res;
+        uint32_t flags = cqe->flags;
+        uring->advance_cq();
+
+        switch (kind) {
+            case request_recv: {
+                auto it = endpoints.find(value);
+                if (flags & IORING_CQE_F_BUFFER) {
+                    uint16_t buffer_id = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+                    unsigned char *buffer = rx_buffers.get() + buffer_id * rx_buffer_size;
+                    auto out = (const struct io_uring_recvmsg_out *)buffer;
+                    size_t offset = sizeof(*out) + rx_msghdr.msg_namelen + rx_msghdr.msg_controllen;
+                    if (it != endpoints.end() && res > 0 && (size_t)res >= offset) {
+                        struct msghdr control_hdr = {};
+                        control_hdr.msg_control = buffer + sizeof(*out) + rx_msghdr.msg_namelen;
+                        control_hdr.msg_controllen = out->controllen;
+                        it->second.rx_instrumentation.update(bj_net_linux::parse_rx_control(control_hdr));
+
+                        if (!(out->flags & MSG_TRUNC)) {
+                            size_t size = std::min((size_t)out->payloadlen, (size_t)res - offset);
+                            std::span data(buffer + offset, size);
+                            U2_PROBE3(bj, rx, it->second.interface_id, data.data(), data.size());
+                            struct sockaddr_storage name = {};
+                            memcpy(&name, buffer + sizeof(*out), std::min((size_t)out->namelen, (size_t)rx_msghdr.msg_namelen));
+                            if (size > 0 && rx_data_handler)
+                                rx_data_handler(it->second.interface_id, data, bj_net_linux::source_of(name), it->second.reply);
+                        }
+                    }
+                    recycle_rx_buffer(buffer_id);
+                }
+                // a multishot request ends on error, e.g. when no buffer was left, or when canceled
+                if (!(flags & IORING_CQE_F_MORE)) {
+                    armed_recv_count--;
+                    it = endpoints.find(value);
+                    if (it == endpoints.end())
+                        break;
+                    /*
+                     * Running out of buffers is transient, some were recycled
+                     * above. Any other error would end the new request at
+                     * once, again and again: the endpoint is closed instead.
+                     */
+                    if (res >= 0 || res == -ENOBUFS) {
+                        arm_recv(value);
+                    } else {
+                        std::cout << it->second.link.name << " cannot be used anymore (recv failed, errno=" << -res << ")\n";
+                        close_endpoint(value);
+                    }
+                }
+                break;
+            }
+            case request_write:
+                free_tx_buffers.push_back((uint16_t)value);
+                break;
+            default:
+                break;
+        }
+    }
+
+    in_completion = false;
+
+    // everything prepared for this batch, whatever the interface, in one system call
+    uring->submit();
+}
@@ -0,0 +1,132 @@
+//
+//  bj_net_uring_linux.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <sys/socket.h>
+#include <map>
+#include <memory>
+#include <vector>
+#include "bj_net.h"
+#include "bj_net_executor_linux.h"
+#include "bj_net_link_monitor_linux.h"
+#include "bj_net_socket_linux.h"
+#include "bj_uring_linux.h"
+
+/**
+ * Bj_net over all the multicast capable interfaces of the host, like
+ * Bj_net_group_linux, but with all the I/O going through a single io_uring.
+ *
+ * Each interface has a multishot recvmsg picking its buffers from a ring of
+ * provided buffers shared by all interfaces, so that receiving costs no
+ * system call. Outgoing messages are copied to registered buffers and
+ * written with IORING_OP_WRITE_FIXED on sockets connected to the group
+ * (IORING_OP_SEND if the registration is refused, e.g. by RLIMIT_MEMLOCK).
+ * All the submissions made while handling a batch of completions, whatever
+ * the interface, go to the kernel with a single io_uring_enter(), and the
+ * executor wakes up once per batch rather than once per socket.
+ *
+ * `open()` throws Bj_net_open_error when io_uring is not available.
+ */
+class Bj_net_uring_linux : public Bj_net {
+public:
+    static constexpr unsigned rx_buffer_count = 256;  // power of 2
+    static constexpr unsigned tx_buffer_count = 256;
+
+    Bj_net_uring_linux();
+    ~Bj_net_uring_linux();
+
+    Bj_net_uring_linux(const Bj_net_uring_linux&) = delete;
+    Bj_net_uring_linux& operator= (const Bj_net_uring_linux&) = delete;
+
+    // must be called before opening; enabled by default, see bj_net_linux::attach_query_filter()
+    void set_query_filter(bool enabled);
+
+    const Bj_net_executor& executor() const override;
+    void set_rx_begin_handler(Bj_net_rx_begin_handler rx_begin_handler) override;
+    void set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler) override;
+    void set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler) override;
+    void set_rx_update_handler(Bj_net_rx_update_handler rx_update_handler) override;
+    void set_log_level(int log_level) override;
+    void open() override;
+    void close(std::function<void()> completion) override;
+    void send(std::span<unsigned char> data) override;
+    void send_on_interface(int interface_id, std::span<unsigned char> data) override;
+    bool is_reply_thread_safe() const override;
+    std::map<int, Bj_net_rx_stats> get_rx_stats() override;
+
+private:
+    struct Net_endpoint {
+        Bj_net_link link; // updated on the executor only
+        int interface_index; // of the link, constant: read by the replies, on any thread
+        int interface_id;
+        int rx_socket;
+        int tx_socket;
+        Bj_net_reply reply;
+        bj_net_linux::Rx_instrumentation rx_instrumentation;
+    };
+
+    int log_level = 0;
+    bool opened = false;
+    bool query_filter = true;
+    Bj_net_executor_linux exec;
+    Bj_net_link_monitor_linux link_monitor;
+    int interface_id_generator = 0;
+
+    Bj_net_rx_begin_handler rx_begin_handler;
+    Bj_net_rx_data_handler rx_data_handler;
+    Bj_net_rx_end_handler rx_end_handler;
+    Bj_net_rx_update_handler rx_update_handler;
+
+    std::map<uint32_t, Net_endpoint> endpoints; // key = endpoint token, used in the user data of the requests
+    uint32_t endpoint_token_generator = 0;
+    std::function<void()> close_completion;
+
+    std::unique_ptr<Bj_uring_linux> uring;
+    int uring_watch = 0;
+    bool in_completion = false;
+
+    struct msghdr rx_msghdr;
+    struct io_uring_buf_ring *rx_ring = nullptr;
+    size_t rx_ring_size = 0;
+    std::unique_ptr<unsigned char[]> rx_buffers;
+    std::unique_ptr<unsigned char[]> tx_buffers;
+    bool fixed_tx_buffers = false;
+    std::vector<uint16_t> free_tx_buffers;
+    unsigned armed_recv_count = 0; // recv requests whose final completion has not arrived yet
+
+    void update(const Bj_net_link_map& links);
+    void open_endpoint(const Bj_net_link& link);
+    void close_endpoint(uint32_t token);
+    bool update_endpoint(Net_endpoint& endpoint, const Bj_net_link& link);
+    void setup_uring();
+    void release_uring();
+    bool drain_uring();
+    struct io_uring_sqe *get_sqe();
+    void arm_recv(uint32_t token);
+    void recycle_rx_buffer(uint16_t buffer_id);
+    void transmit(const Net_endpoint& endpoint, std::span<unsigned char> data, const Bj_net_source& destination = Bj_net_source());
+    void handle_completions();
+};
@@ -0,0 +1,489 @@
+//
+//  bj_net_xdp_linux.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <linux/bpf.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "bj_net_socket_linux.h"
+#include "bj_net_xdp_linux.h"
+#include "u2_probe.h"
+
+static const int rx_batch_max = 64;
+
+// Ethernet, IPv4 without options, UDP
+static const size_t eth_header_size = 14;
+static const size_t ip_header_size = 20;
+static const size_t udp_header_size = 8;
+static const size_t headers_size = eth_header_size + ip_header_size + udp_header_size;
+
+static const unsigned char group_mac_address[6] = { 0x01, 0x00, 0x5e, 0x00, 0x00, 0xfb };
+static const unsigned char group_ipv4_address[4] = { 224, 0, 0, 251 };
+static const uint16_t mdns_port = 5353;
+
+static int bpf(int cmd, union bpf_attr *attr)
+{
+    return (int)syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+static struct bpf_insn insn(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm)
+{
+    struct bpf_insn insn = {};
+    insn.code = code;
+    insn.dst_reg = dst;
+    insn.src_reg = src;
+    insn.off = off;
+    insn.imm = imm;
+    return insn;
+}
+
+/*
+ * XDP program redirecting the mDNS packets to the AF_XDP socket of the rx
+ * queue, found in `map_fd`, an XSKMAP. Loads are in host order, so the
+ * constants compared with packet fields are in network order.
+ *
+ *     r6 = ctx
+ *     r2 = ctx->data
+ *     r3 = ctx->data_end
+ *     if r2 + 42 > r3 goto pass                   // Ethernet + IPv4 + UDP headers
+ *     if eth->h_proto != ETH_P_IP goto pass
+ *     if ip->version_ihl != 0x45 goto pass        // no options
+ *     if ip->frag_off & 0x3fff goto pass          // no fragment
+ *     if ip->protocol != IPPROTO_UDP goto pass
+ *     if ip->daddr != 224.0.0.251 goto pass
+ *     if udp->dest != 5353 goto pass
+ *     return bpf_redirect_map(map, ctx->rx_queue_index, XDP_PASS)
+ * pass:
+ *     return XDP_PASS
+ */
+static std::vector<struct bpf_insn> mdns_redirect_program(int map_fd)
+{
+    std::vector<struct bpf_insn> program;
+    std::vector<size_t> pass_jumps;
+
+    auto load = [&](uint8_t size, int16_t offset) {
+        program.push_back(insn(BPF_LDX | BPF_MEM | size, BPF_REG_5, BPF_REG_2, offset, 0));
+    };
+    auto pass_unless_equal = [&](uint8_t jmp_class, int32_t value) {
+        pass_jumps.push_back(program.size());
+        program.push_back(insn(jmp_class | BPF_JNE | BPF_K, BPF_REG_5, 0, 0, value));
+    };
+
+    program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0));
+    program.push_back(insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_1, offsetof(struct xdp_md, data), 0));
+    program.push_back(insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_1, offsetof(struct xdp_md, data_end), 0));
+    program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0));
+    program.push_back(insn(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, headers_size));
+    pass_jumps.push_back(program.size());
+    program.push_back(insn(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0, 0));
+
+    load(BPF_H, 12);
+    pass_unless_equal(BPF_JMP, htons(0x0800));
+    load(BPF_B, eth_header_size + 0);
+    pass_unless_equal(BPF_JMP, 0x45);
+    load(BPF_H, eth_header_size + 6);
+    program.push_back(insn(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_5, 0, 0, htons(0x3fff)));
+    pass_unless_equal(BPF_JMP, 0);
+    load(BPF_B, eth_header_size + 9);
+    pass_unless_equal(BPF_JMP, IPPROTO_UDP);
+    load(BPF_W, eth_header_size + 16);
+    uint32_t group;
+    memcpy(&group, group_ipv4_address, sizeof(group));
+    pass_unless_equal(BPF_JMP32, (int32_t)group);
+    load(BPF_H, eth_header_size + ip_header_size + 2);
+    pass_unless_equal(BPF_JMP, htons(mdns_port));
+
+    program.push_back(insn(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, map_fd));
+    program.push_back(insn(0, 0, 0, 0, 0));
+    program.push_back(insn(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6, offsetof(struct xdp_md, rx_queue_index), 0));
+    program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS));
+    program.push_back(insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map));
+    program.push_back(insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+    size_t pass = program.size();
+    program.push_back(insn(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS));
+    program.push_back(insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+    for (size_t jump : pass_jumps)
+        program[jump].off = (int16_t)(pass - jump - 1);
+
+    return program;
+}
+
+static uint32_t checksum_add(uint32_t sum, const unsigned char *data, size_t size)
+{
+    for (size_t i = 0; i + 1 < size; i += 2)
+        sum += (uint32_t)(data[i] << 8 | data[i + 1]);
+    if (size & 1)
+        sum += (uint32_t)(data[size - 1] << 8);
+    return sum;
+}
+
+static uint16_t checksum_fold(uint32_t sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+static void put_u16(unsigned char *p, uint16_t value)
+{
+    p[0] = (unsigned char)(value >> 8);
+    p[1] = (unsigned char)value;
+}
+
+Bj_net_xdp_linux::Bj_net_xdp_linux(const std::string& interface_name, int queue_id, std::optional<Bj_net_executor_linux> executor) : exec(executor.has_value() ? executor.value() : Bj_net_executor_linux())
+{
+    this->interface_name = interface_name;
+    this->queue_id = queue_id;
+    this->reply_proxy = [this](std::span<unsigned char> data, const Bj_net_source& destination) {
+        U2_PROBE3(bj, reply, 0, data.data(), data.size());
+        transmit(data);
+    };
+}
+
+Bj_net_xdp_linux::~Bj_net_xdp_linux()
+{
+    assert(!opened);
+}
+
+const Bj_net_executor& Bj_net_xdp_linux::executor() const
+{
+    return exec;
+}
+
+void Bj_net_xdp_linux::set_rx_begin_handler(Bj_net_rx_begin_handler rx_begin_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_begin_handler = rx_begin_handler;
+}
+
+void Bj_net_xdp_linux::set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_data_handler = rx_data_handler;
+}
+
+void Bj_net_xdp_linux::set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_end_handler = rx_end_handler;
+}
+
+void Bj_net_xdp_linux::set_log_level(int log_level)
+{
+    this->log_level = log_level;
+}
+
+void Bj_net_xdp_linux::open()
+{
+    if (opened)
+        throw std::logic_error("already open");
+
+    // the rings must be used from the executor only
+    if (!exec.is_current()) {
+        exec.invoke_sync([this]() {
+            open();
+        });
+        return;
+    }
+
+    try {
+        open_xdp();
+    } catch (...) {
+        close_xdp();
+        throw;
+    }
+
+    opened = true;
+    rx_stats = {};
+
+    if (rx_begin_handler)
+        rx_begin_handler(0, { ipv4_address }, Bj_net_mtu::udp(Bj_net_protocol::ipv4, mtu));
+
+    rx_watch = exec.watch(xsk->get_fd(), [this]() {
+        handle_rx_data();
+    });
+}
+
+void Bj_net_xdp_linux::close(std::function<void()> completion)
+{
+    if (!opened)
+        throw std::logic_error("not open");
+
+    if (close_completion)
+        throw std::logic_error("already closing");
+
+    close_completion = completion;
+
+    // like the Apple backend, the completion is invoked on the executor
+    exec.invoke_async([this]() {
+        exec.unwatch(rx_watch);
+        rx_watch = 0;
+
+        if (rx_end_handler)
+            rx_end_handler(0);
+
+        close_xdp();
+        opened = false;
+
+        auto f = close_completion;
+        close_completion = nullptr;
+        f();
+    });
+}
+
+void Bj_net_xdp_linux::send(std::span<unsigned char> data)
+{
+    U2_PROBE3(bj, send, 0, data.data(), data.size());
+    transmit(data);
+}
+
+std::map<int, Bj_net_rx_stats> Bj_net_xdp_linux::get_rx_stats()
+{
+    std::map<int, Bj_net_rx_stats> stats;
+    exec.invoke_sync([&]() {
+        if (opened) {
+            rx_stats.drop_count = xsk->get_rx_drop_count();
+            stats[0] = rx_stats;
+        }
+    });
+    return stats;
+}
+
+void Bj_net_xdp_linux::open_xdp()
+{
+    interface_index = (int)if_nametoindex(interface_name.c_str());
+    if (interface_index == 0)
+        throw Bj_net_open_error("unknown interface " + interface_name);
+
+    // MAC and IPv4 addresses, the first IPv4 address is the source of the outgoing messages
+    bool has_mac_address = false;
+    ipv4_address = Bj_net_address();
+    struct ifaddrs *list;
+    if (getifaddrs(&list) != 0)
+        throw Bj_net_open_error("cannot list the interfaces, errno=" + std::to_string(errno));
+    for (struct ifaddrs *ifa = list; ifa; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || interface_name != ifa->ifa_name)
+            continue;
+        if (ifa->ifa_addr->sa_family == AF_PACKET) {
+            auto ll = (const struct sockaddr_ll *)ifa->ifa_addr;
+            if (ll->sll_halen == sizeof(mac_address)) {
+                memcpy(mac_address, ll->sll_addr, sizeof(mac_address));
+                has_mac_address = true;
+            }
+        } else if (ifa->ifa_addr->sa_family == AF_INET && ipv4_address.protocol == Bj_net_protocol::undefined) {
+            ipv4_address = Bj_net_address(Bj_net_protocol::ipv4);
+            memcpy(ipv4_address.ipv4.data(), &((const struct sockaddr_in *)ifa->ifa_addr)->sin_addr, 4);
+        }
+    }
+    freeifaddrs(list);
+    if (!has_mac_address)
+        throw Bj_net_open_error(interface_name + " is not an Ethernet interface");
+    if (ipv4_address.protocol != Bj_net_protocol::ipv4)
+        throw Bj_net_open_error(interface_name + " has no IPv4 address");
+
+    // the frames hold whole Ethernet packets
+    mtu = std::min(bj_net_linux::interface_mtu(ipv4_address), (size_t)Bj_xsk_linux::frame_size - eth_header_size);
+
+    // the membership makes the NIC accept the group MAC address, and the host report it with IGMP
+    membership_socket = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (membership_socket < 0)
+        throw Bj_net_open_error("cannot open socket, errno=" + std::to_string(errno));
+    bj_net_linux::join_multicast_group(membership_socket, interface_index);
+
+    xsk = std::make_unique<Bj_xsk_linux>(interface_index, queue_id);
+
+    union bpf_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(uint32_t);
+    attr.value_size = sizeof(uint32_t);
+    attr.max_entries = (uint32_t)queue_id + 1;
+    map_fd = bpf(BPF_MAP_CREATE, &attr);
+    if (map_fd < 0)
+        throw Bj_net_open_error("cannot create the XSKMAP, errno=" + std::to_string(errno));
+
+    uint32_t key = (uint32_t)queue_id;
+    uint32_t value = (uint32_t)xsk->get_fd();
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = map_fd;
+    attr.key = (uint64_t)(uintptr_t)&key;
+    attr.value = (uint64_t)(uintptr_t)&value;
+    if (bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0)
+        throw Bj_net_open_error("cannot insert the AF_XDP socket in the XSKMAP, errno=" + std::to_string(errno));
+
+    std::vector<struct bpf_insn> program = mdns_redirect_program(map_fd);
+    static const char license[] = "Dual MIT/GPL";
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.expected_attach_type = BPF_XDP;
+    attr.insns = (uint64_t)(uintptr_t)program.data();
+    attr.insn_cnt = (uint32_t)program.size();
+    attr.license = (uint64_t)(uintptr_t)license;
+    program_fd = bpf(BPF_PROG_LOAD, &attr);
+    if (program_fd < 0)
+        throw Bj_net_open_error("cannot load the XDP program, errno=" + std::to_string(errno));
+
+    // native mode if the driver supports it, generic mode otherwise; closing the link detaches the program
+    memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd = program_fd;
+    attr.link_create.target_ifindex = interface_index;
+    attr.link_create.attach_type = BPF_XDP;
+    link_fd = bpf(BPF_LINK_CREATE, &attr);
+    if (link_fd < 0)
+        throw Bj_net_open_error("cannot attach the XDP program to " + interface_name + ", errno=" + std::to_string(errno));
+}
+
+void Bj_net_xdp_linux::close_xdp()
+{
+    // detach first, so that the packets go back to the kernel stack
+    for (int *fd : { &link_fd, &program_fd, &map_fd }) {
+        if (*fd != -1)
+            ::close(*fd);
+        *fd = -1;
+    }
+    xsk.reset();
+    if (membership_socket != -1)
+        ::close(membership_socket);
+    membership_socket = -1;
+}
+
+void Bj_net_xdp_linux::transmit(std::span<unsigned char> data)
+{
+    // the rings belong to the executor thread
+    if (!exec.is_current()) {
+        exec.invoke_sync([&]() {
+            transmit(data);
+        });
+        return;
+    }
+
+    if (!xsk || headers_size + data.size() > Bj_xsk_linux::frame_size)
+        return;
+
+    uint64_t addr;
+    unsigned char *frame = xsk->alloc_tx_frame(addr);
+    if (!frame) {
+        // all frames in flight: give the queued ones to the kernel and retry once, otherwise drop
+        xsk->flush_tx();
+        frame = xsk->alloc_tx_frame(addr);
+        if (!frame)
+            return;
+    }
+
+    size_t udp_size = udp_header_size + data.size();
+    size_t ip_size = ip_header_size + udp_size;
+
+    unsigned char *eth = frame;
+    memcpy(eth, group_mac_address, 6);
+    memcpy(eth + 6, mac_address, 6);
+    put_u16(eth + 12, 0x0800);
+
+    unsigned char *ip = eth + eth_header_size;
+    ip[0] = 0x45;
+    ip[1] = 0;
+    put_u16(ip + 2, (uint16_t)ip_size);
+    put_u16(ip + 4, ip_id++);
+    put_u16(ip + 6, 0);
+    ip[8] = 255; // RFC 6762, section 11
+    ip[9] = IPPROTO_UDP;
+    put_u16(ip + 10, 0);
+    memcpy(ip + 12, ipv4_address.ipv4.data(), 4);
+    memcpy(ip + 16, group_ipv4_address, 4);
+    put_u16(ip + 10, checksum_fold(checksum_add(0, ip, ip_header_size)));
+
+    unsigned char *udp = ip + ip_header_size;
+    put_u16(udp, mdns_port);
+    put_u16(udp + 2, mdns_port);
+    put_u16(udp + 4, (uint16_t)udp_size);
+    put_u16(udp + 6, 0);
+    memcpy(udp + udp_header_size, data.data(), data.size());
+
+    // pseudo header: addresses, protocol and length
+    uint32_t sum = checksum_add(0, ip + 12, 8);
+    sum += IPPROTO_UDP + (uint32_t)udp_size;
+    uint16_t checksum = checksum_fold(checksum_add(sum, udp, udp_size));
+    put_u16(udp + 6, checksum ? checksum : 0xffff);
+
+    xsk->submit_tx(addr, (uint32_t)(eth_header_size + ip_size));
+
+    // within an rx batch, everything is flushed at the end
+    if (!in_rx_batch)
+        xsk->flush_tx();
+}
+
+void Bj_net_xdp_linux::handle_rx_data()
+{
+    /*
+     * The ring is drained by batches: the watch is level triggered, so
+     * whatever is left after `rx_batch_max` packets is handled at the next
+     * loop iteration, after the other sources.
+     */
+    in_rx_batch = true;
+    for (int i = 0; i < rx_batch_max; i++) {
+        const struct xdp_desc *desc = xsk->peek_rx();
+        if (!desc)
+            break;
+        uint64_t addr = desc->addr;
+        size_t size = desc->len;
+        xsk->advance_rx();
+
+        // the XDP program checked the headers, only the lengths are left
+        unsigned char *packet = xsk->frame(addr);
+        size_t udp_size = packet[eth_header_size + ip_header_size + 4] << 8 | packet[eth_header_size + ip_header_size + 5];
+        if (udp_size > udp_header_size && size >= eth_header_size + ip_header_size + udp_size) {
+            std::span data(packet + headers_size, udp_size - udp_header_size);
+            U2_PROBE3(bj, rx, 0, data.data(), data.size());
+            if (rx_data_handler)
+                rx_data_handler(0, data, Bj_net_source(), reply_proxy);
+        }
+
+        // the handler is done with the packet, the frame goes back to the kernel
+        xsk->recycle(addr);
+    }
+    in_rx_batch = false;
+
+    xsk->flush_tx();
+}
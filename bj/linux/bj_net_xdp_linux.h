@@ -0,0 +1,109 @@
+//
+//  bj_net_xdp_linux.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+#include <memory>
+#include <optional>
+#include <string>
+#include "bj_net.h"
+#include "bj_net_executor_linux.h"
+#include "bj_xsk_linux.h"
+
+/**
+ * Bj_net over the IPv4 mDNS multicast group on a single interface, with the
+ * packets going through an AF_XDP socket rather than through the kernel
+ * network stack.
+ *
+ * When opening, an XDP program is attached to the interface. It redirects
+ * to the AF_XDP socket bound to `queue_id` the unfragmented IPv4/UDP packets
+ * sent to 224.0.0.251:5353, and lets everything else go to the kernel. The
+ * Ethernet, IPv4 and UDP headers are parsed and built here; outgoing
+ * messages are sent from the interface MAC and IPv4 addresses, with a TTL
+ * of 255. Everything goes to the group: the source given to the rx data
+ * handler is undefined, so that no unicast reply is requested.
+ *
+ * The interface is dedicated: while open, no other mDNS socket of the host
+ * receives anything from it. Only the packets of the given rx queue are
+ * seen, so a multiqueue NIC must steer the group traffic to that queue.
+ * The program is written directly in eBPF, without libbpf; loading it needs
+ * CAP_BPF and CAP_NET_ADMIN. Veth pairs support XDP, which makes it possible
+ * to try this backend in a network namespace.
+ *
+ * `open()` throws Bj_net_open_error when XDP or AF_XDP is not available.
+ */
+class Bj_net_xdp_linux : public Bj_net {
+public:
+    Bj_net_xdp_linux(const std::string& interface_name, int queue_id = 0, std::optional<Bj_net_executor_linux> executor = std::nullopt);
+    ~Bj_net_xdp_linux();
+
+    Bj_net_xdp_linux(const Bj_net_xdp_linux&) = delete;
+    Bj_net_xdp_linux& operator= (const Bj_net_xdp_linux&) = delete;
+
+    const Bj_net_executor& executor() const override;
+    void set_rx_begin_handler(Bj_net_rx_begin_handler rx_handler) override;
+    void set_rx_data_handler(Bj_net_rx_data_handler rx_handler) override;
+    void set_rx_end_handler(Bj_net_rx_end_handler rx_handler) override;
+    void set_log_level(int log_level) override;
+    void open() override;
+    void close(std::function<void()> completion) override;
+
+    void send(std::span<unsigned char> data) override;
+    std::map<int, Bj_net_rx_stats> get_rx_stats() override;
+
+private:
+    std::string interface_name;
+    int queue_id;
+    Bj_net_executor_linux exec;
+    int log_level = 0;
+
+    int interface_index = 0;
+    unsigned char mac_address[6];
+    Bj_net_address ipv4_address;
+    size_t mtu = 0;
+    uint16_t ip_id = 0;
+
+    std::unique_ptr<Bj_xsk_linux> xsk;
+    int map_fd = -1;
+    int program_fd = -1;
+    int link_fd = -1;
+    int membership_socket = -1;
+    int rx_watch = 0;
+    bool in_rx_batch = false;
+    Bj_net_rx_stats rx_stats;
+
+    bool opened = false;
+
+    Bj_net_rx_begin_handler rx_begin_handler;
+    Bj_net_rx_data_handler rx_data_handler;
+    Bj_net_rx_end_handler rx_end_handler;
+    Bj_net_reply reply_proxy;
+
+    std::function<void()> close_completion;
+
+    void open_xdp();
+    void close_xdp();
+    void transmit(std::span<unsigned char> data);
+    void handle_rx_data();
+};
@@ -0,0 +1,193 @@
+//
+//  bj_uring_linux.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include "bj_net.h"
+#include "bj_uring_linux.h"
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+Bj_uring_linux::Bj_uring_linux(unsigned sq_entry_count, unsigned cq_entry_count)
+{
+    struct io_uring_params params = {};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+    params.cq_entries = cq_entry_count;
+
+    ring_fd = io_uring_setup(sq_entry_count, &params);
+    if (ring_fd < 0)
+        throw Bj_net_open_error("io_uring not available, errno=" + std::to_string(errno));
+
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        ::close(ring_fd);
+        throw Bj_net_open_error("io_uring too old");
+    }
+
+    // submission and completion rings share the same mapping
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring_size = std::max(sq_size, cq_size);
+    ring_ptr = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (ring_ptr == MAP_FAILED) {
+        ::close(ring_fd);
+        throw Bj_net_open_error("cannot map io_uring rings, errno=" + std::to_string(errno));
+    }
+
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sqes_ptr == MAP_FAILED) {
+        munmap(ring_ptr, ring_size);
+        ::close(ring_fd);
+        throw Bj_net_open_error("cannot map io_uring entries, errno=" + std::to_string(errno));
+    }
+    sqes = (struct io_uring_sqe *)sqes_ptr;
+
+    unsigned char *base = (unsigned char *)ring_ptr;
+    sq_head = (unsigned *)(base + params.sq_off.head);
+    sq_tail = (unsigned *)(base + params.sq_off.tail);
+    sq_mask = *(unsigned *)(base + params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+    cq_head = (unsigned *)(base + params.cq_off.head);
+    cq_tail = (unsigned *)(base + params.cq_off.tail);
+    cq_mask = *(unsigned *)(base + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)(base + params.cq_off.cqes);
+
+    // entries are always used in order, the indirection array is the identity
+    unsigned *sq_array = (unsigned *)(base + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries; i++)
+        sq_array[i] = i;
+
+    sqe_tail = *sq_tail;
+}
+
+Bj_uring_linux::~Bj_uring_linux()
+{
+    munmap(sqes, sqes_size);
+    munmap(ring_ptr, ring_size);
+    ::close(ring_fd);
+}
+
+struct io_uring_sqe *Bj_uring_linux::get_sqe()
+{
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (sqe_tail - head >= sq_entries)
+        return nullptr;
+
+    struct io_uring_sqe *sqe = &sqes[sqe_tail & sq_mask];
+    sqe_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int Bj_uring_linux::submit()
+{
+    unsigned to_submit = sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+    if (to_submit == 0)
+        return 0;
+
+    for (;;) {
+        int rv = io_uring_enter(ring_fd, to_submit, 0, 0);
+        if (rv >= 0)
+            return rv;
+        if (errno != EINTR)
+            return -errno; // the entries are left in the queue, the next call submits them
+    }
+}
+
+int Bj_uring_linux::submit_and_wait()
+{
+    unsigned to_submit = sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+
+    for (;;) {
+        int rv = io_uring_enter(ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS);
+        if (rv >= 0)
+            return 0;
+        if (errno != EINTR)
+            return -errno;
+        to_submit = sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    }
+}
+
+const struct io_uring_cqe *Bj_uring_linux::peek_cqe()
+{
+    unsigned head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+        return nullptr;
+    return &cqes[head & cq_mask];
+}
+
+void Bj_uring_linux::advance_cq(unsigned count)
+{
+    __atomic_store_n(cq_head, *cq_head + count, __ATOMIC_RELEASE);
+}
+
+void Bj_uring_linux::register_buffers(const struct iovec *iovecs, unsigned count)
+{
+    if (io_uring_register(ring_fd, IORING_REGISTER_BUFFERS, iovecs, count) < 0)
+        throw Bj_net_open_error("cannot register io_uring buffers, errno=" + std::to_string(errno));
+}
+
+void Bj_uring_linux::register_buf_ring(struct io_uring_buf_ring *ring, unsigned entries, uint16_t group_id)
+{
+    struct io_uring_buf_reg reg = {};
+    reg.ring_addr = (uint64_t)(uintptr_t)ring;
+    reg.ring_entries = entries;
+    reg.bgid = group_id;
+    if (io_uring_register(ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        throw Bj_net_open_error("cannot register io_uring buffer ring, errno=" + std::to_string(errno));
+}
+
+void Bj_uring_linux::unregister_buffers()
+{
+    io_uring_register(ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+}
+
+void Bj_uring_linux::unregister_buf_ring(uint16_t group_id)
+{
+    struct io_uring_buf_reg reg = {};
+    reg.bgid = group_id;
+    io_uring_register(ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+}
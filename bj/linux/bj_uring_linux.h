@@ -0,0 +1,95 @@
+//
+//  bj_uring_linux.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Minimal io_uring instance, on top of the raw system calls.
+ *
+ * Submission entries are prepared with `get_sqe()` and handed to the kernel
+ * all together by `submit()`. Completions are read with `peek_cqe()` and
+ * released with `advance_cq()`. The ring file descriptor is readable while
+ * completions are pending, so it can be watched by an event loop.
+ *
+ * Not thread safe: a ring is meant to be used from a single executor.
+ */
+class Bj_uring_linux {
+public:
+    // throws Bj_net_open_error if io_uring is not available
+    Bj_uring_linux(unsigned sq_entry_count, unsigned cq_entry_count);
+    ~Bj_uring_linux();
+
+    Bj_uring_linux(const Bj_uring_linux&) = delete;
+    Bj_uring_linux& operator= (const Bj_uring_linux&) = delete;
+
+    int get_fd() const {
+        return ring_fd;
+    }
+
+    // zeroed entry, or nullptr if the submission queue is full
+    struct io_uring_sqe *get_sqe();
+
+    // submit all prepared entries, return the number of entries consumed or -errno
+    int submit();
+
+    // submit all prepared entries and block until a completion is pending, return 0 or -errno
+    int submit_and_wait();
+
+    // oldest pending completion, or nullptr
+    const struct io_uring_cqe *peek_cqe();
+    void advance_cq(unsigned count = 1);
+
+    // throw Bj_net_open_error
+    void register_buffers(const struct iovec *iovecs, unsigned count);
+    void register_buf_ring(struct io_uring_buf_ring *ring, unsigned entries, uint16_t group_id);
+
+    // errors are ignored, e.g. if nothing was registered
+    void unregister_buffers();
+    void unregister_buf_ring(uint16_t group_id);
+
+private:
+    int ring_fd = -1;
+
+    void *ring_ptr = nullptr;
+    size_t ring_size = 0;
+    struct io_uring_sqe *sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail = 0; // entries handed out by get_sqe()
+
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+};
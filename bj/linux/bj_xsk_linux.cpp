@@ -0,0 +1,224 @@
+//
+//  bj_xsk_linux.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <string>
+#include "bj_net.h"
+#include "bj_xsk_linux.h"
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+static_assert((Bj_xsk_linux::ring_size & (Bj_xsk_linux::ring_size - 1)) == 0);
+static_assert(Bj_xsk_linux::frame_count / 2 <= Bj_xsk_linux::ring_size);
+
+static const uint32_t ring_mask = Bj_xsk_linux::ring_size - 1;
+
+Bj_xsk_linux::Bj_xsk_linux(int interface_index, int queue_id)
+{
+    fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw Bj_net_open_error("AF_XDP not available, errno=" + std::to_string(errno));
+
+    try {
+        umem_size = (size_t)frame_count * frame_size;
+        void *area = mmap(nullptr, umem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (area == MAP_FAILED)
+            throw Bj_net_open_error("cannot allocate the UMEM");
+        umem = (unsigned char *)area;
+
+        struct xdp_umem_reg reg = {};
+        reg.addr = (uint64_t)(uintptr_t)umem;
+        reg.len = umem_size;
+        reg.chunk_size = frame_size;
+        reg.headroom = 0;
+        if (setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) < 0)
+            throw Bj_net_open_error("cannot register the UMEM, errno=" + std::to_string(errno));
+
+        int size = ring_size;
+        if (setsockopt(fd, SOL_XDP, XDP_UMEM_FILL_RING, &size, sizeof(size)) < 0
+            || setsockopt(fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &size, sizeof(size)) < 0
+            || setsockopt(fd, SOL_XDP, XDP_RX_RING, &size, sizeof(size)) < 0
+            || setsockopt(fd, SOL_XDP, XDP_TX_RING, &size, sizeof(size)) < 0)
+            throw Bj_net_open_error("cannot create the AF_XDP rings, errno=" + std::to_string(errno));
+
+        struct xdp_mmap_offsets offsets = {};
+        socklen_t offsets_size = sizeof(offsets);
+        if (getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &offsets_size) < 0)
+            throw Bj_net_open_error("cannot get the AF_XDP ring offsets, errno=" + std::to_string(errno));
+
+        map_ring(fill_ring, offsets.fr, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING);
+        map_ring(completion_ring, offsets.cr, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING);
+        map_ring(rx_ring, offsets.rx, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING);
+        map_ring(tx_ring, offsets.tx, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING);
+
+        // first half of the frames for reception, second half for transmission
+        for (uint32_t i = 0; i < frame_count / 2; i++)
+            recycle((uint64_t)i * frame_size);
+        for (uint32_t i = frame_count / 2; i < frame_count; i++)
+            free_tx_frames.push_back((uint64_t)i * frame_size);
+
+        // zero-copy if the driver supports it, copy mode otherwise
+        struct sockaddr_xdp address = {};
+        address.sxdp_family = AF_XDP;
+        address.sxdp_flags = XDP_USE_NEED_WAKEUP;
+        address.sxdp_ifindex = interface_index;
+        address.sxdp_queue_id = queue_id;
+        if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+            throw Bj_net_open_error("cannot bind the AF_XDP socket, errno=" + std::to_string(errno));
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+Bj_xsk_linux::~Bj_xsk_linux()
+{
+    release();
+}
+
+void Bj_xsk_linux::release()
+{
+    for (Ring *ring : { &fill_ring, &completion_ring, &rx_ring, &tx_ring }) {
+        if (ring->map)
+            munmap(ring->map, ring->map_size);
+        ring->map = nullptr;
+    }
+    if (umem)
+        munmap(umem, umem_size);
+    umem = nullptr;
+    ::close(fd);
+}
+
+void Bj_xsk_linux::map_ring(Ring& ring, const struct xdp_ring_offset& offsets, size_t desc_size, uint64_t pgoff)
+{
+    ring.map_size = offsets.desc + ring_size * desc_size;
+    void *map = mmap(nullptr, ring.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, (off_t)pgoff);
+    if (map == MAP_FAILED)
+        throw Bj_net_open_error("cannot map an AF_XDP ring, errno=" + std::to_string(errno));
+    ring.map = map;
+
+    unsigned char *base = (unsigned char *)map;
+    ring.producer = (uint32_t *)(base + offsets.producer);
+    ring.consumer = (uint32_t *)(base + offsets.consumer);
+    ring.flags = (uint32_t *)(base + offsets.flags);
+    ring.descs = base + offsets.desc;
+
+    // rx and completion rings are consumed, fill and tx rings are produced
+    bool consumed = pgoff == XDP_PGOFF_RX_RING || pgoff == XDP_UMEM_PGOFF_COMPLETION_RING;
+    ring.local = consumed ? *ring.consumer : *ring.producer;
+}
+
+const struct xdp_desc *Bj_xsk_linux::peek_rx()
+{
+    if (rx_ring.local == __atomic_load_n(rx_ring.producer, __ATOMIC_ACQUIRE))
+        return nullptr;
+    return (const struct xdp_desc *)rx_ring.descs + (rx_ring.local & ring_mask);
+}
+
+void Bj_xsk_linux::advance_rx()
+{
+    rx_ring.local++;
+    __atomic_store_n(rx_ring.consumer, rx_ring.local, __ATOMIC_RELEASE);
+}
+
+void Bj_xsk_linux::recycle(uint64_t addr)
+{
+    // the fill ring holds all the rx frames, it cannot overflow
+    uint64_t *descs = (uint64_t *)fill_ring.descs;
+    descs[fill_ring.local & ring_mask] = addr & ~(uint64_t)(frame_size - 1);
+    fill_ring.local++;
+    __atomic_store_n(fill_ring.producer, fill_ring.local, __ATOMIC_RELEASE);
+}
+
+unsigned char *Bj_xsk_linux::alloc_tx_frame(uint64_t& addr)
+{
+    if (free_tx_frames.empty())
+        reclaim_tx_frames();
+    if (free_tx_frames.empty())
+        return nullptr;
+
+    addr = free_tx_frames.back();
+    free_tx_frames.pop_back();
+    return umem + addr;
+}
+
+void Bj_xsk_linux::submit_tx(uint64_t addr, uint32_t len)
+{
+    // the tx ring holds all the tx frames, it cannot overflow
+    struct xdp_desc *desc = (struct xdp_desc *)tx_ring.descs + (tx_ring.local & ring_mask);
+    desc->addr = addr;
+    desc->len = len;
+    desc->options = 0;
+    tx_ring.local++;
+    tx_pending = true;
+}
+
+void Bj_xsk_linux::flush_tx()
+{
+    if (tx_pending) {
+        __atomic_store_n(tx_ring.producer, tx_ring.local, __ATOMIC_RELEASE);
+        tx_pending = false;
+    }
+
+    // in copy mode, the frames are only sent from the system call; a failed
+    // wakeup (EAGAIN, ENOBUFS...) leaves them in the ring for the next one
+    if (tx_ring.local != __atomic_load_n(tx_ring.consumer, __ATOMIC_ACQUIRE)
+        && (__atomic_load_n(tx_ring.flags, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP))
+        sendto(fd, nullptr, 0, MSG_DONTWAIT, nullptr, 0);
+
+    reclaim_tx_frames();
+}
+
+uint64_t Bj_xsk_linux::get_rx_drop_count() const
+{
+    struct xdp_statistics stats = {};
+    socklen_t size = sizeof(stats);
+    if (getsockopt(fd, SOL_XDP, XDP_STATISTICS, &stats, &size) < 0)
+        return 0;
+    return stats.rx_dropped + stats.rx_ring_full + stats.rx_fill_ring_empty_descs;
+}
+
+void Bj_xsk_linux::reclaim_tx_frames()
+{
+    uint32_t producer = __atomic_load_n(completion_ring.producer, __ATOMIC_ACQUIRE);
+    if (completion_ring.local == producer)
+        return;
+
+    const uint64_t *descs = (const uint64_t *)completion_ring.descs;
+    while (completion_ring.local != producer) {
+        free_tx_frames.push_back(descs[completion_ring.local & ring_mask]);
+        completion_ring.local++;
+    }
+    __atomic_store_n(completion_ring.consumer, completion_ring.local, __ATOMIC_RELEASE);
+}
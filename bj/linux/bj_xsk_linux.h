@@ -0,0 +1,110 @@
+//
+//  bj_xsk_linux.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+#include <linux/if_xdp.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * AF_XDP socket bound to one queue of an interface, with its UMEM and its
+ * four rings, on top of the raw system calls.
+ *
+ * The UMEM is split in `frame_count` frames of `frame_size` bytes. Half of
+ * them are lent to the kernel through the fill ring and come back with the
+ * received packets; once handled, a packet goes back to the fill ring with
+ * `recycle()`. The other half is the pool of tx frames: `alloc_tx_frame()`
+ * hands one out, `submit_tx()` queues it and `flush_tx()` publishes the
+ * queued frames and wakes the kernel up if needed. Frames come back to the
+ * pool through the completion ring.
+ *
+ * The socket is readable while received packets are pending, so it can be
+ * watched by an event loop. Nothing reaches the socket until an XDP program
+ * redirects packets to it through an XSKMAP.
+ *
+ * Not thread safe: a socket is meant to be used from a single executor.
+ */
+class Bj_xsk_linux {
+public:
+    static constexpr uint32_t frame_size = 4096;
+    static constexpr uint32_t frame_count = 2048;
+    static constexpr uint32_t ring_size = 1024; // power of 2, fill and tx rings hold frame_count / 2
+
+    // throws Bj_net_open_error if AF_XDP is not available
+    Bj_xsk_linux(int interface_index, int queue_id);
+    ~Bj_xsk_linux();
+
+    Bj_xsk_linux(const Bj_xsk_linux&) = delete;
+    Bj_xsk_linux& operator= (const Bj_xsk_linux&) = delete;
+
+    int get_fd() const {
+        return fd;
+    }
+
+    unsigned char *frame(uint64_t addr) {
+        return umem + addr;
+    }
+
+    // oldest received packet, or nullptr
+    const struct xdp_desc *peek_rx();
+    void advance_rx();
+
+    // give back to the kernel the frame holding a received packet
+    void recycle(uint64_t addr);
+
+    // frame of frame_size bytes, or nullptr if all are in flight
+    unsigned char *alloc_tx_frame(uint64_t& addr);
+    void submit_tx(uint64_t addr, uint32_t len);
+    void flush_tx();
+
+    // packets the kernel could not queue to the socket, e.g. because the rx ring was full
+    uint64_t get_rx_drop_count() const;
+
+private:
+    struct Ring {
+        uint32_t *producer;
+        uint32_t *consumer;
+        uint32_t *flags;
+        void *descs;
+        void *map = nullptr;
+        size_t map_size = 0;
+        uint32_t local; // local producer or consumer, published with a release store
+    };
+
+    int fd = -1;
+    unsigned char *umem = nullptr;
+    size_t umem_size = 0;
+    Ring fill_ring;
+    Ring completion_ring;
+    Ring rx_ring;
+    Ring tx_ring;
+    std::vector<uint64_t> free_tx_frames;
+    bool tx_pending = false;
+
+    void release();
+    void map_ring(Ring& ring, const struct xdp_ring_offset& offsets, size_t desc_size, uint64_t pgoff);
+    void reclaim_tx_frames();
+};
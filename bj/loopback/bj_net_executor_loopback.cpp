@@ -0,0 +1,107 @@
+//
+//  bj_net_executor_loopback.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#include <exception>
+#include "bj_net_executor_loopback.h"
+
+Bj_net_executor_loopback::Bj_net_executor_loopback()
+{
+    thread = std::thread(&Bj_net_executor_loopback::run, this);
+}
+
+Bj_net_executor_loopback::~Bj_net_executor_loopback()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        cv.notify_one();
+    }
+    thread.join();
+}
+
+void Bj_net_executor_loopback::invoke_async(std::function<void()> handler) const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    queue.push_back(std::move(handler));
+    cv.notify_one();
+}
+
+void Bj_net_executor_loopback::invoke_sync(std::function<void()> handler) const
+{
+    if (is_current()) {
+        handler();
+        return;
+    }
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    std::exception_ptr exception;
+
+    invoke_async([&]() {
+        try {
+            handler();
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done = true;
+        done_cv.notify_one();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        while (!done) {
+            done_cv.wait(lock);
+        }
+    }
+
+    // exceptions are forwarded to the caller
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+bool Bj_net_executor_loopback::is_current() const
+{
+    return std::this_thread::get_id() == thread.get_id();
+}
+
+void Bj_net_executor_loopback::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        if (!queue.empty()) {
+            auto handler = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            handler();
+            lock.lock();
+        } else if (stopping) {
+            return;
+        } else {
+            cv.wait(lock);
+        }
+    }
+}
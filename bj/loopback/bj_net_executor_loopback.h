@@ -0,0 +1,60 @@
+//
+//  bj_net_executor_loopback.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "bj_net.h"
+
+/**
+ * Executor running its handlers in order on a dedicated thread.
+ */
+class Bj_net_executor_loopback : public Bj_net_executor {
+public:
+    Bj_net_executor_loopback();
+    ~Bj_net_executor_loopback();
+
+    Bj_net_executor_loopback(const Bj_net_executor_loopback&) = delete;
+    Bj_net_executor_loopback& operator= (const Bj_net_executor_loopback&) = delete;
+
+    void invoke_async(std::function<void()> handler) const override;
+
+    // run the handler on the executor thread and wait for its completion
+    void invoke_sync(std::function<void()> handler) const;
+
+    bool is_current() const;
+
+private:
+    mutable std::mutex mutex;
+    mutable std::condition_variable cv;
+    mutable std::deque<std::function<void()>> queue;
+    bool stopping = false;
+    std::thread thread;
+
+    void run();
+};
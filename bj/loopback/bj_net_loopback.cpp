@@ -0,0 +1,205 @@
+//
+//  bj_net_loopback.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#include <cassert>
+#include <iostream>
+#include "bj_net_loopback.h"
+#include "u2_probe.h"
+
+Bj_net_loopback::Bj_net_loopback()
+{
+}
+
+Bj_net_loopback::~Bj_net_loopback()
+{
+    assert(!opened);
+}
+
+const Bj_net_executor& Bj_net_loopback::executor() const
+{
+    return exec;
+}
+
+const Bj_net_executor_loopback& Bj_net_loopback::loopback_executor() const
+{
+    return exec;
+}
+
+void Bj_net_loopback::set_rx_begin_handler(Bj_net_rx_begin_handler rx_begin_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_begin_handler = rx_begin_handler;
+}
+
+void Bj_net_loopback::set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_data_handler = rx_data_handler;
+}
+
+void Bj_net_loopback::set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler)
+{
+    if (opened)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_end_handler = rx_end_handler;
+}
+
+void Bj_net_loopback::set_capture_handler(Bj_net_loopback_capture_handler capture_handler)
+{
+    if (opened)
+        throw std::logic_error("capture handler must be set before opening");
+
+    this->capture_handler = capture_handler;
+}
+
+void Bj_net_loopback::set_log_level(int log_level)
+{
+    this->log_level = log_level;
+}
+
+void Bj_net_loopback::open()
+{
+    assert(exec.is_current());
+
+    if (opened)
+        throw std::logic_error("already open");
+
+    opened = true;
+
+    for (auto& [interface_id, interface] : interfaces) {
+        if (rx_begin_handler)
+            rx_begin_handler(interface_id, interface.addresses, interface.mtu);
+    }
+}
+
+void Bj_net_loopback::close(std::function<void()> completion)
+{
+    exec.invoke_async([this, completion]() {
+        if (!opened) {
+            completion();
+            return;
+        }
+
+        for (auto& [interface_id, _] : interfaces) {
+            if (rx_end_handler)
+                rx_end_handler(interface_id);
+        }
+
+        opened = false;
+        completion();
+    });
+}
+
+void Bj_net_loopback::send(std::span<unsigned char> data)
+{
+    assert(exec.is_current());
+
+    for (auto& [interface_id, _] : interfaces) {
+        U2_PROBE3(bj, send, interface_id, data.data(), data.size());
+        if (capture_handler)
+            capture_handler(interface_id, Bj_net_loopback_direction::send, data);
+    }
+}
+
+bool Bj_net_loopback::is_reply_thread_safe() const
+{
+    return reply_thread_safe;
+}
+
+void Bj_net_loopback::set_reply_thread_safe(bool enabled)
+{
+    if (opened)
+        throw std::logic_error("the reply mode must be set before opening");
+
+    reply_thread_safe = enabled;
+}
+
+int Bj_net_loopback::add_interface(const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu)
+{
+    int interface_id = 0;
+    exec.invoke_sync([&]() {
+        interface_id = ++interface_id_generator;
+
+        Interface interface = {
+            .addresses = addresses,
+            .mtu = mtu,
+            .reply = [this, interface_id](std::span<unsigned char> data, const Bj_net_source& destination) {
+                U2_PROBE3(bj, reply, interface_id, data.data(), data.size());
+                auto direction = destination.is_defined() ? Bj_net_loopback_direction::unicast_reply : Bj_net_loopback_direction::reply;
+                if (capture_handler)
+                    capture_handler(interface_id, direction, data);
+            }
+        };
+        interfaces[interface_id] = interface;
+
+        if (log_level >= 1) {
+            std::cout << "loopback: add interface " << interface_id << "\n";
+            for (auto& address : addresses) {
+                std::cout << "   " << address.as_str() << "\n";
+            }
+        }
+
+        if (opened && rx_begin_handler)
+            rx_begin_handler(interface_id, addresses, mtu);
+    });
+    return interface_id;
+}
+
+void Bj_net_loopback::remove_interface(int interface_id)
+{
+    exec.invoke_sync([&]() {
+        if (!interfaces.contains(interface_id))
+            throw std::invalid_argument("unknown interface");
+
+        if (log_level >= 1)
+            std::cout << "loopback: remove interface " << interface_id << "\n";
+
+        if (opened && rx_end_handler)
+            rx_end_handler(interface_id);
+
+        interfaces.erase(interface_id);
+    });
+}
+
+void Bj_net_loopback::inject(int interface_id, std::span<unsigned char> data, const Bj_net_source& source)
+{
+    assert(exec.is_current());
+
+    if (!opened)
+        return;
+
+    auto it = interfaces.find(interface_id);
+    if (it == interfaces.end())
+        throw std::invalid_argument("unknown interface");
+
+    U2_PROBE3(bj, rx, interface_id, data.data(), data.size());
+    if (rx_data_handler)
+        rx_data_handler(interface_id, data, source, it->second.reply);
+}
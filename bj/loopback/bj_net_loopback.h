@@ -0,0 +1,100 @@
+//
+//  bj_net_loopback.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+#include <map>
+#include "bj_net.h"
+#include "bj_net_executor_loopback.h"
+
+enum class Bj_net_loopback_direction {
+    send,          // sent with Bj_net::send()
+    reply,         // sent with the reply callback given to the rx data handler, to the group
+    unicast_reply, // sent with the reply callback given to the rx data handler, to the source of the query
+};
+
+using Bj_net_loopback_capture_handler = std::function<void(int interface_id, Bj_net_loopback_direction direction, std::span<const unsigned char> data)>;
+
+/**
+ * In-process network without sockets.
+ * Packets are injected by the caller, with the source the rx data handler
+ * gets (undefined by default), and everything sent by the upper layer is
+ * passed to the capture handler. All handlers are
+ * invoked on the executor thread and `inject()` must be called from there
+ * too, typically inside
+ * `executor().invoke_sync()`.
+ */
+class Bj_net_loopback : public Bj_net {
+public:
+    static constexpr Bj_net_mtu default_mtu = {
+        .mtu = 1500,
+        .ip_header_size = 20,
+        .udp_header_size = 8
+    };
+
+    Bj_net_loopback();
+    ~Bj_net_loopback();
+
+    const Bj_net_executor& executor() const override;
+    void set_rx_begin_handler(Bj_net_rx_begin_handler rx_begin_handler) override;
+    void set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler) override;
+    void set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler) override;
+    void set_log_level(int log_level) override;
+    void open() override;
+    void close(std::function<void()> completion) override;
+    void send(std::span<unsigned char> data) override;
+    bool is_reply_thread_safe() const override;
+
+    // must be called before opening; the capture handler must then be thread safe, replies may come from any thread
+    void set_reply_thread_safe(bool enabled);
+
+    const Bj_net_executor_loopback& loopback_executor() const;
+    void set_capture_handler(Bj_net_loopback_capture_handler capture_handler);
+
+    // virtual interfaces can be added and removed at any time; return the interface id
+    int add_interface(const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu = default_mtu);
+    void remove_interface(int interface_id);
+
+    // must be invoked on the executor thread
+    void inject(int interface_id, std::span<unsigned char> data, const Bj_net_source& source = Bj_net_source());
+
+private:
+    struct Interface {
+        std::vector<Bj_net_address> addresses;
+        Bj_net_mtu mtu;
+        Bj_net_reply reply;
+    };
+
+    int log_level = 0;
+    bool opened = false;
+    bool reply_thread_safe = false;
+    Bj_net_executor_loopback exec;
+    int interface_id_generator = 0;
+    std::map<int, Interface> interfaces; // key = interface_id
+
+    Bj_net_rx_begin_handler rx_begin_handler;
+    Bj_net_rx_data_handler rx_data_handler;
+    Bj_net_rx_end_handler rx_end_handler;
+    Bj_net_loopback_capture_handler capture_handler;
+};
@@ -0,0 +1,126 @@
+//
+//  bj_net_sim.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <cassert>
+#include "bj_net_sim.h"
+
+Bj_net_sim::Bj_net_sim(Bj_sim_link& link, const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu)
+    : link(link), addresses(addresses), mtu(mtu)
+{
+    reply = [this](std::span<unsigned char> data, const Bj_net_source& destination) {
+        send(data);
+    };
+}
+
+Bj_net_sim::~Bj_net_sim()
+{
+    if (endpoint_id)
+        link.detach(endpoint_id);
+}
+
+const Bj_net_executor& Bj_net_sim::executor() const
+{
+    return link.get_sim().executor();
+}
+
+void Bj_net_sim::set_rx_begin_handler(Bj_net_rx_begin_handler rx_begin_handler)
+{
+    if (endpoint_id)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_begin_handler = rx_begin_handler;
+}
+
+void Bj_net_sim::set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler)
+{
+    if (endpoint_id)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_data_handler = rx_data_handler;
+}
+
+void Bj_net_sim::set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler)
+{
+    if (endpoint_id)
+        throw std::logic_error("rx handlers must be set before opening");
+
+    this->rx_end_handler = rx_end_handler;
+}
+
+void Bj_net_sim::set_log_level(int log_level)
+{
+}
+
+void Bj_net_sim::open()
+{
+    if (endpoint_id)
+        throw std::logic_error("already open");
+
+    endpoint_id = link.attach(*this);
+
+    if (rx_begin_handler)
+        rx_begin_handler(interface_id, addresses, mtu);
+}
+
+void Bj_net_sim::close(std::function<void()> completion)
+{
+    if (endpoint_id) {
+        link.detach(endpoint_id);
+        endpoint_id = 0;
+        if (rx_end_handler)
+            rx_end_handler(interface_id);
+    }
+    completion();
+}
+
+void Bj_net_sim::send(std::span<unsigned char> data)
+{
+    assert(endpoint_id);
+    link.transmit(endpoint_id, data);
+}
+
+void Bj_net_sim::receive(std::span<const unsigned char> data)
+{
+    if (!rx_data_handler)
+        return;
+
+    // the rx handler is allowed to modify the packet
+    rx_buf.assign(data.begin(), data.end());
+    rx_data_handler(interface_id, rx_buf, Bj_net_source(), reply);
+}
+
+void Bj_net_sim::set_addresses(const std::vector<Bj_net_address>& addresses)
+{
+    executor().invoke_async([this, addresses]() {
+        this->addresses = addresses;
+        if (!endpoint_id)
+            return;
+        if (rx_end_handler)
+            rx_end_handler(interface_id);
+        if (rx_begin_handler)
+            rx_begin_handler(interface_id, this->addresses, mtu);
+    });
+}
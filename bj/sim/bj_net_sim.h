@@ -0,0 +1,79 @@
+//
+//  bj_net_sim.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include "bj_net.h"
+#include "bj_sim.h"
+
+/**
+ * Network of a simulated host, with a single interface attached to a
+ * simulated link. Both send() and the reply callback transmit to the whole
+ * link, like a multicast socket. The link has no addresses: the source given
+ * to the rx data handler is undefined.
+ *
+ * Everything runs on the simulation thread. Since the simulation does not run
+ * while close() is called, close() completes synchronously: this allows
+ * Bj_server::stop() to be called between two Bj_sim::run_until().
+ */
+class Bj_net_sim : public Bj_net, public Bj_sim_endpoint {
+public:
+    static constexpr Bj_net_mtu default_mtu = {
+        .mtu = 1500,
+        .ip_header_size = 20,
+        .udp_header_size = 8
+    };
+
+    Bj_net_sim(Bj_sim_link& link, const std::vector<Bj_net_address>& addresses, Bj_net_mtu mtu = default_mtu);
+    ~Bj_net_sim();
+
+    const Bj_net_executor& executor() const override;
+    void set_rx_begin_handler(Bj_net_rx_begin_handler rx_begin_handler) override;
+    void set_rx_data_handler(Bj_net_rx_data_handler rx_data_handler) override;
+    void set_rx_end_handler(Bj_net_rx_end_handler rx_end_handler) override;
+    void set_log_level(int log_level) override;
+    void open() override;
+    void close(std::function<void()> completion) override;
+    void send(std::span<unsigned char> data) override;
+
+    void receive(std::span<const unsigned char> data) override;
+
+    // simulate an address change: the interface goes down and up again
+    void set_addresses(const std::vector<Bj_net_address>& addresses);
+
+private:
+    static constexpr int interface_id = 1;
+
+    Bj_sim_link& link;
+    std::vector<Bj_net_address> addresses;
+    Bj_net_mtu mtu;
+    int endpoint_id = 0; // 0 when closed
+    Bj_net_reply reply;
+    std::vector<unsigned char> rx_buf;
+
+    Bj_net_rx_begin_handler rx_begin_handler;
+    Bj_net_rx_data_handler rx_data_handler;
+    Bj_net_rx_end_handler rx_end_handler;
+};
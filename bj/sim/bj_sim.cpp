@@ -0,0 +1,126 @@
+//
+//  bj_sim.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include <memory>
+#include "bj_sim.h"
+
+void Bj_net_executor_sim::invoke_async(std::function<void()> handler) const
+{
+    sim.schedule(0, std::move(handler));
+}
+
+Bj_sim::Bj_sim(uint64_t seed) : rng(seed), exec(*this)
+{
+}
+
+bool Bj_sim::later(const Event& a, const Event& b)
+{
+    if (a.time != b.time)
+        return a.time > b.time;
+    return a.sequence > b.sequence;
+}
+
+void Bj_sim::schedule(uint64_t delay_ns, std::function<void()> event)
+{
+    events.push_back({ .time = time + delay_ns, .sequence = sequence++, .handler = std::move(event) });
+    std::push_heap(events.begin(), events.end(), later);
+}
+
+bool Bj_sim::pop(uint64_t time_limit)
+{
+    if (events.empty() || events.front().time > time_limit)
+        return false;
+
+    std::pop_heap(events.begin(), events.end(), later);
+    Event event = std::move(events.back());
+    events.pop_back();
+    time = event.time;
+    event.handler();
+    return true;
+}
+
+void Bj_sim::run_until(uint64_t time_ns)
+{
+    while (pop(time_ns)) {
+    }
+    time = std::max(time, time_ns);
+}
+
+void Bj_sim::run()
+{
+    while (pop(UINT64_MAX)) {
+    }
+}
+
+Bj_sim_link::Bj_sim_link(Bj_sim& sim, Bj_sim_link_params params) : sim(sim), params(params)
+{
+}
+
+int Bj_sim_link::attach(Bj_sim_endpoint& endpoint)
+{
+    int endpoint_id = ++endpoint_id_generator;
+    endpoints[endpoint_id] = &endpoint;
+    return endpoint_id;
+}
+
+void Bj_sim_link::detach(int endpoint_id)
+{
+    endpoints.erase(endpoint_id);
+}
+
+void Bj_sim_link::transmit(int endpoint_id, std::span<const unsigned char> data)
+{
+    stats.packet_count++;
+    stats.byte_count += data.size();
+    stats.airtime_ns += params.frame_overhead_ns + (uint64_t)((double)((data.size() + params.frame_overhead_bytes) * 8) * 1e9 / params.bitrate);
+    if (data.size() >= 4 && (data[2] & 0x80))
+        stats.response_packet_count++;
+    else
+        stats.query_packet_count++;
+
+    auto packet = std::make_shared<std::vector<unsigned char>>(data.begin(), data.end());
+    std::uniform_real_distribution<double> loss_distribution(0, 1);
+    std::uniform_int_distribution<uint64_t> jitter_distribution(0, params.jitter_ns);
+
+    for (auto& [receiver_id, _] : endpoints) {
+        if (receiver_id == endpoint_id)
+            continue;
+        if (params.loss > 0 && loss_distribution(sim.random()) < params.loss) {
+            stats.lost_count++;
+            continue;
+        }
+        uint64_t delay = params.latency_ns + (params.jitter_ns ? jitter_distribution(sim.random()) : 0);
+        sim.schedule(delay, [this, receiver_id, packet]() {
+            // the receiver may have left the link in the meantime
+            auto it = endpoints.find(receiver_id);
+            if (it == endpoints.end())
+                return;
+            stats.delivered_count++;
+            it->second->receive(*packet);
+        });
+    }
+}
@@ -0,0 +1,150 @@
+//
+//  bj_sim.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <span>
+#include <vector>
+#include "bj_net.h"
+
+class Bj_sim;
+
+/**
+ * Executor of the simulation: handlers are events scheduled at the current
+ * virtual time. They run on the thread calling Bj_sim::run_until().
+ */
+class Bj_net_executor_sim : public Bj_net_executor {
+public:
+    explicit Bj_net_executor_sim(Bj_sim& sim) : sim(sim) {}
+    void invoke_async(std::function<void()> handler) const override;
+
+private:
+    Bj_sim& sim;
+};
+
+/**
+ * Discrete event simulation with a virtual clock, in nanoseconds.
+ * Everything is single threaded and events scheduled at the same time run in
+ * scheduling order, so that a simulation with a given seed always gives the
+ * same result.
+ */
+class Bj_sim {
+public:
+    explicit Bj_sim(uint64_t seed = 1);
+
+    Bj_sim(const Bj_sim&) = delete;
+    Bj_sim& operator= (const Bj_sim&) = delete;
+
+    uint64_t now() const { return time; }
+    const Bj_net_executor_sim& executor() const { return exec; }
+    std::mt19937_64& random() { return rng; }
+
+    void schedule(uint64_t delay_ns, std::function<void()> event);
+
+    // run all events up to the given time, included, then set the clock to it
+    void run_until(uint64_t time_ns);
+
+    // run until there is no more event
+    void run();
+
+private:
+    struct Event {
+        uint64_t time;
+        uint64_t sequence;
+        std::function<void()> handler;
+    };
+
+    uint64_t time = 0;
+    uint64_t sequence = 0;
+    std::vector<Event> events; // heap, earliest first
+    std::mt19937_64 rng;
+    Bj_net_executor_sim exec;
+
+    static bool later(const Event& a, const Event& b);
+    bool pop(uint64_t time_limit);
+};
+
+struct Bj_sim_link_params {
+    uint64_t latency_ns = 1000000;
+    uint64_t jitter_ns = 0;              // added to the latency, uniformly distributed
+    double loss = 0;                     // probability that a receiver misses a packet
+
+    // airtime model: multicast frames are sent at a basic rate, without aggregation
+    double bitrate = 6e6;                // bits per second
+    size_t frame_overhead_bytes = 64;    // 802.11 MAC, LLC/SNAP, IPv4 and UDP headers
+    uint64_t frame_overhead_ns = 54000;  // DIFS and PLCP preamble
+};
+
+struct Bj_sim_link_stats {
+    uint64_t packet_count = 0;
+    uint64_t byte_count = 0;             // mDNS payload only
+    uint64_t airtime_ns = 0;
+    uint64_t query_packet_count = 0;
+    uint64_t response_packet_count = 0;
+    uint64_t delivered_count = 0;        // one per receiver
+    uint64_t lost_count = 0;             // one per receiver
+};
+
+class Bj_sim_endpoint {
+public:
+    virtual ~Bj_sim_endpoint() {}
+    virtual void receive(std::span<const unsigned char> data) = 0;
+};
+
+/**
+ * Shared multicast medium, such as a Wi-Fi network: each packet transmitted
+ * by an endpoint is delivered to all other endpoints, after the link latency
+ * and subject to loss. Contention is not modelled: transmissions never delay
+ * each other.
+ */
+class Bj_sim_link {
+public:
+    Bj_sim_link(Bj_sim& sim, Bj_sim_link_params params = {});
+
+    Bj_sim_link(const Bj_sim_link&) = delete;
+    Bj_sim_link& operator= (const Bj_sim_link&) = delete;
+
+    Bj_sim& get_sim() const { return sim; }
+
+    // return the endpoint id
+    int attach(Bj_sim_endpoint& endpoint);
+    void detach(int endpoint_id);
+
+    void transmit(int endpoint_id, std::span<const unsigned char> data);
+
+    const Bj_sim_link_stats& get_stats() const { return stats; }
+    void reset_stats() { stats = Bj_sim_link_stats(); }
+
+private:
+    Bj_sim& sim;
+    Bj_sim_link_params params;
+    Bj_sim_link_stats stats;
+    int endpoint_id_generator = 0;
+    std::map<int, Bj_sim_endpoint*> endpoints; // key = endpoint_id
+};
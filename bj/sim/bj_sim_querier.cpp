@@ -0,0 +1,162 @@
+//
+//  bj_sim_querier.cpp
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <algorithm>
+#include "bj_sim_querier.h"
+#include "bj_util.h"
+#include "u2_dns.h"
+#include "u2_mdns.h"
+
+static const size_t querier_msg_size = 1500 - 20 - 8;
+
+Bj_sim_querier::Bj_sim_querier(Bj_sim_link& link, std::string_view service_type, Bj_sim_querier_params params)
+    : link(link), service_type(bj_util::dns_name(service_type)), params(params)
+{
+}
+
+Bj_sim_querier::~Bj_sim_querier()
+{
+    stop();
+}
+
+void Bj_sim_querier::start()
+{
+    if (endpoint_id)
+        return;
+
+    endpoint_id = link.attach(*this);
+    generation++;
+    interval = params.first_interval_ns;
+
+    // RFC 6762 section 5.2: random delay of 20 to 120 ms before the first query
+    std::uniform_int_distribution<uint64_t> delay(20000000, 120000000);
+    schedule_query(delay(link.get_sim().random()));
+}
+
+void Bj_sim_querier::stop()
+{
+    if (!endpoint_id)
+        return;
+
+    link.detach(endpoint_id);
+    endpoint_id = 0;
+    generation++;
+}
+
+void Bj_sim_querier::schedule_query(uint64_t delay)
+{
+    link.get_sim().schedule(delay, [this, generation = this->generation]() {
+        if (generation != this->generation)
+            return;
+        send_query();
+        schedule_query(interval);
+        interval = std::min(interval * 2, params.max_interval_ns);
+    });
+}
+
+void Bj_sim_querier::send_query()
+{
+    uint64_t now = link.get_sim().now();
+
+    // answers with less than half of their ttl left are not known answers
+    std::vector<const std::pair<const std::string, Instance>*> known_answers;
+    if (params.known_answers) {
+        for (auto& instance : instances) {
+            if (instance.second.expiration > now && (instance.second.expiration - now) / 1000000000 >= (uint64_t)instance.second.ttl / 2)
+                known_answers.push_back(&instance);
+        }
+    }
+
+    size_t next = 0;
+    bool first = true;
+    while (first || next < known_answers.size()) {
+        unsigned char msg[querier_msg_size];
+
+        // build once without TC, and again with TC if not all known answers fit
+        for (int flags : { 0, (int)U2_DNS_MSG_FLAG_TC }) {
+            struct u2_dns_msg_builder builder;
+            u2_dns_msg_builder_init(&builder, msg, sizeof(msg), 0, flags);
+            if (first)
+                u2_dns_msg_builder_add_question(&builder, service_type.c_str(), U2_DNS_RR_TYPE_PTR, false);
+            u2_dns_msg_builder_set_category(&builder, U2_DNS_RR_CATEGORY_ANSWER);
+            size_t n = next;
+            while (n < known_answers.size()) {
+                auto& [name, instance] = *known_answers[n];
+                int ttl = (int)((instance.expiration - now) / 1000000000);
+                if (!u2_dns_msg_builder_add_rr_name(&builder, service_type.c_str(), U2_DNS_RR_TYPE_PTR, false, ttl, name.c_str()))
+                    break;
+                n++;
+            }
+            if (n == next && !first)
+                return; // known answer too big, cannot happen with valid names
+            if (n == known_answers.size() || flags) {
+                link.transmit(endpoint_id, std::span(msg, u2_dns_msg_builder_get_size(&builder)));
+                next = n;
+                break;
+            }
+        }
+        first = false;
+    }
+}
+
+void Bj_sim_querier::receive(std::span<const unsigned char> data)
+{
+    struct u2_dns_msg_reader reader;
+    if (u2_dns_msg_reader_init(&reader, data.data(), data.size()) < 0)
+        return;
+    if (!(u2_dns_msg_reader_get_flags(&reader) & U2_DNS_MSG_FLAG_QR))
+        return;
+
+    uint64_t now = link.get_sim().now();
+    int entry_count = u2_dns_msg_reader_get_entry_count(&reader);
+    for (int i = u2_dns_msg_reader_get_question_count(&reader); i < entry_count; i++) {
+        struct u2_dns_msg_entry entry;
+        if (u2_dns_msg_reader_get_entry(&reader, i, &entry) < 0)
+            return;
+        if (u2_dns_msg_entry_get_rr_type(&entry) != U2_DNS_RR_TYPE_PTR)
+            continue;
+
+        char name[256];
+        u2_dns_name_init(name, sizeof(name));
+        if (!u2_dns_name_append_compressed_name(name, sizeof(name), entry.data, entry.name_pos))
+            return;
+        if (u2_dns_name_compare(name, service_type.c_str()))
+            continue;
+
+        char instance_name[256];
+        u2_dns_name_init(instance_name, sizeof(instance_name));
+        if (!u2_dns_name_append_compressed_name(instance_name, sizeof(instance_name), entry.data, entry.rdata_pos))
+            return;
+
+        std::string key(instance_name, u2_dns_name_length(instance_name));
+        int ttl = u2_dns_msg_entry_get_rr_ttl(&entry);
+        if (ttl == 0) {
+            instances.erase(key);
+        } else {
+            instances[key] = { .ttl = ttl, .expiration = now + (uint64_t)ttl * 1000000000 };
+        }
+    }
+}
@@ -0,0 +1,79 @@
+//
+//  bj_sim_querier.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+#include <map>
+#include <string>
+#include "bj_sim.h"
+
+struct Bj_sim_querier_params {
+    uint64_t first_interval_ns = 1000000000;  // the interval doubles after each query
+    uint64_t max_interval_ns = 60000000000;
+    bool known_answers = true;                // include known answers in queries
+};
+
+/**
+ * Simulated mDNS browser, as described in RFC 6762 section 5.2: it sends
+ * PTR queries for a service type at exponentially increasing intervals,
+ * with the instances it already knows as known answers, and learns the
+ * instances from all PTR records it receives. Known answers that do not fit
+ * in one packet are sent in additional packets, with the TC bit set on all
+ * packets but the last one. The querier is attached to the link only
+ * between start() and stop(), like a host joining the network.
+ */
+class Bj_sim_querier : public Bj_sim_endpoint {
+public:
+    Bj_sim_querier(Bj_sim_link& link, std::string_view service_type, Bj_sim_querier_params params = {});
+    ~Bj_sim_querier();
+
+    Bj_sim_querier(const Bj_sim_querier&) = delete;
+    Bj_sim_querier& operator= (const Bj_sim_querier&) = delete;
+
+    void start();
+    void stop();
+
+    // number of instances currently known
+    size_t get_instance_count() const { return instances.size(); }
+
+    void receive(std::span<const unsigned char> data) override;
+
+private:
+    struct Instance {
+        int ttl;             // seconds
+        uint64_t expiration; // virtual time
+    };
+
+    Bj_sim_link& link;
+    std::string service_type; // u2 name format
+    Bj_sim_querier_params params;
+    int endpoint_id = 0;      // 0 when stopped
+    uint64_t generation = 0;  // incremented to cancel pending queries
+    uint64_t interval = 0;
+    std::map<std::string, Instance> instances; // key = instance name, u2 name format
+
+    void send_query();
+    void schedule_query(uint64_t delay);
+};
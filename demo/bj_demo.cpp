@@ -25,13 +25,19 @@
 
 #include "bj_demo.h"
 #include "bj_net.h"
+#ifdef __APPLE__
 #include "bj_net_group_apple.h"
+using Bj_net_group = Bj_net_group_apple;
+#else
+#include "bj_net_group_linux.h"
+using Bj_net_group = Bj_net_group_linux;
+#endif
 #include "bj_server.h"
 #include "bj_util.h"
 
 void bj_demo()
 {
-    Bj_net_group_apple net;
+    Bj_net_group net;
     net.set_log_level(1);
 
     Bj_server server("ServiceHost", net);
@@ -32,7 +32,13 @@
 #include "u2_dns_dump.h"
 #include "u2_mdns.h"
 #include "bj_static_server.h"
+#ifdef __APPLE__
 #include "bj_net_single_apple.h"
+using Bj_net_single = Bj_net_single_apple;
+#else
+#include "bj_net_single_linux.h"
+using Bj_net_single = Bj_net_single_linux;
+#endif
 #include "u2_dns_dump.h"
 
 #define _ENUM_SERVICE "\011_services\007_dns-sd\004_udp\005local\0"
@@ -194,7 +200,7 @@ void bj_static_demo()
     u2_dns_database_dump(&_database, 0);
     printf("\n");
 
-    Bj_net_single_apple net(Bj_net_address(Bj_net_protocol::ipv4), std::vector<Bj_net_address>(), true);
+    Bj_net_single net(Bj_net_address(Bj_net_protocol::ipv4), std::vector<Bj_net_address>(), true);
     net.set_log_level(1);
     
     Bj_static_server server(net, _database);
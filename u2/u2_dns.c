@@ -510,3 +510,31 @@ bool u2_dns_msg_builder_add_rr_a(struct u2_dns_msg_builder *builder, const char
     builder->size = i;
     return true;
 }
+
+bool u2_dns_msg_builder_add_rr_aaaa(struct u2_dns_msg_builder *builder, const char *name, bool cache_flush, int ttl, const uint8_t *addr)
+{
+    if (builder->counter_pos < 6)
+        u2_dns_msg_builder_set_category(builder, U2_DNS_RR_CATEGORY_ANSWER);
+
+    int count = u2_dns_msg_get_field_u16(builder->data, builder->counter_pos);
+
+    int name_len = u2_dns_name_length(name);
+    if (builder->size + name_len + 10 + 16 > builder->max)
+        return false;
+    u2_dns_msg_set_field_u16(builder->data, builder->counter_pos, count + 1);
+    int i = builder->size;
+    memcpy(builder->data + i, name, name_len);
+    i += name_len;
+    u2_dns_msg_set_field_u16(builder->data, i, U2_DNS_RR_TYPE_AAAA);
+    i += 2;
+    u2_dns_msg_set_field_u16(builder->data, i, cache_flush ? 0x8001 : 0x0001);
+    i += 2;
+    u2_dns_msg_set_field_u32(builder->data, i, ttl);
+    i += 4;
+    u2_dns_msg_set_field_u16(builder->data, i, 16);
+    i += 2;
+    memcpy(builder->data + i, addr, 16);
+    i += 16;
+    builder->size = i;
+    return true;
+}
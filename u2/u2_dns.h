@@ -26,6 +26,7 @@
 #ifndef _U2_DNS_H_
 #define _U2_DNS_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "u2_def.h"
@@ -38,6 +39,7 @@ U2_C_BEGIN
 enum u2_dns_msg_flas {
     U2_DNS_MSG_FLAG_QR = 0x8000,
     U2_DNS_MSG_FLAG_AA = 0x0400,
+    U2_DNS_MSG_FLAG_TC = 0x0200,
 };
 
 enum u2_dns_rr_type {
@@ -151,6 +153,7 @@ bool u2_dns_msg_builder_add_rr_name(struct u2_dns_msg_builder *builder, const ch
 bool u2_dns_msg_builder_add_rr_srv(struct u2_dns_msg_builder *builder, const char *name, bool cache_flush, int ttl, int priority, int weight, int port, const char *host_name);
 bool u2_dns_msg_builder_add_rr_single_domain_nsec(struct u2_dns_msg_builder *builder, const char *name, bool cache_flush, int ttl, u2_dns_type_mask_t type_mask);
 bool u2_dns_msg_builder_add_rr_a(struct u2_dns_msg_builder *builder, const char *name, bool cache_flush, int ttl, const uint8_t *addr);
+bool u2_dns_msg_builder_add_rr_aaaa(struct u2_dns_msg_builder *builder, const char *name, bool cache_flush, int ttl, const uint8_t *addr);
 
 
 /*** inline functions ***/
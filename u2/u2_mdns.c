@@ -28,21 +28,31 @@
 #include <string.h>
 #include "u2_base.h"
 #include "u2_mdns.h"
+#include "u2_probe.h"
 
 
-static bool _add_answer(struct u2_dns_msg_builder *builder, const struct u2_dns_record *record, bool tear_down)
+static bool _add_answer(struct u2_dns_msg_builder *builder, const struct u2_dns_record *record, const struct u2_mdns_emitter *emitter)
 {
-    int ttl = tear_down ? 0 : record->ttl;
+    int ttl = emitter->tear_down ? 0 : record->ttl;
+    bool cache_flush = record->cache_flush;
+
+    // RFC 6762, section 6.7: legacy resolvers do not know the cache-flush bit and must not cache for long
+    if (emitter->legacy_query) {
+        ttl = U2_MIN(ttl, 10);
+        cache_flush = false;
+    }
 
     switch (record->type) {
         case U2_DNS_RR_TYPE_A:
-            return u2_dns_msg_builder_add_rr_a(builder, record->domain->name, record->cache_flush, ttl, record->a.addr);
+            return u2_dns_msg_builder_add_rr_a(builder, record->domain->name, cache_flush, ttl, record->a.addr);
+        case U2_DNS_RR_TYPE_AAAA:
+            return u2_dns_msg_builder_add_rr_aaaa(builder, record->domain->name, cache_flush, ttl, record->aaaa.addr);
         case U2_DNS_RR_TYPE_TXT:
-            return u2_dns_msg_builder_add_rr_name(builder, record->domain->name, U2_DNS_RR_TYPE_TXT, record->cache_flush, ttl, record->txt.name);
+            return u2_dns_msg_builder_add_rr_name(builder, record->domain->name, U2_DNS_RR_TYPE_TXT, cache_flush, ttl, record->txt.name);
         case U2_DNS_RR_TYPE_SRV:
-            return u2_dns_msg_builder_add_rr_srv(builder, record->domain->name, record->cache_flush, ttl, 0, 0, record->srv.port, record->srv.name);
+            return u2_dns_msg_builder_add_rr_srv(builder, record->domain->name, cache_flush, ttl, 0, 0, record->srv.port, record->srv.name);
         case U2_DNS_RR_TYPE_PTR:
-            return u2_dns_msg_builder_add_rr_name(builder, record->domain->name, U2_DNS_RR_TYPE_PTR, record->cache_flush, ttl, record->ptr.name);
+            return u2_dns_msg_builder_add_rr_name(builder, record->domain->name, U2_DNS_RR_TYPE_PTR, cache_flush, ttl, record->ptr.name);
         case U2_DNS_RR_TYPE_NSEC: {
             // emit a nsec record which lists all record types available in this domain
             u2_dns_type_mask_t type_mask = 0;
@@ -55,7 +65,7 @@ static bool _add_answer(struct u2_dns_msg_builder *builder, const struct u2_dns_
                         U2_FATAL("unsupported record type %d in NSEC\n", record->type);
                 }
             }
-            return u2_dns_msg_builder_add_rr_single_domain_nsec(builder, record->domain->name, record->cache_flush, ttl, type_mask);
+            return u2_dns_msg_builder_add_rr_single_domain_nsec(builder, record->domain->name, cache_flush, ttl, type_mask);
         }
         default:
             return false;
@@ -82,6 +92,8 @@ static void _decode_questions(struct u2_mdns_query_proc *proc)
     const int record_max = U2_ARRAY_LEN(proc->record_list);
     proc->answer_record_count = 0;
     proc->additional_record_count = 0;
+    proc->batch_first_question = proc->question_index;
+    proc->batch_unicast_requested = true;
 
     for (;;) {
         if (proc->question_index >= proc->question_count)
@@ -99,12 +111,20 @@ static void _decode_questions(struct u2_mdns_query_proc *proc)
 
         int type = u2_dns_msg_entry_get_question_type(&entry);
         int klass = u2_dns_msg_entry_get_question_class(&entry);
+        if (!u2_dns_msg_entry_get_question_unicast_response(&entry))
+            proc->batch_unicast_requested = false;
+        char name[256];
         if (klass != 1 && klass != 255) {
+            if (proc->question_handler) {
+                u2_dns_name_init(name, 256);
+                if (u2_dns_name_append_compressed_name(name, 256, entry.data, entry.name_pos))
+                    proc->question_handler(proc->question_handler_context, name, type, klass, false);
+            }
+            proc->stats.question_count++;
             proc->question_index++;
             continue;
         }
 
-        char name[256];
         u2_dns_name_init(name, 256);
         bool valid_name = u2_dns_name_append_compressed_name(name, 256, entry.data, entry.name_pos);
         if (!valid_name) {
@@ -112,7 +132,8 @@ static void _decode_questions(struct u2_mdns_query_proc *proc)
             break;
         }
 
-        bool overflow = false;
+        // number of matching records that do not fit in the record list
+        int overflow = 0;
         int first_record = proc->answer_record_count;
         for (int d = 0; d < proc->database->domain_count; d++) {
             const struct u2_dns_domain *domain = proc->database->domain_list[d];
@@ -124,8 +145,8 @@ static void _decode_questions(struct u2_mdns_query_proc *proc)
                     if (record->type == type) {
                         found = true;
                         if (proc->answer_record_count >= record_max) {
-                            overflow = true;
-                            break;
+                            overflow++;
+                            continue;
                         }
                         proc->record_list[proc->answer_record_count].category = U2_DNS_RR_CATEGORY_ANSWER;
                         proc->record_list[proc->answer_record_count].record = record;
@@ -141,12 +162,12 @@ static void _decode_questions(struct u2_mdns_query_proc *proc)
                      */
                     if (!_find_record(proc->record_list, proc->answer_record_count, nsec_record)) {
                         if (proc->answer_record_count >= record_max) {
-                            overflow = true;
-                            break;
+                            overflow++;
+                        } else {
+                            proc->record_list[proc->answer_record_count].category = U2_DNS_RR_CATEGORY_ANSWER;
+                            proc->record_list[proc->answer_record_count].record = nsec_record;
+                            proc->answer_record_count++;
                         }
-                        proc->record_list[proc->answer_record_count].category = U2_DNS_RR_CATEGORY_ANSWER;
-                        proc->record_list[proc->answer_record_count].record = nsec_record;
-                        proc->answer_record_count++;
                     }
                 }
             }
@@ -160,6 +181,7 @@ static void _decode_questions(struct u2_mdns_query_proc *proc)
                  * We ingore it, considering it as answered, otherwise it will be decoded again
                  * and again, with the same result, running in loop forever.
                  */
+                proc->stats.overflow_record_count += proc->answer_record_count + overflow;
                 proc->answer_record_count = 0;
             } else {
                 /*
@@ -172,6 +194,16 @@ static void _decode_questions(struct u2_mdns_query_proc *proc)
             }
         }
 
+        // name, type, class, answer count
+        U2_PROBE4(u2, question, name, type, klass, proc->answer_record_count - first_record);
+
+        bool matched = proc->answer_record_count > first_record || overflow;
+        if (proc->question_handler)
+            proc->question_handler(proc->question_handler_context, name, type, klass, matched);
+
+        proc->stats.question_count++;
+        if (matched)
+            proc->stats.matched_question_count++;
         proc->question_index++;
     }
 }
@@ -247,6 +279,9 @@ static void _remove_known_answers(struct u2_mdns_query_proc *proc)
             if (ttl < record->record->ttl / 2)
                 continue;
             record->category = U2_DNS_RR_CATEGORY_NONE; // invalidate answer
+            // name, type, ttl
+            U2_PROBE3(u2, known_answer, name, type, ttl);
+            proc->stats.known_answer_count++;
             break;
         }
     }
@@ -266,6 +301,24 @@ static void _remove_known_answers(struct u2_mdns_query_proc *proc)
     assert(!proc->additional_record_count);
 }
 
+/**
+ * RFC 6762, section 6.2: the NSEC record of a host only goes along with its
+ * addresses to tell that one family is missing.
+ */
+static bool _is_needless_additional_nsec(const struct u2_dns_record *record)
+{
+    if (record->type != U2_DNS_RR_TYPE_NSEC)
+        return false;
+
+    bool has_a = false;
+    bool has_aaaa = false;
+    for (int r = 0; r < record->domain->record_count; r++) {
+        has_a |= record->domain->record_list[r]->type == U2_DNS_RR_TYPE_A;
+        has_aaaa |= record->domain->record_list[r]->type == U2_DNS_RR_TYPE_AAAA;
+    }
+    return has_a && has_aaaa;
+}
+
 /**
  * Fill the remaining slots in the `proc->record_list` array with non requested answers.
  * Silently ignore all decoding errors.
@@ -295,6 +348,15 @@ static void _generate_additional_response_records(struct u2_mdns_query_proc *pro
             case U2_DNS_RR_TYPE_SRV:
                 name = rr->record->srv.name;
                 break;
+            case U2_DNS_RR_TYPE_A:
+            case U2_DNS_RR_TYPE_AAAA:
+                /*
+                 * RFC 6762, section 6.2: the addresses of the other family,
+                 * or the NSEC record telling there is none, go along, so
+                 * that a dual-stack client needs a single exchange.
+                 */
+                name = rr->record->domain->name;
+                break;
             default:
                 break;
         }
@@ -311,6 +373,8 @@ static void _generate_additional_response_records(struct u2_mdns_query_proc *pro
                     if (record_index >= record_max)
                         break;
                     const struct u2_dns_record *record = domain->record_list[r];
+                    if (_is_needless_additional_nsec(record))
+                        continue;
                     /*
                      * Here we avoid redundant answers. We can do that only
                      * for answers stored in the list.
@@ -328,6 +392,32 @@ static void _generate_additional_response_records(struct u2_mdns_query_proc *pro
     proc->additional_record_count = record_index - proc->answer_record_count;
 }
 
+/**
+ * Decide whether the messages of the batch are sent by unicast. Legacy
+ * queriers and direct queries only get unicast responses. Otherwise, RFC 6762, section 5.4,
+ * asks for unicast responses to QU questions, except for records not
+ * multicast within the last quarter of their TTL. The decision is taken for
+ * the whole batch: mixed batches are multicast, which is always allowed.
+ */
+static void _choose_destination(struct u2_mdns_query_proc *proc)
+{
+    proc->unicast = proc->legacy || proc->direct;
+    if (proc->unicast || !proc->batch_unicast_requested || !proc->multicast_check)
+        return;
+
+    int record_count = proc->answer_record_count + proc->additional_record_count;
+    for (int r = 0; r < record_count; r++) {
+        if (!proc->multicast_check(proc->multicast_check_context, proc->record_list[r].record))
+            return;
+    }
+    proc->unicast = record_count > 0;
+}
+
+static inline uint64_t _now(const struct u2_mdns_query_proc *proc)
+{
+    return proc->clock ? proc->clock() : 0;
+}
+
 void u2_mdsn_query_proc_init(struct u2_mdns_query_proc *proc, const void *msg, size_t size, const struct u2_dns_database *database)
 {
     memset(proc, 0, sizeof(*proc));
@@ -367,21 +457,92 @@ size_t u2_mdns_query_proc_run(struct u2_mdns_query_proc *proc, void *out_msg, si
         bool pending_records = proc->emitter.record_index < proc->answer_record_count;
 
         if (pending_records) {
+            uint64_t t0 = _now(proc);
             size_t out_size = u2_mdns_emitter_run(&proc->emitter, out_msg, ideal_size, max_size);
+            proc->stage_time[U2_MDNS_STAGE_EMIT] += _now(proc) - t0;
             if (out_size)
                 return out_size;
             assert(proc->emitter.record_index >= proc->answer_record_count);
         } else if (pending_questions) {
+            proc->stats.dropped_record_count += proc->emitter.dropped_record_count;
+            uint64_t t0 = _now(proc);
             _decode_questions(proc);
+            uint64_t t1 = _now(proc);
             _remove_known_answers(proc);
+            uint64_t t2 = _now(proc);
             _generate_additional_response_records(proc);
+            uint64_t t3 = _now(proc);
+            proc->stage_time[U2_MDNS_STAGE_DECODE] += t1 - t0;
+            proc->stage_time[U2_MDNS_STAGE_KNOWN_ANSWERS] += t2 - t1;
+            proc->stage_time[U2_MDNS_STAGE_ADDITIONAL] += t3 - t2;
+            _choose_destination(proc);
             u2_mdns_emitter_init(&proc->emitter, proc->record_list, proc->answer_record_count, proc->additional_record_count, false);
+            if (proc->legacy)
+                u2_mdns_emitter_set_legacy(&proc->emitter, &proc->reader, proc->batch_first_question, proc->question_index - proc->batch_first_question);
         } else {
+            proc->stats.dropped_record_count += proc->emitter.dropped_record_count;
+            proc->emitter.dropped_record_count = 0;
             return 0;
         }
     }
 }
 
+/**
+ * Enable the measurement of the time spent in each processing stage.
+ * Times are accumulated in `proc->stage_time` over all calls to
+ * `u2_mdns_query_proc_run()`.
+ */
+void u2_mdns_query_proc_set_clock(struct u2_mdns_query_proc *proc, u2_mdns_clock_t clock)
+{
+    proc->clock = clock;
+}
+
+void u2_mdns_query_proc_set_question_handler(struct u2_mdns_query_proc *proc, u2_mdns_question_handler_t handler, void *context)
+{
+    proc->question_handler = handler;
+    proc->question_handler_context = context;
+}
+
+/**
+ * The query comes from a legacy querier, i.e. not from port 5353. All the
+ * responses are then meant to be sent by unicast, they echo the query ID
+ * and its questions, and have no cache-flush bit (RFC 6762, section 6.7).
+ */
+void u2_mdns_query_proc_set_legacy(struct u2_mdns_query_proc *proc)
+{
+    proc->legacy = true;
+}
+
+/**
+ * The query was sent to an address of this host rather than to the group.
+ * All the responses are then sent by unicast to the querier, formatted as
+ * usual (RFC 6762, section 5.5).
+ */
+void u2_mdns_query_proc_set_direct(struct u2_mdns_query_proc *proc)
+{
+    proc->direct = true;
+}
+
+/**
+ * Enable unicast responses to QU questions, the check telling which records
+ * were multicast recently enough. Without it, QU questions are answered by
+ * multicast, as if they were QM questions.
+ */
+void u2_mdns_query_proc_set_multicast_check(struct u2_mdns_query_proc *proc, u2_mdns_multicast_check_t check, void *context)
+{
+    proc->multicast_check = check;
+    proc->multicast_check_context = context;
+}
+
+/**
+ * True if the last message returned by `u2_mdns_query_proc_run()` must be
+ * sent by unicast to the querier, false if it must be multicast.
+ */
+bool u2_mdns_query_proc_is_unicast(const struct u2_mdns_query_proc *proc)
+{
+    return proc->unicast;
+}
+
 void u2_mdns_emitter_init(struct u2_mdns_emitter *emitter, const struct u2_mdns_response_record *record_list, int mandatory_record_count, int optional_record_count, bool tear_down)
 {
     emitter->record_list = record_list;
@@ -389,9 +550,47 @@ void u2_mdns_emitter_init(struct u2_mdns_emitter *emitter, const struct u2_mdns_
     emitter->optional_record_count = optional_record_count;
     emitter->record_index = 0;
     emitter->tear_down = tear_down;
+    emitter->dropped_record_count = 0;
+    emitter->message_record_index = 0;
+    emitter->legacy_query = NULL;
+    emitter->legacy_first_question = 0;
+    emitter->legacy_question_count = 0;
 }
 
-size_t u2_mdns_emitter_run(struct u2_mdns_emitter *emitter, void *out_msg, size_t ideal_size, size_t max_size)
+/**
+ * Format the messages as legacy unicast responses to `query`, repeating the
+ * given questions. `query` must outlive the emitter.
+ */
+void u2_mdns_emitter_set_legacy(struct u2_mdns_emitter *emitter, struct u2_dns_msg_reader *query, int first_question, int question_count)
+{
+    emitter->legacy_query = query;
+    emitter->legacy_first_question = first_question;
+    emitter->legacy_question_count = question_count;
+}
+
+static void _init_builder(const struct u2_mdns_emitter *emitter, struct u2_dns_msg_builder *builder, void *out_msg, size_t size)
+{
+    if (!emitter->legacy_query) {
+        u2_dns_msg_builder_init(builder, out_msg, size, 0, U2_DNS_MSG_FLAG_QR | U2_DNS_MSG_FLAG_AA);
+        return;
+    }
+
+    u2_dns_msg_builder_init(builder, out_msg, size, u2_dns_msg_reader_get_id(emitter->legacy_query), U2_DNS_MSG_FLAG_QR | U2_DNS_MSG_FLAG_AA);
+
+    // questions that cannot be decoded or do not fit are left out
+    for (int q = 0; q < emitter->legacy_question_count; q++) {
+        struct u2_dns_msg_entry entry;
+        if (u2_dns_msg_reader_get_entry(emitter->legacy_query, emitter->legacy_first_question + q, &entry) < 0)
+            break;
+        char name[256];
+        u2_dns_name_init(name, sizeof(name));
+        if (!u2_dns_name_append_compressed_name(name, sizeof(name), entry.data, entry.name_pos))
+            break;
+        u2_dns_msg_builder_add_question(builder, name, u2_dns_msg_entry_get_question_type(&entry), false);
+    }
+}
+
+static size_t _emitter_run(struct u2_mdns_emitter *emitter, void *out_msg, size_t ideal_size, size_t max_size)
 {
     if (ideal_size > max_size)
         U2_FATAL("u2_mdsn: inconsistent output message size");
@@ -400,7 +599,7 @@ size_t u2_mdns_emitter_run(struct u2_mdns_emitter *emitter, void *out_msg, size_
         return 0;
 
     struct u2_dns_msg_builder builder;
-    u2_dns_msg_builder_init(&builder, out_msg, ideal_size, 0, U2_DNS_MSG_FLAG_QR | U2_DNS_MSG_FLAG_AA);
+    _init_builder(emitter, &builder, out_msg, ideal_size);
     enum u2_dns_rr_category category = U2_DNS_RR_CATEGORY_NONE;
 
     // emit mandatory records
@@ -415,7 +614,7 @@ size_t u2_mdns_emitter_run(struct u2_mdns_emitter *emitter, void *out_msg, size_
             category = rr->category;
             u2_dns_msg_builder_set_category(&builder, rr->category);
         }
-        bool added = _add_answer(&builder, rr->record, emitter->tear_down);
+        bool added = _add_answer(&builder, rr->record, emitter);
         if (!added) {
             // output msg is full
             if (emitter->record_index == first_record_index) {
@@ -424,13 +623,14 @@ size_t u2_mdns_emitter_run(struct u2_mdns_emitter *emitter, void *out_msg, size_
                  * Let's try to use the biggest allowed message.
                  */
                 struct u2_dns_msg_builder builder;
-                u2_dns_msg_builder_init(&builder, out_msg, max_size, 0, U2_DNS_MSG_FLAG_QR | U2_DNS_MSG_FLAG_AA);
-                bool added = _add_answer(&builder, rr->record, emitter->tear_down);
+                _init_builder(emitter, &builder, out_msg, max_size);
+                bool added = _add_answer(&builder, rr->record, emitter);
                 if (added) {
                     emitter->record_index++;
                     return u2_dns_msg_builder_get_size(&builder);
                 }
                 // record really too big - ignore it
+                emitter->dropped_record_count++;
             } else {
                 // let keep the message as it is, remaining records will be sent later
                 return u2_dns_msg_builder_get_size(&builder);
@@ -451,7 +651,7 @@ size_t u2_mdns_emitter_run(struct u2_mdns_emitter *emitter, void *out_msg, size_
             category = rr->category;
             u2_dns_msg_builder_set_category(&builder, rr->category);
         }
-        bool added = _add_answer(&builder, rr->record, emitter->tear_down);
+        bool added = _add_answer(&builder, rr->record, emitter);
         if (!added)
             break;
         emitter->record_index++;
@@ -459,3 +659,13 @@ size_t u2_mdns_emitter_run(struct u2_mdns_emitter *emitter, void *out_msg, size_
 
     return u2_dns_msg_builder_get_size(&builder);
 }
+
+size_t u2_mdns_emitter_run(struct u2_mdns_emitter *emitter, void *out_msg, size_t ideal_size, size_t max_size)
+{
+    emitter->message_record_index = emitter->record_index;
+    size_t size = _emitter_run(emitter, out_msg, ideal_size, max_size);
+    // message, size, records emitted so far
+    if (size)
+        U2_PROBE3(u2, emit, out_msg, size, emitter->record_index);
+    return size;
+}
@@ -40,6 +40,23 @@ U2_C_BEGIN
 
 /*** types ***/
 
+enum u2_mdns_stage {
+    U2_MDNS_STAGE_DECODE = 0,
+    U2_MDNS_STAGE_KNOWN_ANSWERS,
+    U2_MDNS_STAGE_ADDITIONAL,
+    U2_MDNS_STAGE_EMIT,
+    U2_MDNS_STAGE_COUNT,
+};
+
+// monotonic clock, in nanoseconds
+typedef uint64_t (*u2_mdns_clock_t)(void);
+
+// invoked once per question decoded, whatever its class and even if not in the database
+typedef void (*u2_mdns_question_handler_t)(void *context, const char *name, int type, int klass, bool matched);
+
+// true if `record` was multicast on the interface within the last quarter of its TTL
+typedef bool (*u2_mdns_multicast_check_t)(void *context, const struct u2_dns_record *record);
+
 struct u2_mdns_response_record {
     enum u2_dns_rr_category category;
     const struct u2_dns_record *record;
@@ -52,6 +69,21 @@ struct u2_mdns_emitter {
     int optional_record_count;
     int record_index;
     bool tear_down;
+    int dropped_record_count; // records too big to fit in a message
+    int message_record_index; // first record of the last message
+
+    // legacy unicast response, see u2_mdns_emitter_set_legacy()
+    struct u2_dns_msg_reader *legacy_query;
+    int legacy_first_question;
+    int legacy_question_count;
+};
+
+struct u2_mdns_query_stats {
+    int question_count;          // questions decoded
+    int matched_question_count;  // questions with at least one record in the database
+    int known_answer_count;      // answers suppressed because known by the querier
+    int overflow_record_count;   // answers lost because the record list was full, additional records are not counted
+    int dropped_record_count;    // records too big to fit in a message
 };
 
 struct u2_mdns_query_proc {
@@ -68,6 +100,25 @@ struct u2_mdns_query_proc {
     int additional_record_count;
 
     struct u2_mdns_emitter emitter;
+
+    struct u2_mdns_query_stats stats;
+
+    // optional time spent in each stage, measured only when `clock` is set
+    u2_mdns_clock_t clock;
+    uint64_t stage_time[U2_MDNS_STAGE_COUNT];
+
+    // optional question observer
+    u2_mdns_question_handler_t question_handler;
+    void *question_handler_context;
+
+    // unicast responses, see u2_mdns_query_proc_set_legacy(), u2_mdns_query_proc_set_direct() and u2_mdns_query_proc_set_multicast_check()
+    bool legacy;
+    bool direct;
+    u2_mdns_multicast_check_t multicast_check;
+    void *multicast_check_context;
+    int batch_first_question;
+    bool batch_unicast_requested; // all the questions of the batch have the unicast-response bit
+    bool unicast;                 // destination of the messages of the current batch
 };
 
 
@@ -75,8 +126,15 @@ struct u2_mdns_query_proc {
 
 void u2_mdsn_query_proc_init(struct u2_mdns_query_proc *proc, const void *msg, size_t size, const struct u2_dns_database *database);
 size_t u2_mdns_query_proc_run(struct u2_mdns_query_proc *proc, void *out_msg, size_t ideal_size, size_t max_size);
+void u2_mdns_query_proc_set_clock(struct u2_mdns_query_proc *proc, u2_mdns_clock_t clock);
+void u2_mdns_query_proc_set_question_handler(struct u2_mdns_query_proc *proc, u2_mdns_question_handler_t handler, void *context);
+void u2_mdns_query_proc_set_legacy(struct u2_mdns_query_proc *proc);
+void u2_mdns_query_proc_set_direct(struct u2_mdns_query_proc *proc);
+void u2_mdns_query_proc_set_multicast_check(struct u2_mdns_query_proc *proc, u2_mdns_multicast_check_t check, void *context);
+bool u2_mdns_query_proc_is_unicast(const struct u2_mdns_query_proc *proc);
 
 void u2_mdns_emitter_init(struct u2_mdns_emitter *emitter, const struct u2_mdns_response_record *record_list, int mandatory_record_count, int optional_record_count, bool tear_down);
+void u2_mdns_emitter_set_legacy(struct u2_mdns_emitter *emitter, struct u2_dns_msg_reader *query, int first_question, int question_count);
 size_t u2_mdns_emitter_run(struct u2_mdns_emitter *emitter, void *out_msg, size_t ideal_size, size_t max_size);
 
 
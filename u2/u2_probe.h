@@ -0,0 +1,60 @@
+//
+//  u2_probe.h
+//
+//  Created by Gabriele Mondada on 16.10.2026.
+//  Copyright © 2026 Gabriele Mondada.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the “Software”),
+//  to deal in the Software without restriction, including without limitation
+//  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+//  and/or sell copies of the Software, and to permit persons to whom the
+//  Software is furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef _U2_PROBE_H_
+#define _U2_PROBE_H_
+
+/*
+ * Static tracepoints (USDT).
+ *
+ * When U2_PROBES is defined, the probes are compiled with <sys/sdt.h>: each
+ * one is a single nop instruction plus a note in the ELF file, which tools
+ * like bpftrace or perf turn into a breakpoint when attached. Otherwise they
+ * compile to nothing.
+ *
+ * Example:
+ *   bpftrace -e 'usdt:./bonjour-server:u2:question { @[arg1] = count(); }'
+ */
+
+#if defined(U2_PROBES)
+
+#include <sys/sdt.h>
+
+#define U2_PROBE1(provider, name, a1) DTRACE_PROBE1(provider, name, a1)
+#define U2_PROBE2(provider, name, a1, a2) DTRACE_PROBE2(provider, name, a1, a2)
+#define U2_PROBE3(provider, name, a1, a2, a3) DTRACE_PROBE3(provider, name, a1, a2, a3)
+#define U2_PROBE4(provider, name, a1, a2, a3, a4) DTRACE_PROBE4(provider, name, a1, a2, a3, a4)
+
+#else
+
+#define U2_PROBE1(provider, name, a1) do {} while (0)
+#define U2_PROBE2(provider, name, a1, a2) do {} while (0)
+#define U2_PROBE3(provider, name, a1, a2, a3) do {} while (0)
+#define U2_PROBE4(provider, name, a1, a2, a3, a4) do {} while (0)
+
+#endif
+
+#endif